@@ -28,6 +28,7 @@
 #define EDITSELECTORSCREEN_HPP
 
 #include "Screen.hpp"
+#include "SlotCache.hpp"
 #include "pkx/PKX.hpp"
 #include <array>
 #include <vector>
@@ -58,6 +59,7 @@ private:
     std::vector<std::unique_ptr<Button>> viewerButtons;
     std::unique_ptr<pksm::PKX> moveMon = nullptr;
     std::unique_ptr<pksm::PKX> infoMon = nullptr;
+    mutable SlotCache saveCache;
     int cursorPos                      = 0;
     int box                            = 0;
     bool justSwitched                  = true;
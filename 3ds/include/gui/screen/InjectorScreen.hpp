@@ -51,6 +51,8 @@ public:
     void update(touchPosition* touch) override;
     void drawTop(void) const override;
     void drawBottom(void) const override;
+    // False if the card data couldn't be read, in which case the screen shouldn't be shown
+    bool hasCard(void) const { return wondercard != nullptr; }
 
 private:
     bool setLanguage(pksm::Language lang);
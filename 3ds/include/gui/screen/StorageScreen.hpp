@@ -28,6 +28,7 @@
 #define STORAGESCREEN_HPP
 
 #include "Screen.hpp"
+#include "SlotCache.hpp"
 #include "pkx/PKFilter.hpp"
 #include "pkx/PKX.hpp"
 #include <array>
@@ -87,6 +88,8 @@ private:
     // If pickupMode == SWAP, box number & slot pair
     std::pair<int, int> selectDimensions   = {0, 0};
     std::shared_ptr<pksm::PKFilter> filter = std::make_shared<pksm::PKFilter>();
+    mutable SlotCache saveCache;
+    mutable SlotCache bankCache;
     int cursorIndex                        = 0;
     int storageBox                         = 0;
     int boxBox                             = 0;
@@ -27,6 +27,7 @@
 #ifndef ARCHIVE_HPP
 #define ARCHIVE_HPP
 
+#include "CopyEngine.hpp"
 #include "Directory.hpp"
 #include "File.hpp"
 #include "utils.hpp"
@@ -36,6 +37,16 @@ class Archive
 {
 private:
     static Result createPKSMExtdataArchive(const std::string& execPath);
+    static Result moveDir(Archive& src, const std::u16string& dir, Archive& dst,
+        const std::u16string& dest, CopyEngine& engine);
+    static Result copyDir(Archive& src, const std::u16string& dir, Archive& dst,
+        const std::u16string& dest, CopyEngine& engine);
+    static Result moveFile(Archive& src, FS_Path file, Archive& dst, FS_Path dest,
+        CopyEngine& engine);
+    static Result copyFile(Archive& src, FS_Path file, Archive& dst, FS_Path dest,
+        CopyEngine& engine);
+    // Total size of every file under dir, for progress reporting
+    static u64 dirSize(Archive& src, const std::u16string& dir);
 
 public:
     Archive(FS_ArchiveID id, FS_Path path, bool pxi);
@@ -56,55 +67,64 @@ public:
         FS_MediaType mediatype, u32 lowid, u32 highid, bool pxi, u32 pathWord4 = 0);
     static Archive extdata(u32 extdata, bool pxi);
 
+    // Copies go through a CopyEngine. If progress is given, it's called every so often with how
+    // much of the copy is done; it isn't called for moves that are just a rename
+
     // As these do manual directory traversal, an FS_Path overload is not possible
-    static Result moveDir(
-        Archive& src, const std::u16string& dir, Archive& dst, const std::u16string& dest);
-    static Result copyDir(
-        Archive& src, const std::u16string& dir, Archive& dst, const std::u16string& dest);
+    static Result moveDir(Archive& src, const std::u16string& dir, Archive& dst,
+        const std::u16string& dest, const CopyEngine::Progress& progress = nullptr);
+    static Result copyDir(Archive& src, const std::u16string& dir, Archive& dst,
+        const std::u16string& dest, const CopyEngine::Progress& progress = nullptr);
     Result deleteDir(const std::u16string& path);
 
-    static Result moveFile(Archive& src, FS_Path file, Archive& dst, FS_Path dest);
-    static Result copyFile(Archive& src, FS_Path file, Archive& dst, FS_Path dest);
+    static Result moveFile(Archive& src, FS_Path file, Archive& dst, FS_Path dest,
+        const CopyEngine::Progress& progress = nullptr);
+    static Result copyFile(Archive& src, FS_Path file, Archive& dst, FS_Path dest,
+        const CopyEngine::Progress& progress = nullptr);
     Result createDir(FS_Path dir, u32 attributes);
     std::unique_ptr<Directory> directory(FS_Path path);
     Result createFile(FS_Path file, u32 attributes, u64 size);
     std::unique_ptr<File> file(FS_Path file, u32 flags, u32 attributes = 0);
     Result deleteFile(FS_Path file);
 
-    static Result moveDir(
-        Archive& src, const std::string& dir, Archive& dst, const std::string& dest)
+    static Result moveDir(Archive& src, const std::string& dir, Archive& dst,
+        const std::string& dest, const CopyEngine::Progress& progress = nullptr)
     {
-        return moveDir(src, StringUtils::UTF8toUTF16(dir), dst, StringUtils::UTF8toUTF16(dest));
+        return moveDir(
+            src, StringUtils::UTF8toUTF16(dir), dst, StringUtils::UTF8toUTF16(dest), progress);
     }
 
-    static Result moveFile(
-        Archive& src, const std::u16string& file, Archive& dst, const std::u16string& dest)
+    static Result moveFile(Archive& src, const std::u16string& file, Archive& dst,
+        const std::u16string& dest, const CopyEngine::Progress& progress = nullptr)
     {
-        return moveFile(
-            src, fsMakePath(PATH_UTF16, file.c_str()), dst, fsMakePath(PATH_UTF16, dest.c_str()));
+        return moveFile(src, fsMakePath(PATH_UTF16, file.c_str()), dst,
+            fsMakePath(PATH_UTF16, dest.c_str()), progress);
     }
-    static Result moveFile(
-        Archive& src, const std::string& file, Archive& dst, const std::string& dest)
+    static Result moveFile(Archive& src, const std::string& file, Archive& dst,
+        const std::string& dest, const CopyEngine::Progress& progress = nullptr)
     {
-        return moveFile(src, StringUtils::UTF8toUTF16(file), dst, StringUtils::UTF8toUTF16(dest));
+        return moveFile(
+            src, StringUtils::UTF8toUTF16(file), dst, StringUtils::UTF8toUTF16(dest), progress);
     }
 
-    static Result copyDir(
-        Archive& src, const std::string& dir, Archive& dst, const std::string& dest)
+    static Result copyDir(Archive& src, const std::string& dir, Archive& dst,
+        const std::string& dest, const CopyEngine::Progress& progress = nullptr)
     {
-        return copyDir(src, StringUtils::UTF8toUTF16(dir), dst, StringUtils::UTF8toUTF16(dest));
+        return copyDir(
+            src, StringUtils::UTF8toUTF16(dir), dst, StringUtils::UTF8toUTF16(dest), progress);
     }
 
-    static Result copyFile(
-        Archive& src, const std::u16string& file, Archive& dst, const std::u16string& dest)
+    static Result copyFile(Archive& src, const std::u16string& file, Archive& dst,
+        const std::u16string& dest, const CopyEngine::Progress& progress = nullptr)
     {
-        return copyFile(
-            src, fsMakePath(PATH_UTF16, file.c_str()), dst, fsMakePath(PATH_UTF16, dest.c_str()));
+        return copyFile(src, fsMakePath(PATH_UTF16, file.c_str()), dst,
+            fsMakePath(PATH_UTF16, dest.c_str()), progress);
     }
-    static Result copyFile(
-        Archive& src, const std::string& file, Archive& dst, const std::string& dest)
+    static Result copyFile(Archive& src, const std::string& file, Archive& dst,
+        const std::string& dest, const CopyEngine::Progress& progress = nullptr)
     {
-        return copyFile(src, StringUtils::UTF8toUTF16(file), dst, StringUtils::UTF8toUTF16(dest));
+        return copyFile(
+            src, StringUtils::UTF8toUTF16(file), dst, StringUtils::UTF8toUTF16(dest), progress);
     }
 
     Result createDir(const std::u16string& path, u32 attributes)
@@ -45,6 +45,7 @@
 #ifndef SPI_H
 #define SPI_H
 
+#include "SpiPlanner.hpp"
 #include <3ds.h>
 #include <cstring>
 
@@ -52,60 +53,16 @@
 extern "C" {
 #endif
 
-#define SPI_CMD_RDSR 5
-#define SPI_CMD_WREN 6
-
-#define SPI_512B_EEPROM_CMD_WRLO 2
-#define SPI_512B_EEPROM_CMD_WRHI 10
-#define SPI_512B_EEPROM_CMD_RDLO 3
-#define SPI_512B_EEPROM_CMD_RDHI 11
-
-#define SPI_EEPROM_CMD_WRITE 2
-
-#define SPI_CMD_READ 3
-
-#define SPI_CMD_PP 2
-#define SPI_FLASH_CMD_PW 10
-#define SPI_FLASH_CMD_RDID 0x9f
-#define SPI_FLASH_CMD_SE 0xd8
-
-#define SPI_FLG_WIP 1
-#define SPI_FLG_WEL 2
-
-extern u8* fill_buf;
-typedef enum
-{
-    NO_CHIP = -1,
-
-    EEPROM_512B = 0,
-
-    EEPROM_8KB       = 1,
-    EEPROM_64KB      = 2,
-    EEPROM_128KB     = 3,
-    EEPROM_STD_DUMMY = 1,
-
-    FLASH_256KB_1   = 4,
-    FLASH_256KB_2   = 5,
-    FLASH_512KB_1   = 6,
-    FLASH_512KB_2   = 7,
-    FLASH_1MB       = 8,
-    FLASH_8MB       = 9, // <- can't restore savegames, and maybe not read them atm
-    FLASH_STD_DUMMY = 4,
-
-    FLASH_512KB_INFRARED = 10,
-    FLASH_256KB_INFRARED =
-        11, // AFAIK, only "Active Health with Carol Vorderman" has such a flash save memory
-    FLASH_INFRARED_DUMMY = 9,
-
-    CHIP_LAST = 11,
-} CardType;
+// These all go through one SpiPlanner over PXIDEV. See SpiPlanner for what each of them does
 
 Result SPIWriteRead(
     CardType type, void* cmd, u32 cmdSize, void* answer, u32 answerSize, void* data, u32 dataSize);
 Result SPIWaitWriteEnd(CardType type);
 Result SPIEnableWriting(CardType type);
 Result SPIReadJEDECIDAndStatusReg(CardType type, u32* id, u8* statusReg);
-Result SPIGetCardType(CardType* type, int infrared);
+Result SPIGetCardType(CardType* type, int infrared, const u8* header, u32 headerSize);
+// Identifies the card last passed to SPIGetCardType. 0 if it couldn't be identified
+u64 SPICardIdentity(void);
 u32 SPIGetPageSize(CardType type);
 u32 SPIGetCapacity(CardType type);
 
@@ -0,0 +1,67 @@
+/*
+ *   This file is part of PKSM
+ *   Copyright (C) 2016-2021 Bernardo Giordano, Admiral Fish, piepie62
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *   Additional Terms 7.b and 7.c of GPLv3 apply to this file:
+ *       * Requiring preservation of specified reasonable legal notices or
+ *         author attributions in that material or in the Appropriate Legal
+ *         Notices displayed by works containing it.
+ *       * Prohibiting misrepresentation of the origin of that material,
+ *         or requiring that modified versions of such material be marked in
+ *         reasonable ways as different from the original version.
+ */
+
+#ifndef ICONATLAS_HPP
+#define ICONATLAS_HPP
+
+#include <3ds.h>
+#include <citro2d.h>
+#include <optional>
+#include <string>
+#include <vector>
+
+// Title icons share one texture, so the title list draws all of them without switching textures.
+// Icons are also kept in a cache file on the SD card, keyed by title and by a revision that
+// changes whenever the icon might (the title version, or the banner CRC for DS cards), so they
+// don't have to be decoded again on the next scan or the next launch
+namespace IconAtlas
+{
+    struct Icon
+    {
+        std::string name;
+        u16 width;
+        u16 height;
+        // RGB565, already tiled for the GPU
+        std::vector<u16> pixels;
+    };
+
+    // DS cards have no title ID, so their icons are keyed by game code instead
+    u64 dsKey(const std::string& gameCode);
+
+    std::optional<Icon> cached(u64 key, u32 revision);
+    // Only changes the cache in memory, so that a scan decoding many icons writes the file once
+    void cache(u64 key, u32 revision, const Icon& icon);
+    // Writes the cache file out if anything was cached since it was last written
+    void flush();
+
+    // Gives the icon a slot in the atlas, reusing the one it already has if it's there. Returns
+    // nullopt if the atlas is full. What's returned has to be given back to release
+    std::optional<C2D_Image> place(u64 key, u32 revision, const Icon& icon);
+    // Returns false if image isn't from the atlas
+    bool release(const C2D_Image& image);
+}
+
+#endif
@@ -59,6 +59,15 @@ namespace TitleLoader
     void exit(void);
     std::string savePath(void);
     void reloadTitleIds(void);
+    // Changes whenever the contents of save might have, including when a different save is
+    // loaded, so that anything cached from it can tell when it's out of date
+    u32 saveRevision(void);
+    void saveChanged(void);
+    // Pokémon are written to save through these, which take care of the revision. Anything else
+    // that writes to save has to call saveChanged afterwards
+    void setPkm(const pksm::PKX& pkm, u8 box, u8 slot, bool applyTrade);
+    void setPkm(const pksm::PKX& pkm, u8 slot);
+    void fixParty(void);
 
     // Title lists
     // Note that there can only be up to 8 installed titles of either type, which means a threaded
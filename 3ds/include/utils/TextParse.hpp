@@ -32,6 +32,7 @@
 #include "TextPos.hpp"
 #include "colors.hpp"
 #include "types.h"
+#include <array>
 #include <memory>
 #include <optional>
 #include <string>
@@ -140,15 +141,28 @@ namespace TextParse
     class TextBuf
     {
     public:
-        // maxChars is more of a suggestion than a limit. If it's necessary, things can extend
+        struct Stats
+        {
+            u32 hits   = 0;
+            u32 misses = 0;
+            // Time spent parsing strings that weren't cached, in system ticks
+            u64 parseTime = 0;
+        };
+
+        // maxGlyphs is more of a suggestion than a limit. If it's necessary, things can extend
         // farther
         explicit TextBuf(size_t maxGlyphs, const std::vector<FontType>& fonts = {nullptr});
+        // Parsed text is kept between frames, so the same string is only parsed once for as long
+        // as it keeps being drawn
         std::shared_ptr<Text> parse(const std::string& str, float maxWidth = 0.0f);
         void addFont(FontType font);
-        // Clears if currentGlyphs is >= maxChars
+        // Marks the end of a frame. If more than maxGlyphs are cached, throws out the text that
+        // has gone unused the longest, but never anything used this frame
         void clear();
         // Clears unconditionally
         void clearUnconditional();
+        // Counted over the last frame to end
+        const Stats& stats() const { return lastStats; }
 
     private:
         bool fontHasChar(const FontType& font, u32 codepoint);
@@ -156,14 +170,47 @@ namespace TextParse
 #if defined(_3DS)
         std::unordered_map<C2D_Font, std::vector<C3D_Tex>> glyphSheets;
         void makeGlyphSheets(C2D_Font font);
+
+        // Which font a codepoint is drawn with, its glyph index in that font, and the glyph's
+        // metrics, so that laying text out never has to go back to the font's width tables
+        struct CodepointGlyph
+        {
+            u16 glyph;
+            // Index into fonts, or SYSTEM_FONT
+            u8 font;
+            s8 xOffset;
+            u8 width;
+            u8 xAdvance;
+        };
+        static constexpr u8 SYSTEM_FONT = 0xFF;
+        // The BMP is split into blocks of 256 codepoints, each looked up all at once the first time
+        // anything in it is needed. Anything outside of it is looked up one at a time
+        using CodepointBlock = std::array<CodepointGlyph, 256>;
+        std::array<std::unique_ptr<CodepointBlock>, 256> bmpGlyphs;
+        std::unordered_map<u32, CodepointGlyph> otherGlyphs;
+        CodepointGlyph lookupGlyph(u32 codepoint);
+        const CodepointGlyph& glyphForCodepoint(u32 codepoint);
+        C2D_Font fontOf(const CodepointGlyph& glyph) const;
+        Glyph makeGlyph(const CodepointGlyph& glyph, u32 line, float xPos);
+        void clearGlyphTable();
 #endif
         std::pair<std::vector<Glyph>, std::vector<float>> parseWord(
             std::string::const_iterator& str, float maxWidth);
         std::variant<float, size_t> parseWhitespace(std::string::const_iterator& str);
+        struct CachedText
+        {
+            std::shared_ptr<Text> text;
+            u32 lastUsed;
+        };
         std::vector<FontType> fonts;
-        std::unordered_map<std::string, std::shared_ptr<Text>> parsedText;
+        // Keyed by maxWidth, then the string itself, so that a lookup doesn't have to copy the
+        // string. Everything is thrown out when a font is added, as that can change the result
+        std::unordered_map<float, std::unordered_map<std::string, CachedText>> parsedText;
         size_t maxGlyphs;
         size_t currentGlyphs;
+        u32 frame = 0;
+        Stats frameStats;
+        Stats lastStats;
     };
 
     class ScreenText
@@ -26,6 +26,7 @@
 
 #include "Bank.hpp"
 #include "Archive.hpp"
+#include "BackupStore.hpp"
 #include "Configuration.hpp"
 #include "banks.hpp"
 #include "format.h"
@@ -53,6 +54,7 @@ public:
         : string(fmt::format("BankException: Bad generation value: 0x{:X}", badVal))
     {
     }
+    BankException(const std::string& message) : string("BankException: " + message) {}
 
     const char* what() const noexcept override { return string.c_str(); }
 
@@ -60,28 +62,27 @@ private:
     std::string string;
 };
 
-Bank::Bank(const std::string& name, int maxBoxes) : bankName(name)
+namespace
 {
-    load(maxBoxes);
+    u32 nextRevision = 0;
 }
 
-Bank::~Bank()
+Bank::Bank(const std::string& name, int maxBoxes) : bankName(name)
 {
-    if (entries)
-    {
-        delete[] entries;
-    }
+    load(maxBoxes);
 }
 
+Bank::~Bank() {}
+
 void Bank::load(int maxBoxes)
 {
     bool create = false;
-    if (entries)
-    {
-        delete[] entries;
-        entries = nullptr;
-    }
-    needsCheck = false;
+    pages.clear();
+    dirtyBoxes.clear();
+    dirtyNames.clear();
+    fullSave        = true;
+    backupMatches   = false;
+    currentRevision = ++nextRevision;
     if (name() == "pksm_1" && io::exists("/3ds/PKSM/bank/bank.bin"))
     {
         convertFromBankBin();
@@ -90,7 +91,8 @@ void Bank::load(int maxBoxes)
     {
         auto paths    = this->paths();
         bool needSave = false;
-        auto in       = ARCHIVE.file(BANK(paths), FS_OPEN_READ);
+        replayJournal(BANK(paths));
+        auto in = ARCHIVE.file(BANK(paths), FS_OPEN_READ);
         if (in)
         {
             Gui::waitFrame(i18n::localize("BANK_LOAD"));
@@ -121,14 +123,14 @@ void Bank::load(int maxBoxes)
                     extern nlohmann::json g_banks;
                     g_banks[bankName] = maxBoxes;
                     Banks::saveJson();
-                    entries        = new BankEntry[boxes() * 30];
+                    initPages(false);
                     header.version = BANK_VERSION;
                     needSave       = true;
 
                     for (int i = 0; i < boxes() * 30; i++)
                     {
-                        in->read(entries + i, sizeof(G7Entry));
-                        std::fill_n((u8*)(entries + i) + sizeof(G7Entry),
+                        in->read(&entry(i), sizeof(G7Entry));
+                        std::fill_n((u8*)&entry(i) + sizeof(G7Entry),
                             sizeof(BankEntry) - sizeof(G7Entry), 0xFF);
                     }
                     in->close();
@@ -136,14 +138,14 @@ void Bank::load(int maxBoxes)
                 else if (header.version == 2)
                 {
                     in->read(&header.boxes, sizeof(u32));
-                    entries        = new BankEntry[boxes() * 30];
+                    initPages(false);
                     header.version = BANK_VERSION;
                     needSave       = true;
 
                     for (int i = 0; i < boxes() * 30; i++)
                     {
-                        in->read(entries + i, sizeof(G7Entry));
-                        std::fill_n((u8*)(entries + i) + sizeof(G7Entry),
+                        in->read(&entry(i), sizeof(G7Entry));
+                        std::fill_n((u8*)&entry(i) + sizeof(G7Entry),
                             sizeof(BankEntry) - sizeof(G7Entry), 0xFF);
                     }
                     in->close();
@@ -151,9 +153,20 @@ void Bank::load(int maxBoxes)
                 else if (header.version == BANK_VERSION)
                 {
                     in->read(&header.boxes, sizeof(u32));
-                    entries = new BankEntry[boxes() * 30];
-
-                    in->read(entries, size - sizeof(BankHeader));
+                    fullSave = size != sizeof(BankHeader) + sizeof(BankEntry) * boxes() * 30;
+                    if (fullSave)
+                    {
+                        // Can't be paged in from the file, so read whatever is there up front
+                        initPages(false);
+                        for (int i = 0; i < boxes() * 30 && !in->eof(); i++)
+                        {
+                            in->read(&entry(i), sizeof(BankEntry));
+                        }
+                    }
+                    else
+                    {
+                        initPages(true);
+                    }
                     in->close();
                 }
                 else
@@ -215,6 +228,8 @@ void Bank::load(int maxBoxes)
             resize(maxBoxes);
         }
 
+        savedBoxes = boxes();
+
         if (needSave)
         {
             if (create)
@@ -226,12 +241,6 @@ void Bank::load(int maxBoxes)
                 save();
             }
         }
-        else
-        {
-            prevHash = pksm::crypto::sha256((u8*)entries, sizeof(BankEntry) * boxes() * 30);
-            std::string nameData = boxNames->dump(2);
-            prevNameHash         = pksm::crypto::sha256((u8*)nameData.data(), nameData.size());
-        }
     }
 }
 
@@ -239,46 +248,200 @@ bool Bank::saveWithoutBackup() const
 {
     auto paths = this->paths();
     Gui::waitFrame(i18n::localize("BANK_SAVE"));
-    ARCHIVE.deleteFile(BANK(paths));
-    ARCHIVE.createFile(BANK(paths), 0, sizeof(BankHeader) + sizeof(BankEntry) * boxes() * 30);
-    auto out = ARCHIVE.file(BANK(paths), FS_OPEN_WRITE);
-    if (out)
+    bool full = fullSave || boxes() != (int)savedBoxes;
+    if (full)
     {
+        // The file is recreated, so everything has to be in memory first
+        loadAllPages();
+        ARCHIVE.deleteFile(BANK(paths));
+        ARCHIVE.createFile(BANK(paths), 0, sizeof(BankHeader) + sizeof(BankEntry) * boxes() * 30);
+        auto out = ARCHIVE.file(BANK(paths), FS_OPEN_WRITE);
+        if (!out)
+        {
+            Gui::error(i18n::localize("BANK_SAVE_ERROR"), ARCHIVE.result());
+            return false;
+        }
         out->write(&header, sizeof(BankHeader));
-        out->write(entries, sizeof(BankEntry) * boxes() * 30);
+        for (int page = 0; page < (int)pages.size(); page++)
+        {
+            out->write(pageEntries(page), sizeof(BankEntry) * pageBoxes(page) * 30);
+            pages[page].onDisk = true;
+        }
         out->close();
+        fullSave = false;
+    }
+    else if (!saveDirtyEntries(BANK(paths)))
+    {
+        Gui::error(i18n::localize("BANK_SAVE_ERROR"), ARCHIVE.result());
+        return false;
+    }
+    dirtyBoxes.clear();
+    savedBoxes = boxes();
+    evictPages();
 
+    if (full || !dirtyNames.empty())
+    {
         std::string jsonData = boxNames->dump(2);
         ARCHIVE.deleteFile(JSON(paths));
         ARCHIVE.createFile(JSON(paths), 0, jsonData.size() + 1);
-        out = ARCHIVE.file(JSON(paths), FS_OPEN_WRITE, jsonData.size() + 1);
+        auto out = ARCHIVE.file(JSON(paths), FS_OPEN_WRITE, jsonData.size() + 1);
         if (out)
         {
             out->write(jsonData.data(), jsonData.size() + 1);
-            prevHash     = pksm::crypto::sha256((u8*)entries, sizeof(BankEntry) * boxes() * 30);
-            prevNameHash = pksm::crypto::sha256((u8*)jsonData.data(), jsonData.size());
+            dirtyNames.clear();
             out->close();
         }
         else
         {
             Gui::error(i18n::localize("BANK_NAME_ERROR"), ARCHIVE.result());
         }
-        needsCheck = false;
+    }
+    return true;
+}
+
+std::vector<Bank::JournalRecord> Bank::dirtyRecords() const
+{
+    std::vector<JournalRecord> records;
+    for (const auto& [box, dirty] : dirtyBoxes)
+    {
+        for (int slot = 0; slot < 30; slot++)
+        {
+            if (dirty.slots[slot])
+            {
+                records.emplace_back(
+                    JournalRecord{u32(box * 30 + slot), 0, entry(box * 30 + slot)});
+            }
+        }
+    }
+    std::sort(records.begin(), records.end(),
+        [](const JournalRecord& a, const JournalRecord& b) { return a.index < b.index; });
+    return records;
+}
+
+bool Bank::saveDirtyEntries(const std::string& path) const
+{
+    std::vector<JournalRecord> records = dirtyRecords();
+    if (records.empty())
+    {
         return true;
     }
-    else
+    if (!writeJournal(path, records))
+    {
+        return false;
+    }
+    auto out = ARCHIVE.file(path, FS_OPEN_WRITE);
+    if (!out || !writeRecords(*out, records))
+    {
+        // The journal stays, so the next load finishes the job
+        return false;
+    }
+    out->close();
+    ARCHIVE.deleteFile(path + ".journal");
+    return true;
+}
+
+bool Bank::writeJournal(const std::string& path, const std::vector<JournalRecord>& records) const
+{
+    JournalHeader journalHeader;
+    std::copy(JOURNAL_MAGIC.data(), JOURNAL_MAGIC.data() + JOURNAL_MAGIC.size(),
+        journalHeader.MAGIC);
+    journalHeader.count = records.size();
+    journalHeader.boxes = boxes();
+    journalHeader.hash =
+        pksm::crypto::sha256((u8*)records.data(), sizeof(JournalRecord) * records.size());
+
+    std::string journalPath = path + ".journal";
+    ARCHIVE.deleteFile(journalPath);
+    if (R_FAILED(ARCHIVE.createFile(
+            journalPath, 0, sizeof(JournalHeader) + sizeof(JournalRecord) * records.size())))
+    {
+        return false;
+    }
+    auto out = ARCHIVE.file(journalPath, FS_OPEN_WRITE);
+    if (!out)
     {
-        Gui::error(i18n::localize("BANK_SAVE_ERROR"), ARCHIVE.result());
         return false;
     }
+    out->seek(sizeof(JournalHeader), SEEK_SET);
+    out->write(records.data(), sizeof(JournalRecord) * records.size());
+    if (R_FAILED(out->result()))
+    {
+        return false;
+    }
+    out->seek(0, SEEK_SET);
+    out->write(&journalHeader, sizeof(JournalHeader));
+    return R_SUCCEEDED(out->result());
+}
+
+bool Bank::writeRecords(File& out, const std::vector<JournalRecord>& records)
+{
+    for (const auto& record : records)
+    {
+        out.seek(sizeof(BankHeader) + sizeof(BankEntry) * record.index, SEEK_SET);
+        out.write(&record.entry, sizeof(BankEntry));
+        if (R_FAILED(out.result()))
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+void Bank::replayJournal(const std::string& path) const
+{
+    std::string journalPath = path + ".journal";
+    auto in                 = ARCHIVE.file(journalPath, FS_OPEN_READ);
+    if (!in)
+    {
+        return;
+    }
+
+    JournalHeader journalHeader;
+    std::vector<JournalRecord> records;
+    if (in->read(&journalHeader, sizeof(JournalHeader)) == sizeof(JournalHeader) &&
+        !memcmp(journalHeader.MAGIC, JOURNAL_MAGIC.data(), JOURNAL_MAGIC.size()) &&
+        in->size() == sizeof(JournalHeader) + sizeof(JournalRecord) * journalHeader.count)
+    {
+        records.resize(journalHeader.count);
+        in->read(records.data(), sizeof(JournalRecord) * records.size());
+        if (pksm::crypto::sha256((u8*)records.data(), sizeof(JournalRecord) * records.size()) !=
+            journalHeader.hash)
+        {
+            records.clear();
+        }
+    }
+    in->close();
+
+    if (!records.empty())
+    {
+        auto out = ARCHIVE.file(path, FS_OPEN_WRITE);
+        if (out &&
+            out->size() == sizeof(BankHeader) + sizeof(BankEntry) * journalHeader.boxes * 30 &&
+            std::all_of(records.begin(), records.end(), [&journalHeader](const JournalRecord& r) {
+                return r.index < journalHeader.boxes * 30;
+            }))
+        {
+            writeRecords(*out, records);
+        }
+    }
+    ARCHIVE.deleteFile(journalPath);
 }
 
 bool Bank::save() const
 {
     if (Configuration::getInstance().autoBackup())
     {
-        if (!backup() && !Gui::showChoiceMessage(i18n::localize("BACKUP_FAIL_SAVE_1") + '\n' +
-                                                 i18n::localize("BACKUP_FAIL_SAVE_2")))
+        // The first partial save after loading or after a full save has nothing to extend, so it
+        // takes a new backup and starts the log over
+        bool partial = !fullSave && boxes() == (int)savedBoxes;
+        bool good    = partial && backupMatches && logBackup();
+        if (!good)
+        {
+            good = backup() && (!partial || logBackup());
+        }
+        backupMatches = good && partial;
+        if (!good && !Gui::showChoiceMessage(i18n::localize("BACKUP_FAIL_SAVE_1") + '\n' +
+                                             i18n::localize("BACKUP_FAIL_SAVE_2")))
         {
             return false;
         }
@@ -286,22 +449,68 @@ bool Bank::save() const
     return saveWithoutBackup();
 }
 
+bool Bank::logBackup() const
+{
+    const std::string backupPath = "/3ds/PKSM/backups/" + bankName;
+    if (!dirtyNames.empty())
+    {
+        Archive::copyFile(ARCHIVE, JSON(paths()), Archive::sd(), backupPath + ".json.bak");
+    }
+    std::vector<JournalRecord> records = dirtyRecords();
+    if (records.empty())
+    {
+        return true;
+    }
+
+    // Same layout as the journal, one after another. A batch cut short by a crash fails its hash
+    JournalHeader journalHeader;
+    std::copy(JOURNAL_MAGIC.data(), JOURNAL_MAGIC.data() + JOURNAL_MAGIC.size(),
+        journalHeader.MAGIC);
+    journalHeader.count = records.size();
+    journalHeader.boxes = boxes();
+    journalHeader.hash =
+        pksm::crypto::sha256((u8*)records.data(), sizeof(JournalRecord) * records.size());
+
+    auto out = Archive::sd().file(backupPath + ".bnk.bak.log", FS_OPEN_WRITE | FS_OPEN_CREATE);
+    if (!out ||
+        out->size() + sizeof(JournalHeader) + sizeof(JournalRecord) * records.size() >
+            BACKUP_LOG_LIMIT)
+    {
+        return false;
+    }
+    out->seek(0, SEEK_END);
+    out->write(&journalHeader, sizeof(JournalHeader));
+    out->write(records.data(), sizeof(JournalRecord) * records.size());
+    return R_SUCCEEDED(out->result());
+}
+
 void Bank::resize(int boxes)
 {
     if (this->boxes() != boxes)
     {
         Gui::showResizeStorage();
-        BankEntry* newEntries = new BankEntry[boxes * 30];
-        std::copy(entries, entries + std::min(boxes, this->boxes()) * 30, newEntries);
-        delete[] entries;
-        if (boxes > this->boxes())
+        loadAllPages();
+        int oldBoxes = this->boxes();
+        header.boxes = boxes;
+        pages.resize(pageCount());
+        for (auto& page : pages)
         {
-            std::fill_n((u8*)(newEntries + this->boxes() * 30),
-                (boxes - this->boxes()) * 30 * sizeof(BankEntry), 0xFF);
+            if (!page.entries)
+            {
+                page.entries = std::unique_ptr<BankEntry[]>(new BankEntry[PAGE_BOXES * 30]);
+                std::fill_n((u8*)page.entries.get(), sizeof(BankEntry) * PAGE_BOXES * 30, 0xFF);
+                page.onDisk = false;
+            }
         }
-        entries = newEntries;
-
-        header.boxes = boxes;
+        // Clear out what's left of boxes that were previously cut off
+        for (int box = oldBoxes; box < boxes && box % PAGE_BOXES != 0; box++)
+        {
+            std::fill_n((u8*)&entry(box * 30), sizeof(BankEntry) * 30, 0xFF);
+            pages[box / PAGE_BOXES].onDisk = false;
+        }
+        currentRevision = ++nextRevision;
+        std::erase_if(dirtyBoxes, [boxes](const auto& dirty) { return dirty.first >= boxes; });
+        std::erase_if(dirtyNames, [boxes](const auto& dirty) { return dirty.first >= boxes; });
 
         for (int i = boxNames->size(); i < boxes; i++)
         {
@@ -314,29 +523,30 @@ void Bank::resize(int boxes)
 
 std::unique_ptr<pksm::PKX> Bank::pkm(int box, int slot) const
 {
-    int index = box * 30 + slot;
-    auto ret  = pksm::PKX::getPKM(entries[index].gen, entries[index].data, false);
+    const BankEntry& bankEntry = entry(box * 30 + slot);
+    auto ret                   = pksm::PKX::getPKM(bankEntry.gen, bankEntry.data, false);
     if (ret)
     {
         return ret;
     }
-    else if (entries[index].gen == pksm::Generation::UNUSED)
+    else if (bankEntry.gen == pksm::Generation::UNUSED)
     {
         return pksm::PKX::getPKM<pksm::Generation::SEVEN>(nullptr);
     }
 
-    throw BankException(u32(entries[index].gen));
+    throw BankException(u32(bankEntry.gen));
 }
 
 void Bank::pkm(const pksm::PKX& pkm, int box, int slot)
 {
     int index = box * 30 + slot;
     BankEntry newEntry;
+    markDirty(box, slot);
     if (pkm.species() == pksm::Species::None)
     {
         std::fill_n((char*)&newEntry, sizeof(BankEntry), 0xFF);
-        entries[index] = newEntry;
-        needsCheck     = true;
+        entry(index)    = newEntry;
+        currentRevision = ++nextRevision;
         return;
     }
     newEntry.gen = pkm.generation();
@@ -347,8 +557,121 @@ void Bank::pkm(const pksm::PKX& pkm, int box, int slot)
         std::fill_n(
             newEntry.data + pkm.getLength(), sizeof(BankEntry::data) - pkm.getLength(), 0xFF);
     }
-    entries[index] = newEntry;
-    needsCheck     = true;
+    entry(index)    = newEntry;
+    currentRevision = ++nextRevision;
+}
+
+void Bank::markDirty(int box, int slot)
+{
+    auto found = dirtyBoxes.find(box);
+    if (found == dirtyBoxes.end())
+    {
+        found = dirtyBoxes.emplace(box, DirtyBox{boxHash(box), {}}).first;
+    }
+    found->second.slots[slot] = true;
+}
+
+std::array<u8, 32> Bank::boxHash(int box) const
+{
+    return pksm::crypto::sha256((u8*)&entry(box * 30), sizeof(BankEntry) * 30);
+}
+
+int Bank::pageCount() const
+{
+    return (boxes() + PAGE_BOXES - 1) / PAGE_BOXES;
+}
+
+int Bank::pageBoxes(int page) const
+{
+    return std::min(PAGE_BOXES, boxes() - page * PAGE_BOXES);
+}
+
+void Bank::initPages(bool onDisk)
+{
+    pages.clear();
+    pages.resize(pageCount());
+    if (!onDisk)
+    {
+        for (auto& page : pages)
+        {
+            page.entries = std::unique_ptr<BankEntry[]>(new BankEntry[PAGE_BOXES * 30]);
+            std::fill_n((u8*)page.entries.get(), sizeof(BankEntry) * PAGE_BOXES * 30, 0xFF);
+            page.onDisk = false;
+        }
+    }
+}
+
+Bank::BankEntry& Bank::entry(int index) const
+{
+    return pageEntries(index / (PAGE_BOXES * 30))[index % (PAGE_BOXES * 30)];
+}
+
+Bank::BankEntry* Bank::pageEntries(int page) const
+{
+    Page& current   = pages[page];
+    current.lastUse = ++pageUseCounter;
+    if (!current.entries)
+    {
+        evictPages(1);
+        // Only pages that are in the file are ever evicted, so failing to read one back means the
+        // file is unreadable. Carrying on with empty boxes in its place would have the next full
+        // save write them over the real ones
+        u32 size = sizeof(BankEntry) * pageBoxes(page) * 30;
+        auto in  = ARCHIVE.file(BANK(paths()), FS_OPEN_READ);
+        if (!in)
+        {
+            throw BankException(fmt::format("Could not open the bank to read page {}", page));
+        }
+        auto entries = std::unique_ptr<BankEntry[]>(new BankEntry[PAGE_BOXES * 30]);
+        std::fill_n((u8*)entries.get(), sizeof(BankEntry) * PAGE_BOXES * 30, 0xFF);
+        in->seek(sizeof(BankHeader) + sizeof(BankEntry) * page * PAGE_BOXES * 30, SEEK_SET);
+        if (in->read(entries.get(), size) != size)
+        {
+            throw BankException(fmt::format("Could not read page {} of the bank", page));
+        }
+        in->close();
+        current.entries = std::move(entries);
+    }
+    return current.entries.get();
+}
+
+void Bank::loadAllPages() const
+{
+    for (int page = 0; page < (int)pages.size(); page++)
+    {
+        pageEntries(page);
+        // Only evictable once written back out
+        pages[page].onDisk = false;
+    }
+}
+
+void Bank::evictPages(int needed) const
+{
+    size_t budget = std::max(
+        (size_t)2, (size_t)Configuration::getInstance().bankMemory() * 1024 / PAGE_SIZE);
+    size_t resident =
+        std::count_if(pages.begin(), pages.end(), [](const Page& p) { return bool(p.entries); });
+    while (resident + needed > budget)
+    {
+        int lru = -1;
+        for (int page = 0; page < (int)pages.size(); page++)
+        {
+            if (pages[page].entries && pages[page].onDisk &&
+                std::none_of(dirtyBoxes.begin(), dirtyBoxes.end(),
+                    [page](const auto& dirty) { return dirty.first / PAGE_BOXES == page; }) &&
+                (lru == -1 || pages[page].lastUse < pages[lru].lastUse))
+            {
+                lru = page;
+            }
+        }
+        if (lru == -1)
+        {
+            // Everything left has unsaved changes
+            return;
+        }
+        pages[lru].entries = nullptr;
+        resident--;
+    }
 }
 
 bool Bank::backup() const
@@ -359,9 +682,22 @@ bool Bank::backup() const
         "/3ds/PKSM/backups/" + bankName + ".bnk.bak.old");
     Archive::copyFile(Archive::sd(), "/3ds/PKSM/backups/" + bankName + ".json.bak", Archive::sd(),
         "/3ds/PKSM/backups/" + bankName + ".json.bak.old");
-    Result res = Archive::copyFile(
-        ARCHIVE, BANK(paths), Archive::sd(), "/3ds/PKSM/backups/" + bankName + ".bnk.bak");
-    if (R_FAILED(res))
+    // The log goes with the backup it extends. Without one, the old log is still deleted
+    Archive::moveFile(Archive::sd(), "/3ds/PKSM/backups/" + bankName + ".bnk.bak.log",
+        Archive::sd(), "/3ds/PKSM/backups/" + bankName + ".bnk.bak.log.old");
+    if (Configuration::getInstance().incrementalBackups())
+    {
+        // Only the chunks holding changed boxes are written, and the rotation above only copies
+        // the manifest
+        auto in = ARCHIVE.file(BANK(paths), FS_OPEN_READ);
+        if (!in || !BackupStore::write("/3ds/PKSM/backups/" + bankName + ".bnk.bak", in->size(),
+                       [&in](u8* out, size_t size) { return in->read(out, size) == size; }))
+        {
+            return false;
+        }
+    }
+    else if (R_FAILED(Archive::copyFile(ARCHIVE, BANK(paths), Archive::sd(),
+                 "/3ds/PKSM/backups/" + bankName + ".bnk.bak")))
     {
         return false;
     }
@@ -377,8 +713,11 @@ std::string Bank::boxName(int box) const
 
 void Bank::boxName(const std::string& name, int box)
 {
+    if (!dirtyNames.count(box))
+    {
+        dirtyNames.emplace(box, boxName(box));
+    }
     (*boxNames)[box] = name;
-    needsCheck       = true;
 }
 
 void Bank::createJSON()
@@ -395,32 +734,31 @@ void Bank::createBank(int maxBoxes)
     std::copy(BANK_MAGIC.data(), BANK_MAGIC.data() + BANK_MAGIC.size(), header.MAGIC);
     header.version = BANK_VERSION;
     header.boxes   = maxBoxes;
-    if (entries)
-    {
-        delete[] entries;
-    }
-    entries = new BankEntry[maxBoxes * 30];
-    std::fill_n((u8*)entries, sizeof(BankEntry) * boxes() * 30, 0xFF);
+    initPages(false);
 }
 
 bool Bank::hasChanged() const
 {
-    if (!needsCheck)
+    if (boxes() != (int)savedBoxes)
     {
-        return false;
+        return true;
     }
-    auto hash = pksm::crypto::sha256((u8*)entries, sizeof(BankEntry) * boxes() * 30);
-    if (hash != prevHash)
+    for (auto i = dirtyBoxes.begin(); i != dirtyBoxes.end();)
     {
-        return true;
+        if (boxHash(i->first) != i->second.hash)
+        {
+            return true;
+        }
+        i = dirtyBoxes.erase(i);
     }
-    std::string jsonData = boxNames->dump(2);
-    hash                 = pksm::crypto::sha256((u8*)jsonData.data(), jsonData.size());
-    if (hash != prevNameHash)
+    for (auto i = dirtyNames.begin(); i != dirtyNames.end();)
     {
-        return true;
+        if (boxName(i->first) != i->second)
+        {
+            return true;
+        }
+        i = dirtyNames.erase(i);
     }
-    needsCheck = false;
     return false;
 }
 
@@ -439,13 +777,12 @@ void Bank::convertFromBankBin()
         size_t oldSize = inStream->size();
         std::array<u8, pksm::PK6::BOX_LENGTH> pkmData;
         // ANOTHER CONVERSION SECTION
-        entries = new BankEntry[oldSize / pksm::PK6::BOX_LENGTH];
         std::copy(BANK_MAGIC.data(), BANK_MAGIC.data() + BANK_MAGIC.size(), header.MAGIC);
         header.version = BANK_VERSION;
         header.boxes   = oldSize / pksm::PK6::BOX_LENGTH / 30;
         extern nlohmann::json g_banks;
         g_banks["pksm_1"] = header.boxes;
-        std::fill_n((u8*)entries, sizeof(BankEntry) * boxes() * 30, 0xFF);
+        initPages(false);
         boxNames = std::make_unique<nlohmann::json>(nlohmann::json::array());
 
         for (int box = 0; box < std::min((int)(oldSize / (pksm::PK6::BOX_LENGTH * 30)), boxes());
@@ -532,6 +869,7 @@ bool Bank::setName(const std::string& name)
     auto oldPaths       = paths();
     std::string oldName = bankName;
     bankName            = name;
+    backupMatches       = false;
     auto newPaths       = paths();
     if (R_FAILED(Archive::moveFile(ARCHIVE, BANK(oldPaths), ARCHIVE, BANK(newPaths))))
     {
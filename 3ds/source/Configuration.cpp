@@ -236,6 +236,24 @@ Configuration::Configuration()
                 (*mJson)["titles"][std::to_string((u32)pksm::GameVersion::UM)] =
                     "0x00040000001B5100";
             }
+            if ((*mJson)["version"].get<int>() < 12)
+            {
+                (*mJson)["bankMemory"] = 1024;
+            }
+            if ((*mJson)["version"].get<int>() < 13)
+            {
+                (*mJson)["cloudPrefetch"]    = 1;
+                (*mJson)["cloudCacheMemory"] = 512;
+            }
+            if ((*mJson)["version"].get<int>() < 14)
+            {
+                (*mJson)["musicLookahead"] = 4;
+            }
+            // Version 15 added this turned off
+            if ((*mJson)["version"].get<int>() < 16)
+            {
+                (*mJson)["incrementalBackups"] = true;
+            }
 
             (*mJson)["version"] = CURRENT_VERSION;
             save();
@@ -258,6 +276,11 @@ Configuration::Configuration()
             !(mJson->contains("patronCode") && (*mJson)["patronCode"].is_string()) ||
             !(mJson->contains("alphaChannel") && (*mJson)["alphaChannel"].is_boolean()) ||
             !(mJson->contains("autoUpdate") && (*mJson)["autoUpdate"].is_boolean()) ||
+            !(mJson->contains("bankMemory") && (*mJson)["bankMemory"].is_number_integer()) ||
+            !(mJson->contains("cloudPrefetch") && (*mJson)["cloudPrefetch"].is_number_integer()) ||
+            !(mJson->contains("cloudCacheMemory") && (*mJson)["cloudCacheMemory"].is_number_integer()) ||
+            !(mJson->contains("musicLookahead") && (*mJson)["musicLookahead"].is_number_integer()) ||
+            !(mJson->contains("incrementalBackups") && (*mJson)["incrementalBackups"].is_boolean()) ||
             !(mJson->contains("titles") && (*mJson)["titles"].is_object()) ||
             !((*mJson)["defaults"].contains("date") && (*mJson)["defaults"]["date"].is_object()) ||
             !((*mJson)["defaults"]["date"].contains("day") && (*mJson)["defaults"]["date"]["day"].is_number_integer()) ||
@@ -472,6 +495,31 @@ bool Configuration::autoUpdate(void) const
     return (*mJson)["autoUpdate"];
 }
 
+int Configuration::bankMemory(void) const
+{
+    return (*mJson)["bankMemory"];
+}
+
+int Configuration::cloudPrefetch(void) const
+{
+    return (*mJson)["cloudPrefetch"];
+}
+
+int Configuration::cloudCacheMemory(void) const
+{
+    return (*mJson)["cloudCacheMemory"];
+}
+
+int Configuration::musicLookahead(void) const
+{
+    return (*mJson)["musicLookahead"];
+}
+
+bool Configuration::incrementalBackups(void) const
+{
+    return (*mJson)["incrementalBackups"];
+}
+
 std::vector<std::string> Configuration::extraSaves(const std::string& id) const
 {
     if ((*mJson)["extraSaves"].count(id) > 0)
@@ -571,6 +619,31 @@ void Configuration::autoUpdate(bool value)
     (*mJson)["autoUpdate"] = value;
 }
 
+void Configuration::bankMemory(int value)
+{
+    (*mJson)["bankMemory"] = value;
+}
+
+void Configuration::cloudPrefetch(int value)
+{
+    (*mJson)["cloudPrefetch"] = value;
+}
+
+void Configuration::cloudCacheMemory(int value)
+{
+    (*mJson)["cloudCacheMemory"] = value;
+}
+
+void Configuration::musicLookahead(int value)
+{
+    (*mJson)["musicLookahead"] = value;
+}
+
+void Configuration::incrementalBackups(bool value)
+{
+    (*mJson)["incrementalBackups"] = value;
+}
+
 void Configuration::extraSaves(const std::string& id, const std::vector<std::string>& value)
 {
     (*mJson)["extraSaves"][id] = value;
@@ -28,7 +28,9 @@
 #include "Archive.hpp"
 #include "Button.hpp"
 #include "Configuration.hpp"
+#include "FileHash.hpp"
 #include "PkmUtils.hpp"
+#include "TaskGraph.hpp"
 #include "TitleLoadScreen.hpp"
 #include "appIcon.hpp"
 #include "banks.hpp"
@@ -47,9 +49,13 @@
 #include <3ds.h>
 #include <atomic>
 #include <malloc.h>
+#include <optional>
 #include <stdio.h>
 #include <sys/stat.h>
 
+// Touching this file makes PKSM overwrite it with a breakdown of how long startup took
+#define STARTUP_REPORT_PATH "/3ds/PKSM/startup.log"
+
 namespace
 {
     u32 old_time_limit;
@@ -80,19 +86,8 @@ namespace
     bool matchSha256HashFromFile(
         const std::string& path, const decltype(pksm::crypto::sha256(nullptr, 0))& sha)
     {
-        bool match = false;
-        auto in    = Archive::sd().file(path, FS_OPEN_READ);
-        if (in)
-        {
-            size_t size = in->size();
-            char* data  = new char[size];
-            in->read(data, size);
-            auto hash = pksm::crypto::sha256((u8*)data, size);
-            delete[] data;
-            match = sha == hash;
-            in->close();
-        }
-        return match;
+        auto hash = FileHash::cachedSha256(path);
+        return hash && *hash == sha;
     }
 
     bool assetsMatch(void)
@@ -181,11 +176,13 @@ namespace
 
     void backupExtData()
     {
-        Archive::copyDir(Archive::data(), u"/", Archive::sd(), u"/3ds/PKSM/extDataBackup");
+        Archive::copyDir(Archive::data(), u"/", Archive::sd(), u"/3ds/PKSM/extDataBackup",
+            Gui::showRestoreProgress);
     }
     void backupBanks()
     {
-        Archive::copyDir(Archive::sd(), u"/3ds/PKSM/banks", Archive::sd(), u"/3ds/PKSM/banksBkp");
+        Archive::copyDir(Archive::sd(), u"/3ds/PKSM/banks", Archive::sd(), u"/3ds/PKSM/banksBkp",
+            Gui::showRestoreProgress);
     }
 
     bool update(std::string execPath)
@@ -836,7 +833,8 @@ Result App::init(const std::string& execPath)
 
     hidInit();
     gfxInitDefault();
-    Threads::init(1);
+    // One per usable core, plus one so that a worker blocked on I/O doesn't stall the rest
+    Threads::init(Threads::workerCores().size() + 1);
 
     moveIcon.test_and_set();
     Threads::create(iconThread);
@@ -883,56 +881,131 @@ Result App::init(const std::string& execPath)
         return consoleDisplayError("Initializing network connection failed.", -1);
     }
 
-    if (R_FAILED(res = downloadAdditionalAssets()))
-        return consoleDisplayError("Additional assets download failed.\n\nAlways make sure you're "
-                                   "connected to the internet and on the lastest version.",
-            res);
-    if (R_FAILED(res = Gui::init()))
-        return consoleDisplayError("Gui::init failed.", res);
+    // Stages that don't touch the GUI go to workers and overlap with the ones that do, which have
+    // to stay on this thread
+    TaskGraph startup;
+    std::optional<Result> exitWith;
+    bool verified = false;
 
-    i18n::addCallbacks(i18n::initGui, i18n::exitGui);
-    moveIcon.clear();
-    i18n::init(Configuration::getInstance().language());
+    auto assets = startup.add("assets", downloadAdditionalAssets);
+    auto verify = startup.add(
+        "verify",
+        [&verified]
+        {
+            verified = assetsMatch();
+            return 0;
+        },
+        true, {assets});
+    auto gui  = startup.add("gui", Gui::init, false, {assets});
+    auto lang = startup.add(
+        "i18n",
+        []
+        {
+            i18n::addCallbacks(i18n::initGui, i18n::exitGui);
+            moveIcon.clear();
+            i18n::init(Configuration::getInstance().language());
+            return 0;
+        },
+        false, {gui});
+    auto updates = startup.add(
+        "update",
+        [&]
+        {
+            if (!verified)
+            {
+                Gui::warn("Additional assets are not correct.\nPress A to start PKSM update...");
+                if (!update(execPath))
+                {
+                    Gui::warn(
+                        "PKSM update failed.\nTry downloading assets manually before restarting.");
+                    exitWith = -1;
+                }
+                else
+                {
+                    exitWith = rebootToPKSM(execPath);
+                }
+            }
+            else if (Configuration::getInstance().autoUpdate() && update(execPath))
+            {
+                exitWith = rebootToPKSM(execPath);
+            }
+            else if (Configuration::getInstance().autoUpdate())
+            {
+                updateGifts();
+            }
 
-    PkmUtils::initDefaults();
+            if (exitWith)
+            {
+                startup.cancel();
+            }
+            return 0;
+        },
+        false, {lang, verify});
+    // Nothing that touches the card, saves or the SD card data starts until the update check is
+    // past, as it may reboot or exit
+    startup.add(
+        "defaults",
+        []
+        {
+            PkmUtils::initDefaults();
+            return 0;
+        },
+        true, {updates});
+    auto titles = startup.add(
+        "titles",
+        []
+        {
+            TitleLoader::init();
+            Threads::executeTask([](void*) { TitleLoader::scanTitles(); }, nullptr);
+            return 0;
+        },
+        true, {updates});
+    auto banks = startup.add("banks", Banks::init, false, {updates});
+    startup.add(
+        "saves",
+        []
+        {
+            TitleLoader::scanSaves();
+            return 0;
+        },
+        false, {banks, titles});
 
-    if (!assetsMatch())
+    res = startup.run();
+
+    if (io::exists(STARTUP_REPORT_PATH))
     {
-        Gui::warn("Additional assets are not correct.\nPress A to start PKSM update...");
-        if (!update(execPath))
-        {
-            Gui::warn("PKSM update failed.\nTry downloading assets manually before restarting.");
-            return -1;
-        }
-        else
+        if (FILE* out = fopen(STARTUP_REPORT_PATH, "w"))
         {
-            return rebootToPKSM(execPath);
+            std::string report = startup.report();
+            fwrite(report.data(), 1, report.size(), out);
+            fclose(out);
         }
     }
 
-    if (Configuration::getInstance().autoUpdate() && update(execPath))
+    if (R_FAILED(res))
     {
-        return rebootToPKSM(execPath);
+        const std::string stage = startup.failedStage();
+        if (stage == "assets")
+        {
+            return consoleDisplayError("Additional assets download failed.\n\nAlways make sure "
+                                       "you're connected to the internet and on the lastest "
+                                       "version.",
+                res);
+        }
+        return consoleDisplayError(
+            stage == "gui" ? "Gui::init failed." : "Banks::init failed.", res);
     }
-
-    if (Configuration::getInstance().autoUpdate())
+    if (exitWith)
     {
-        updateGifts();
+        return *exitWith;
     }
 
-    if (R_FAILED(res = Banks::init()))
-        return consoleDisplayError("Banks::init failed.", res);
-
-    TitleLoader::init();
-
-    Threads::executeTask([](void*) { TitleLoader::scanTitles(); }, nullptr);
-    TitleLoader::scanSaves();
-
     doCartScan.test_and_set();
     Threads::create(cartScan, nullptr);
 
     continueI18N.test_and_set();
-    Threads::executeTask(i18nThread, nullptr);
+    // Preloads every language in the background; nothing waits on it, so anything else goes first
+    Threads::executeTask(i18nThread, nullptr, Threads::Priority::LOW);
 
     Gui::setScreen(std::make_unique<TitleLoadScreen>());
     // uncomment when needing to debug with GDB
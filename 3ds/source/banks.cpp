@@ -27,6 +27,7 @@
 #include "banks.hpp"
 #include "Archive.hpp"
 #include "Configuration.hpp"
+#include "gui.hpp"
 #include "nlohmann/json.hpp"
 
 // Public on purpose: banks being converted need to set their size
@@ -220,20 +221,20 @@ Result Banks::swapSD(bool toSD)
     Result res = 0;
     if (toSD)
     {
-        if (R_FAILED(res = Archive::moveDir(
-                         Archive::data(), "/banks", Archive::sd(), "/3ds/PKSM/banks")))
+        if (R_FAILED(res = Archive::moveDir(Archive::data(), "/banks", Archive::sd(),
+                         "/3ds/PKSM/banks", Gui::showRestoreProgress)))
             return res;
-        if (R_FAILED(res = Archive::moveFile(
-                         Archive::data(), "/banks.json", Archive::sd(), "/3ds/PKSM/banks.json")))
+        if (R_FAILED(res = Archive::moveFile(Archive::data(), "/banks.json", Archive::sd(),
+                         "/3ds/PKSM/banks.json", Gui::showRestoreProgress)))
             return res;
     }
     else
     {
-        if (R_FAILED(res = Archive::moveDir(
-                         Archive::sd(), "/3ds/PKSM/banks", Archive::data(), "/banks")))
+        if (R_FAILED(res = Archive::moveDir(Archive::sd(), "/3ds/PKSM/banks", Archive::data(),
+                         "/banks", Gui::showRestoreProgress)))
             return res;
-        if (R_FAILED(res = Archive::moveFile(
-                         Archive::sd(), "/3ds/PKSM/banks.json", Archive::data(), "/banks.json")))
+        if (R_FAILED(res = Archive::moveFile(Archive::sd(), "/3ds/PKSM/banks.json",
+                         Archive::data(), "/banks.json", Gui::showRestoreProgress)))
             return res;
     }
     return res;
@@ -25,32 +25,125 @@
  */
 
 #include "QRScanner.hpp"
+#include "Swizzle.hpp"
+#include "format.h"
 #include "quirc/quirc.h"
 #include "thread.hpp"
+#include <algorithm>
 #include <atomic>
+#include <cstdio>
 
 namespace
 {
+    constexpr int FRAME_WIDTH  = 400;
+    constexpr int FRAME_HEIGHT = 240;
+    // Frames are first searched for codes at half resolution, which is a quarter of the work.
+    // Every this many frames the full resolution image is searched anyway, in case a dense code
+    // doesn't survive the downscale
+    constexpr u32 FULL_SCAN_INTERVAL = 4;
+    // Keeps the header's numbers short and bounds what a bogus header can make the scanner allocate
+    constexpr size_t MAX_PARTS = 255;
+
+    struct Part
+    {
+        u16 id;
+        u16 index;
+        u16 total;
+        const u8* data;
+        size_t size;
+    };
+
+    // Returns false if the payload isn't one part of a split payload
+    bool parsePart(const quirc_data& scanned, Part& part)
+    {
+        std::string_view payload((const char*)scanned.payload, scanned.payload_len);
+        if (!payload.starts_with(QR_Internal::MULTIPART_MAGIC))
+        {
+            return false;
+        }
+        payload.remove_prefix(QR_Internal::MULTIPART_MAGIC.size());
+
+        // The header has to be null terminated for sscanf, and is never this long anyway
+        std::string header(payload.substr(0, 16));
+        unsigned int id = 0, index = 0, total = 0;
+        int headerSize = 0;
+        if (sscanf(header.c_str(), "%4x:%u/%u:%n", &id, &index, &total, &headerSize) != 3 ||
+            headerSize == 0 || total == 0 || total > MAX_PARTS || index >= total ||
+            (size_t)headerSize >= payload.size())
+        {
+            return false;
+        }
+
+        part.id    = id;
+        part.index = index;
+        part.total = total;
+        part.data  = (const u8*)payload.data() + headerSize;
+        part.size  = payload.size() - headerSize;
+        return true;
+    }
+
+    // The average of the channels expanded to 8 bits. Multiplying by 0x5556 and shifting is an
+    // exact division by three for every sum a pixel can produce
+    inline u8 luma(u32 px)
+    {
+        u32 sum = ((px >> 11) << 3) + (((px >> 5) & 0x3F) << 2) + ((px & 0x1F) << 3);
+        return (sum * 0x5556) >> 16;
+    }
+
+    // There's no NEON on the 3DS's ARM11, so this works on two pixels per 32-bit load instead
+    void frameToLuma(const u16* frame, u8* out)
+    {
+        const u32* pairs = (const u32*)frame;
+        for (int i = 0; i < FRAME_WIDTH * FRAME_HEIGHT / 2; i++)
+        {
+            u32 pair       = pairs[i];
+            out[i * 2]     = luma(pair & 0xFFFF);
+            out[i * 2 + 1] = luma(pair >> 16);
+        }
+    }
+
+    // Each output pixel is the average of a 2x2 block
+    void frameToHalfLuma(const u16* frame, u8* out)
+    {
+        for (int y = 0; y < FRAME_HEIGHT / 2; y++)
+        {
+            const u32* top    = (const u32*)(frame + y * 2 * FRAME_WIDTH);
+            const u32* bottom = (const u32*)(frame + (y * 2 + 1) * FRAME_WIDTH);
+            for (int x = 0; x < FRAME_WIDTH / 2; x++)
+            {
+                u32 sum = luma(top[x] & 0xFFFF) + luma(top[x] >> 16) + luma(bottom[x] & 0xFFFF) +
+                          luma(bottom[x] >> 16);
+                *out++ = sum >> 2;
+            }
+        }
+    }
+
     class QRData
     {
     public:
-        QRData() : image{new C3D_Tex, &subtex}, data(quirc_new())
+        QRData() : image{new C3D_Tex, &subtex}, data(quirc_new()), smallData(quirc_new())
         {
-            std::fill(cameraBuffer.begin(), cameraBuffer.end(), 0);
+            for (auto& frame : frames)
+            {
+                std::fill(frame.begin(), frame.end(), 0);
+            }
             C3D_TexInit(image.tex, 512, 256, GPU_RGB565);
             C3D_TexSetFilter(image.tex, GPU_LINEAR, GPU_LINEAR);
             image.tex->border = 0xFFFFFFFF;
             C3D_TexSetWrap(image.tex, GPU_CLAMP_TO_BORDER, GPU_CLAMP_TO_BORDER);
-            LightLock_Init(&bufferLock);
+            LightLock_Init(&swapLock);
+            LightLock_Init(&readingLock);
             LightLock_Init(&imageLock);
             svcCreateEvent(&exitEvent, RESET_STICKY);
-            quirc_resize(data, 400, 240);
+            quirc_resize(data, FRAME_WIDTH, FRAME_HEIGHT);
+            quirc_resize(smallData, FRAME_WIDTH / 2, FRAME_HEIGHT / 2);
         }
         ~QRData()
         {
             C3D_TexDelete(image.tex);
             delete image.tex;
             quirc_destroy(data);
+            quirc_destroy(smallData);
             svcCloseHandle(exitEvent);
         }
         void drawThread();
@@ -61,12 +154,31 @@ namespace
 
     private:
         void buffToImage();
+        bool takeFrame();
         void finish();
-        std::array<u16, 400 * 240> cameraBuffer;
-        LightLock bufferLock;
+        // Returns whether every part of the payload has been seen
+        bool addPart(const Part& part);
+        // Triple buffered: the capture thread fills spare and swaps it with ready, and the handler
+        // swaps ready with reading whenever there's a new frame. Neither ever waits on the other
+        // doing anything but a swap. The draw thread also reads from reading, and holds
+        // readingLock while it does so that it isn't swapped out from under it
+        std::array<std::array<u16, FRAME_WIDTH * FRAME_HEIGHT>, 3> frames;
+        u8 spare      = 0;
+        u8 ready      = 1;
+        u8 reading    = 2;
+        bool newFrame = false;
+        LightLock swapLock;
+        LightLock readingLock;
         C2D_Image image;
         LightLock imageLock;
         quirc* data;
+        quirc* smallData;
+        u32 frameCount = 0;
+        // Parts of a split payload seen so far. Seeing a part of a different payload starts over
+        std::vector<std::vector<u8>> parts;
+        u16 partsId = 0;
+        std::atomic<u16> partsFound = 0;
+        std::atomic<u16> partsTotal = 0;
         Handle exitEvent;
         static constexpr Tex3DS_SubTexture subtex = {512, 256, 0.0f, 1.0f, 1.0f, 0.0f};
         std::atomic<bool> finished                = false;
@@ -89,20 +201,45 @@ namespace
 
 void QRData::buffToImage()
 {
-    LightLock_Lock(&bufferLock);
-    for (u32 x = 0; x < 400; x++)
+    LightLock_Lock(&readingLock);
+    Swizzle::fromLinear(
+        frames[reading].data(), FRAME_WIDTH, FRAME_HEIGHT, (u16*)image.tex->data, 512);
+    LightLock_Unlock(&readingLock);
+}
+
+bool QRData::addPart(const Part& part)
+{
+    if (part.id != partsId || part.total != parts.size())
     {
-        for (u32 y = 0; y < 240; y++)
-        {
-            u32 dstPos = ((((y >> 3) * (512 >> 3) + (x >> 3)) << 6) +
-                             ((x & 1) | ((y & 1) << 1) | ((x & 2) << 1) | ((y & 2) << 2) |
-                                 ((x & 4) << 2) | ((y & 4) << 3))) *
-                         2;
-            u32 srcPos = (y * 400 + x) * 2;
-            memcpy(((u8*)image.tex->data) + dstPos, ((u8*)cameraBuffer.data()) + srcPos, 2);
-        }
+        parts.clear();
+        parts.resize(part.total);
+        partsId    = part.id;
+        partsFound = 0;
+        partsTotal = part.total;
     }
-    LightLock_Unlock(&bufferLock);
+
+    if (parts[part.index].empty())
+    {
+        parts[part.index].assign(part.data, part.data + part.size);
+        partsFound++;
+    }
+
+    return partsFound == partsTotal;
+}
+
+bool QRData::takeFrame()
+{
+    LightLock_Lock(&readingLock);
+    LightLock_Lock(&swapLock);
+    bool fresh = newFrame;
+    if (fresh)
+    {
+        std::swap(ready, reading);
+        newFrame = false;
+    }
+    LightLock_Unlock(&swapLock);
+    LightLock_Unlock(&readingLock);
+    return fresh;
 }
 
 void QRData::finish()
@@ -110,8 +247,8 @@ void QRData::finish()
     svcSignalEvent(exitEvent);
     while (!done())
         svcSleepThread(1000000);
-    LightLock_Lock(&bufferLock);
-    LightLock_Unlock(&bufferLock);
+    LightLock_Lock(&readingLock);
+    LightLock_Unlock(&readingLock);
     LightLock_Lock(&imageLock);
     LightLock_Unlock(&imageLock);
 }
@@ -133,6 +270,11 @@ void QRData::drawThread()
         Gui::drawSolidRect(0, 0, 320.0f, 240.0f, COLOR_MASKBLACK);
         Gui::text(i18n::localize("SCANNER_EXIT"), 160, 115, FONT_SIZE_18, COLOR_WHITE,
             TextPosX::CENTER, TextPosY::TOP);
+        if (partsTotal > 1)
+        {
+            Gui::text(fmt::format("{:d}/{:d}", partsFound.load(), partsTotal.load()), 160, 145,
+                FONT_SIZE_14, COLOR_WHITE, TextPosX::CENTER, TextPosY::TOP);
+        }
         Gui::flushText();
 
         if (!aptIsHomeAllowed() && aptCheckHomePressRejected())
@@ -186,10 +328,12 @@ void QRData::captureThread()
             case 1:
                 svcCloseHandle(events[1]);
                 events[1] = 0;
-                LightLock_Lock(&bufferLock);
-                memcpy(cameraBuffer.data(), buffer, 400 * 240 * sizeof(u16));
-                GSPGPU_FlushDataCache(cameraBuffer.data(), 400 * 240 * sizeof(u16));
-                LightLock_Unlock(&bufferLock);
+                memcpy(frames[spare].data(), buffer, 400 * 240 * sizeof(u16));
+                GSPGPU_FlushDataCache(frames[spare].data(), 400 * 240 * sizeof(u16));
+                LightLock_Lock(&swapLock);
+                std::swap(spare, ready);
+                newFrame = true;
+                LightLock_Unlock(&swapLock);
                 CAMU_SetReceiving(
                     &events[1], buffer, PORT_CAM1, 400 * 240 * sizeof(u16), transferUnit);
                 break;
@@ -258,30 +402,56 @@ void QRData::handler(std::vector<u8>& out)
         return;
     }
 
-    int w, h;
-    u8* image = (u8*)quirc_begin(data, &w, &h);
-    LightLock_Lock(&bufferLock);
-    for (ssize_t x = 0; x < w; x++)
+    if (!takeFrame())
     {
-        for (ssize_t y = 0; y < h; y++)
-        {
-            u16 px           = cameraBuffer[y * 400 + x];
-            image[y * w + x] = (u8)(
-                ((((px >> 11) & 0x1F) << 3) + (((px >> 5) & 0x3F) << 2) + ((px & 0x1F) << 3)) / 3);
-        }
+        // Nothing new to look at yet
+        svcSleepThread(1000000);
+        return;
     }
-    LightLock_Unlock(&bufferLock);
+
+    // reading only ever changes on this thread, so the frame can be converted without any locks
+    const u16* frame = frames[reading].data();
+    bool scanFull    = ++frameCount % FULL_SCAN_INTERVAL == 0;
+    if (!scanFull)
+    {
+        frameToHalfLuma(frame, quirc_begin(smallData, nullptr, nullptr));
+        quirc_end(smallData);
+        scanFull = quirc_count(smallData) > 0;
+    }
+    if (!scanFull)
+    {
+        return;
+    }
+
+    frameToLuma(frame, quirc_begin(data, nullptr, nullptr));
     quirc_end(data);
-    if (quirc_count(data) > 0)
+    // Several parts of a split payload can be in view at once, so every code is read
+    for (int i = 0; i < quirc_count(data); i++)
     {
         struct quirc_code code;
         struct quirc_data scan_data;
-        quirc_extract(data, 0, &code);
-        if (!quirc_decode(&code, &scan_data))
+        quirc_extract(data, i, &code);
+        if (quirc_decode(&code, &scan_data))
         {
+            continue;
+        }
+
+        Part part;
+        if (!parsePart(scan_data, part))
+        {
+            // Anything else is a whole payload on its own
             finish();
-            out.resize(scan_data.payload_len);
-            std::copy(scan_data.payload, scan_data.payload + scan_data.payload_len, out.begin());
+            out.assign(scan_data.payload, scan_data.payload + scan_data.payload_len);
+            return;
+        }
+        if (addPart(part))
+        {
+            finish();
+            for (const auto& received : parts)
+            {
+                out.insert(out.end(), received.begin(), received.end());
+            }
+            return;
         }
     }
 }
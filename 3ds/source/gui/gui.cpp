@@ -28,6 +28,7 @@
 #include "BZ2.hpp"
 #include "Configuration.hpp"
 #include "DecisionScreen.hpp"
+#include "DrawList.hpp"
 #include "MessageScreen.hpp"
 #include "TextParse.hpp"
 #include "format.h"
@@ -35,7 +36,10 @@
 #include "pkx/PKX.hpp"
 #include "sound.hpp"
 #include "thread.hpp"
+#include <algorithm>
+#include <optional>
 #include <stack>
+#include <variant>
 
 namespace
 {
@@ -63,6 +67,42 @@ namespace
     bool textMode = false;
     bool inFrame  = false;
 
+    // Draws are recorded and only submitted when something needs them on screen: text being drawn
+    // over them, a change of target, or the end of a frame. DrawList decides the order
+    struct ImageDraw
+    {
+        C3D_Tex* tex;
+        Tex3DS_SubTexture subtex;
+        std::optional<C2D_ImageTint> tint;
+        float x, y, scaleX, scaleY;
+    };
+    struct RectDraw
+    {
+        float x, y, w, h;
+        u32 color;
+    };
+    struct CircleDraw
+    {
+        float x, y, radius;
+        u32 color;
+    };
+    struct TriangleDraw
+    {
+        float x1, y1, x2, y2, x3, y3;
+        u32 color;
+    };
+    struct LineDraw
+    {
+        float x1, y1, x2, y2, width;
+        u32 color;
+    };
+    std::vector<std::variant<ImageDraw, RectDraw, CircleDraw, TriangleDraw, LineDraw>> draws;
+    DrawList drawList;
+    DrawList::Stats lastDrawStats;
+    // Bumped after every update that received a button press or release. Save data is only ever
+    // modified in response to input, so this doubles as a revision for cached save contents
+    u32 inputRevisionCounter = 0;
+
     struct ScrollingTextOffset
     {
         int offset;
@@ -106,6 +146,48 @@ namespace
         Gui::drawImageAt({sprite.tex, &tex}, x + off, y, nullptr, rep, 1.0f);
     }
 
+    void submitDraws()
+    {
+        for (const auto& batch : drawList.batches())
+        {
+            for (u32 index : batch.draws)
+            {
+                const auto& draw = draws[index];
+                if (auto image = std::get_if<ImageDraw>(&draw))
+                {
+                    C2D_DrawImageAt({image->tex, &image->subtex}, image->x, image->y, 0.5f,
+                        image->tint ? &*image->tint : nullptr, image->scaleX, image->scaleY);
+                }
+                else if (auto rect = std::get_if<RectDraw>(&draw))
+                {
+                    C2D_DrawRectSolid(rect->x, rect->y, 0.5f, rect->w, rect->h, rect->color);
+                }
+                else if (auto circle = std::get_if<CircleDraw>(&draw))
+                {
+                    C2D_DrawCircleSolid(circle->x, circle->y, 0.5f, circle->radius, circle->color);
+                }
+                else if (auto tri = std::get_if<TriangleDraw>(&draw))
+                {
+                    C2D_DrawTriangle(tri->x1, tri->y1, tri->color, tri->x2, tri->y2, tri->color,
+                        tri->x3, tri->y3, tri->color, 0.5f);
+                }
+                else if (auto line = std::get_if<LineDraw>(&draw))
+                {
+                    C2D_DrawLine(line->x1, line->y1, line->color, line->x2, line->y2, line->color,
+                        line->width, 0.5f);
+                }
+            }
+        }
+        draws.clear();
+        drawList.clear();
+    }
+
+    void endFrame()
+    {
+        submitDraws();
+        C3D_FrameEnd(0);
+    }
+
     void _draw_repeat(int key, int x, int y, u8 rows, u8 cols)
     {
         C2D_Image sprite = C2D_SpriteSheetGetImage(spritesheet_ui, key);
@@ -408,33 +490,40 @@ void Gui::drawImageAt(
     const C2D_Image& img, float x, float y, const C2D_ImageTint* tint, float scaleX, float scaleY)
 {
     flushText();
-    C2D_DrawImageAt(img, x, y, 0.5f, tint, scaleX, scaleY);
+    drawList.add(img.tex, x, y, x + img.subtex->width * scaleX, y + img.subtex->height * scaleY);
+    draws.emplace_back(ImageDraw{img.tex, *img.subtex,
+        tint ? std::optional<C2D_ImageTint>{*tint} : std::nullopt, x, y, scaleX, scaleY});
 }
 
 void Gui::drawSolidCircle(float x, float y, float rad, PKSM_Color color)
 {
     flushText();
-    C2D_DrawCircleSolid(x, y, 0.5f, rad, colorToFormat(color));
+    drawList.add(nullptr, x - rad, y - rad, x + rad, y + rad);
+    draws.emplace_back(CircleDraw{x, y, rad, colorToFormat(color)});
 }
 
 void Gui::drawSolidRect(float x, float y, float w, float h, PKSM_Color color)
 {
     flushText();
-    C2D_DrawRectSolid(x, y, 0.5f, w, h, colorToFormat(color));
+    drawList.add(nullptr, x, y, x + w, y + h);
+    draws.emplace_back(RectDraw{x, y, w, h, colorToFormat(color)});
 }
 
 void Gui::drawSolidTriangle(
     float x1, float y1, float x2, float y2, float x3, float y3, PKSM_Color color)
 {
     flushText();
-    C2D_DrawTriangle(x1, y1, colorToFormat(color), x2, y2, colorToFormat(color), x3, y3,
-        colorToFormat(color), 0.5f);
+    drawList.add(nullptr, std::min({x1, x2, x3}), std::min({y1, y2, y3}), std::max({x1, x2, x3}),
+        std::max({y1, y2, y3}));
+    draws.emplace_back(TriangleDraw{x1, y1, x2, y2, x3, y3, colorToFormat(color)});
 }
 
 void Gui::drawLine(float x1, float y1, float x2, float y2, float width, PKSM_Color color)
 {
     flushText();
-    C2D_DrawLine(x1, y1, colorToFormat(color), x2, y2, colorToFormat(color), width, 0.5f);
+    drawList.add(nullptr, std::min(x1, x2) - width / 2, std::min(y1, y2) - width / 2,
+        std::max(x1, x2) + width / 2, std::max(y1, y2) + width / 2);
+    draws.emplace_back(LineDraw{x1, y1, x2, y2, width, colorToFormat(color)});
     // float angle = atan2f(y2 - y1, x2 - x1) + C3D_Angle(.25);
     // float dy    = width / 2 * sinf(angle);
     // float dx    = width / 2 * cosf(angle);
@@ -548,10 +637,13 @@ void Gui::drawNoHome()
         noHomeAlpha -= dNoHomeAlpha;
         dNoHomeAlpha += NOHOMEALPHA_ACCEL;
     }
+    // Always the last thing drawn in a frame
+    submitDraws();
 }
 
 void Gui::target(gfxScreen_t screen)
 {
+    submitDraws();
     if (screen == GFX_BOTTOM)
     {
         currentText = &bottomText;
@@ -581,6 +673,8 @@ void Gui::flushText()
 {
     if (textMode)
     {
+        // Text goes over everything drawn before it
+        submitDraws();
         currentText->optimize();
         currentText->draw();
         currentText->clear();
@@ -863,6 +957,25 @@ void Gui::frameClean()
     }
 }
 
+#if DEBUG_STATS
+namespace
+{
+    // What the last frame cost, over the top of the top screen
+    void drawStatsOverlay()
+    {
+        const DrawList::Stats& draws          = Gui::drawStats();
+        const TextParse::TextBuf::Stats& text = textBuffer->stats();
+        Gui::drawSolidRect(0, 0, 400, 12, PKSM_Color(0, 0, 0, 160));
+        Gui::text(fmt::format(FMT_STRING("draws {:d} batches {:d} switches {:d} | text {:d}/{:d} "
+                                         "{:d}us | underruns {:d}"),
+                      draws.draws, draws.batches, draws.textureSwitches, text.hits,
+                      text.hits + text.misses, text.parseTime * 1000000 / SYSCLOCK_ARM11,
+                      Sound::underruns()),
+            2, 0, FONT_SIZE_9, COLOR_WHITE, TextPosX::LEFT, TextPosY::TOP);
+    }
+}
+#endif
+
 void Gui::mainLoop(void)
 {
     bool exit = false;
@@ -894,7 +1007,7 @@ void Gui::mainLoop(void)
             }
             drawNoHome();
 
-            C3D_FrameEnd(0);
+            endFrame();
             Gui::frameClean();
             inFrame = false;
         }
@@ -902,6 +1015,9 @@ void Gui::mainLoop(void)
         {
             target(GFX_TOP);
             screens.top()->doTopDraw();
+#if DEBUG_STATS
+            drawStatsOverlay();
+#endif
             flushText();
 
             target(GFX_BOTTOM);
@@ -914,20 +1030,36 @@ void Gui::mainLoop(void)
             }
             drawNoHome();
 
-            C3D_FrameEnd(0);
+            endFrame();
             Gui::frameClean();
             inFrame = false;
 
             touchPosition touch;
             hidTouchRead(&touch);
             screens.top()->doUpdate(&touch);
+            if (hidKeysDown() | hidKeysUp())
+            {
+                inputRevisionCounter++;
+            }
             exit = screens.size() == 1 && (kHeld & KEY_START);
         }
 
+        lastDrawStats = drawList.stats();
+        drawList.resetStats();
         textBuffer->clear();
     }
 }
 
+u32 Gui::inputRevision(void)
+{
+    return inputRevisionCounter;
+}
+
+const DrawList::Stats& Gui::drawStats(void)
+{
+    return lastDrawStats;
+}
+
 void Gui::exit(void)
 {
     if (spritesheet_ui)
@@ -1381,8 +1513,8 @@ void Gui::sprite(int key, int x, int y)
         C2D_SetImageTint(&tint, C2D_TopRight, C2D_Color32(239, 202, 43, 255), 1);
         C2D_SetImageTint(&tint, C2D_BotLeft, C2D_Color32(246, 230, 158, 255), 1);
         C2D_SetImageTint(&tint, C2D_BotRight, C2D_Color32(244, 212, 81, 255), 1);
-        C2D_DrawImageAt(C2D_SpriteSheetGetImage(spritesheet_ui, ui_sheet_bg_top_greyscale_idx), x,
-            y, 0.5f, &tint);
+        Gui::drawImageAt(
+            C2D_SpriteSheetGetImage(spritesheet_ui, ui_sheet_bg_top_greyscale_idx), x, y, &tint);
     }
     else if (key == ui_sheet_emulated_bg_bottom_yellow_idx)
     {
@@ -1391,8 +1523,8 @@ void Gui::sprite(int key, int x, int y)
         C2D_SetImageTint(&tint, C2D_TopRight, C2D_Color32(246, 230, 158, 255), 1);
         C2D_SetImageTint(&tint, C2D_BotLeft, C2D_Color32(242, 211, 78, 255), 1);
         C2D_SetImageTint(&tint, C2D_BotRight, C2D_Color32(242, 221, 131, 255), 1);
-        C2D_DrawImageAt(C2D_SpriteSheetGetImage(spritesheet_ui, ui_sheet_bg_bottom_greyscale_idx),
-            x, y, 0.5f, &tint);
+        Gui::drawImageAt(
+            C2D_SpriteSheetGetImage(spritesheet_ui, ui_sheet_bg_bottom_greyscale_idx), x, y, &tint);
     }
     else if (key == ui_sheet_emulated_button_lang_disabled_idx)
     {
@@ -1406,23 +1538,23 @@ void Gui::sprite(int key, int x, int y)
     {
         C2D_ImageTint tint;
         C2D_PlainImageTint(&tint, colorToFormat(COLOR_DARKGREY), 1.0f);
-        C2D_DrawImageAt(
+        Gui::drawImageAt(
             C2D_SpriteSheetGetImage(spritesheet_ui, ui_sheet_stripe_move_editor_row_idx), x, y,
-            0.5f, &tint);
+            &tint);
     }
     else if (key == ui_sheet_emulated_button_filter_positive_idx)
     {
         C2D_ImageTint tint;
         C2D_PlainImageTint(&tint, C2D_Color32(0x10, 0x87, 0x1e, 255), 1.0f);
-        C2D_DrawImageAt(C2D_SpriteSheetGetImage(spritesheet_ui, ui_sheet_button_plus_small_idx), x,
-            y, 0.5f, &tint);
+        Gui::drawImageAt(
+            C2D_SpriteSheetGetImage(spritesheet_ui, ui_sheet_button_plus_small_idx), x, y, &tint);
     }
     else if (key == ui_sheet_emulated_button_filter_negative_idx)
     {
         C2D_ImageTint tint;
         C2D_PlainImageTint(&tint, C2D_Color32(0xbd, 0x30, 0x26, 255), 1.0f);
-        C2D_DrawImageAt(C2D_SpriteSheetGetImage(spritesheet_ui, ui_sheet_button_minus_small_idx), x,
-            y, 0.5f, &tint);
+        Gui::drawImageAt(
+            C2D_SpriteSheetGetImage(spritesheet_ui, ui_sheet_button_minus_small_idx), x, y, &tint);
     }
     else if (key == ui_sheet_emulated_button_tabs_3_unselected_idx)
     {
@@ -1432,8 +1564,8 @@ void Gui::sprite(int key, int x, int y)
     {
         C2D_ImageTint tint;
         C2D_PlainImageTint(&tint, colorToFormat(COLOR_DARKGREY), 1.0f);
-        C2D_DrawImageAt(C2D_SpriteSheetGetImage(spritesheet_ui, ui_sheet_checkbox_blank_idx), x, y,
-            0.5f, &tint);
+        Gui::drawImageAt(
+            C2D_SpriteSheetGetImage(spritesheet_ui, ui_sheet_checkbox_blank_idx), x, y, &tint);
     }
     else if (key == ui_sheet_emulated_button_tabs_2_unselected_idx)
     {
@@ -2244,7 +2376,7 @@ void Gui::waitFrame(const std::string& message)
 {
     if (inFrame)
     {
-        C3D_FrameEnd(0);
+        endFrame();
         Gui::frameClean();
     }
 
@@ -2271,7 +2403,7 @@ void Gui::waitFrame(const std::string& message)
     target(GFX_BOTTOM);
     sprite(ui_sheet_part_info_bottom_idx, 0, 0);
 
-    C3D_FrameEnd(0);
+    endFrame();
     Gui::frameClean();
 
     if (inFrame)
@@ -2296,7 +2428,7 @@ void Gui::showRestoreProgress(u32 partial, u32 total)
 {
     if (inFrame)
     {
-        C3D_FrameEnd(0);
+        endFrame();
         Gui::frameClean();
     }
 
@@ -2314,7 +2446,7 @@ void Gui::showRestoreProgress(u32 partial, u32 total)
     target(GFX_BOTTOM);
     sprite(ui_sheet_part_info_bottom_idx, 0, 0);
 
-    C3D_FrameEnd(0);
+    endFrame();
     Gui::frameClean();
 
     if (inFrame)
@@ -2327,7 +2459,7 @@ void Gui::showDownloadProgress(const std::string& path, u32 partial, u32 total)
 {
     if (inFrame)
     {
-        C3D_FrameEnd(0);
+        endFrame();
         Gui::frameClean();
     }
 
@@ -2345,7 +2477,7 @@ void Gui::showDownloadProgress(const std::string& path, u32 partial, u32 total)
     target(GFX_BOTTOM);
     sprite(ui_sheet_part_info_bottom_idx, 0, 0);
 
-    C3D_FrameEnd(0);
+    endFrame();
     Gui::frameClean();
 
     if (inFrame)
@@ -2358,7 +2490,7 @@ void Gui::showResizeStorage()
 {
     if (inFrame)
     {
-        C3D_FrameEnd(0);
+        endFrame();
         Gui::frameClean();
     }
 
@@ -2374,7 +2506,7 @@ void Gui::showResizeStorage()
     target(GFX_BOTTOM);
     sprite(ui_sheet_part_info_bottom_idx, 0, 0);
 
-    C3D_FrameEnd(0);
+    endFrame();
     Gui::frameClean();
 
     if (inFrame)
@@ -2388,7 +2520,7 @@ void Gui::error(const std::string& message, Result errorCode)
     u32 keys = 0;
     if (inFrame)
     {
-        C3D_FrameEnd(0);
+        endFrame();
         Gui::frameClean();
     }
     hidScanInput();
@@ -2422,7 +2554,7 @@ void Gui::error(const std::string& message, Result errorCode)
 
         drawNoHome();
 
-        C3D_FrameEnd(0);
+        endFrame();
         Gui::frameClean();
     }
     hidScanInput();
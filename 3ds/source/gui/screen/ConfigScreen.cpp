@@ -26,6 +26,7 @@
 
 #include "ConfigScreen.hpp"
 #include "AccelButton.hpp"
+#include "BackupStore.hpp"
 #include "ClickButton.hpp"
 #include "Configuration.hpp"
 #include "EditorScreen.hpp"
@@ -480,7 +481,7 @@ void ConfigScreen::initButtons()
         },
         ui_sheet_button_info_detail_editor_light_idx, "", 0.0f, COLOR_BLACK));
     tabButtons[2].push_back(std::make_unique<ClickButton>(
-        247, 52, 15, 12,
+        247, 50, 15, 12,
         []()
         {
             Configuration::getInstance().transferEdit(!Configuration::getInstance().transferEdit());
@@ -488,7 +489,7 @@ void ConfigScreen::initButtons()
         },
         ui_sheet_button_info_detail_editor_light_idx, "", 0.0f, COLOR_BLACK));
     tabButtons[2].push_back(std::make_unique<ClickButton>(
-        247, 72, 15, 12,
+        247, 68, 15, 12,
         []()
         {
             Configuration::getInstance().writeFileSave(
@@ -497,7 +498,7 @@ void ConfigScreen::initButtons()
         },
         ui_sheet_button_info_detail_editor_light_idx, "", 0.0f, COLOR_BLACK));
     tabButtons[2].push_back(std::make_unique<ClickButton>(
-        247, 92, 15, 12,
+        247, 86, 15, 12,
         []()
         {
             Configuration::getInstance().useSaveInfo(!Configuration::getInstance().useSaveInfo());
@@ -505,7 +506,7 @@ void ConfigScreen::initButtons()
         },
         ui_sheet_button_info_detail_editor_light_idx, "", 0.0f, COLOR_BLACK));
     tabButtons[2].push_back(std::make_unique<ClickButton>(
-        247, 112, 15, 12,
+        247, 104, 15, 12,
         [this]()
         {
             Configuration::getInstance().useExtData(!Configuration::getInstance().useExtData());
@@ -514,7 +515,7 @@ void ConfigScreen::initButtons()
         },
         ui_sheet_button_info_detail_editor_light_idx, "", 0.0f, COLOR_BLACK));
     tabButtons[2].push_back(std::make_unique<ClickButton>(
-        247, 132, 15, 12,
+        247, 122, 15, 12,
         []()
         {
             Configuration::getInstance().randomMusic(!Configuration::getInstance().randomMusic());
@@ -522,7 +523,7 @@ void ConfigScreen::initButtons()
         },
         ui_sheet_button_info_detail_editor_light_idx, "", 0.0f, COLOR_BLACK));
     tabButtons[2].push_back(std::make_unique<ClickButton>(
-        247, 152, 15, 12,
+        247, 140, 15, 12,
         [this]()
         {
             Configuration::getInstance().showBackups(!Configuration::getInstance().showBackups());
@@ -531,7 +532,25 @@ void ConfigScreen::initButtons()
         },
         ui_sheet_button_info_detail_editor_light_idx, "", 0.0f, COLOR_BLACK));
     tabButtons[2].push_back(std::make_unique<ClickButton>(
-        247, 172, 15, 12,
+        247, 158, 15, 12,
+        []()
+        {
+            bool incremental = !Configuration::getInstance().incrementalBackups();
+            Configuration::getInstance().incrementalBackups(incremental);
+            // Deduplicated backups can only be read by PKSM
+            if (!incremental && Gui::showChoiceMessage(i18n::localize("CONFIG_EXPAND_BACKUPS")))
+            {
+                Gui::waitFrame(i18n::localize("CONFIG_EXPANDING_BACKUPS"));
+                if (!BackupStore::expand({"/3ds/PKSM/backups"}))
+                {
+                    Gui::warn(i18n::localize("CONFIG_EXPAND_FAILED"));
+                }
+            }
+            return true;
+        },
+        ui_sheet_button_info_detail_editor_light_idx, "", 0.0f, COLOR_BLACK));
+    tabButtons[2].push_back(std::make_unique<ClickButton>(
+        247, 176, 15, 12,
         [this]()
         {
             Configuration::getInstance().autoUpdate(!Configuration::getInstance().autoUpdate());
@@ -539,7 +558,7 @@ void ConfigScreen::initButtons()
         },
         ui_sheet_button_info_detail_editor_light_idx, "", 0.0f, COLOR_BLACK));
     tabButtons[2].push_back(std::make_unique<ClickButton>(
-        247, 192, 15, 12,
+        247, 194, 15, 12,
         [this]()
         {
             Gui::setScreen(std::make_unique<ExtraSavesScreen>());
@@ -711,21 +730,23 @@ void ConfigScreen::drawBottom() const
     {
         Gui::text(i18n::localize("CONFIG_BACKUP_SAVE"), 19, 30, FONT_SIZE_12, COLOR_WHITE,
             TextPosX::LEFT, TextPosY::TOP, TextWidthAction::SQUISH_OR_SCROLL, 223);
-        Gui::text(i18n::localize("CONFIG_EDIT_TRANSFERS"), 19, 50, FONT_SIZE_12, COLOR_WHITE,
+        Gui::text(i18n::localize("CONFIG_EDIT_TRANSFERS"), 19, 48, FONT_SIZE_12, COLOR_WHITE,
+            TextPosX::LEFT, TextPosY::TOP, TextWidthAction::SQUISH_OR_SCROLL, 223);
+        Gui::text(i18n::localize("CONFIG_BACKUP_INJECTION"), 19, 66, FONT_SIZE_12, COLOR_WHITE,
             TextPosX::LEFT, TextPosY::TOP, TextWidthAction::SQUISH_OR_SCROLL, 223);
-        Gui::text(i18n::localize("CONFIG_BACKUP_INJECTION"), 19, 70, FONT_SIZE_12, COLOR_WHITE,
+        Gui::text(i18n::localize("CONFIG_SAVE_INFO"), 19, 84, FONT_SIZE_12, COLOR_WHITE,
             TextPosX::LEFT, TextPosY::TOP, TextWidthAction::SQUISH_OR_SCROLL, 223);
-        Gui::text(i18n::localize("CONFIG_SAVE_INFO"), 19, 90, FONT_SIZE_12, COLOR_WHITE,
+        Gui::text(i18n::localize("CONFIG_USE_EXTDATA"), 19, 102, FONT_SIZE_12, COLOR_WHITE,
             TextPosX::LEFT, TextPosY::TOP, TextWidthAction::SQUISH_OR_SCROLL, 223);
-        Gui::text(i18n::localize("CONFIG_USE_EXTDATA"), 19, 110, FONT_SIZE_12, COLOR_WHITE,
+        Gui::text(i18n::localize("CONFIG_RANDOM_MUSIC"), 19, 120, FONT_SIZE_12, COLOR_WHITE,
             TextPosX::LEFT, TextPosY::TOP, TextWidthAction::SQUISH_OR_SCROLL, 223);
-        Gui::text(i18n::localize("CONFIG_RANDOM_MUSIC"), 19, 130, FONT_SIZE_12, COLOR_WHITE,
+        Gui::text(i18n::localize("CONFIG_SHOW_BACKUPS"), 19, 138, FONT_SIZE_12, COLOR_WHITE,
             TextPosX::LEFT, TextPosY::TOP, TextWidthAction::SQUISH_OR_SCROLL, 223);
-        Gui::text(i18n::localize("CONFIG_SHOW_BACKUPS"), 19, 150, FONT_SIZE_12, COLOR_WHITE,
+        Gui::text(i18n::localize("CONFIG_INCREMENTAL_BACKUPS"), 19, 156, FONT_SIZE_12, COLOR_WHITE,
             TextPosX::LEFT, TextPosY::TOP, TextWidthAction::SQUISH_OR_SCROLL, 223);
-        Gui::text(i18n::localize("CONFIG_AUTO_UPDATE"), 19, 170, FONT_SIZE_12, COLOR_WHITE,
+        Gui::text(i18n::localize("CONFIG_AUTO_UPDATE"), 19, 174, FONT_SIZE_12, COLOR_WHITE,
             TextPosX::LEFT, TextPosY::TOP, TextWidthAction::SQUISH_OR_SCROLL, 223);
-        Gui::text(i18n::localize("EXTRA_SAVES"), 19, 190, FONT_SIZE_12, COLOR_WHITE, TextPosX::LEFT,
+        Gui::text(i18n::localize("EXTRA_SAVES"), 19, 192, FONT_SIZE_12, COLOR_WHITE, TextPosX::LEFT,
             TextPosY::TOP, TextWidthAction::SQUISH_OR_SCROLL, 223);
         Gui::text(i18n::localize("TITLE_IDS"), 19, 210, FONT_SIZE_12, COLOR_WHITE, TextPosX::LEFT,
             TextPosY::TOP, TextWidthAction::SQUISH_OR_SCROLL, 223);
@@ -740,25 +761,28 @@ void ConfigScreen::drawBottom() const
             270, 30, FONT_SIZE_12, COLOR_WHITE, TextPosX::LEFT, TextPosY::TOP);
         Gui::text(Configuration::getInstance().transferEdit() ? i18n::localize("YES")
                                                               : i18n::localize("NO"),
-            270, 50, FONT_SIZE_12, COLOR_WHITE, TextPosX::LEFT, TextPosY::TOP);
+            270, 48, FONT_SIZE_12, COLOR_WHITE, TextPosX::LEFT, TextPosY::TOP);
         Gui::text(Configuration::getInstance().writeFileSave() ? i18n::localize("YES")
                                                                : i18n::localize("NO"),
-            270, 70, FONT_SIZE_12, COLOR_WHITE, TextPosX::LEFT, TextPosY::TOP);
+            270, 66, FONT_SIZE_12, COLOR_WHITE, TextPosX::LEFT, TextPosY::TOP);
         Gui::text(Configuration::getInstance().useSaveInfo() ? i18n::localize("YES")
                                                              : i18n::localize("NO"),
-            270, 90, FONT_SIZE_12, COLOR_WHITE, TextPosX::LEFT, TextPosY::TOP);
+            270, 84, FONT_SIZE_12, COLOR_WHITE, TextPosX::LEFT, TextPosY::TOP);
         Gui::text(Configuration::getInstance().useExtData() ? i18n::localize("YES")
                                                             : i18n::localize("NO"),
-            270, 110, FONT_SIZE_12, COLOR_WHITE, TextPosX::LEFT, TextPosY::TOP);
+            270, 102, FONT_SIZE_12, COLOR_WHITE, TextPosX::LEFT, TextPosY::TOP);
         Gui::text(Configuration::getInstance().randomMusic() ? i18n::localize("YES")
                                                              : i18n::localize("NO"),
-            270, 130, FONT_SIZE_12, COLOR_WHITE, TextPosX::LEFT, TextPosY::TOP);
+            270, 120, FONT_SIZE_12, COLOR_WHITE, TextPosX::LEFT, TextPosY::TOP);
         Gui::text(Configuration::getInstance().showBackups() ? i18n::localize("YES")
                                                              : i18n::localize("NO"),
-            270, 150, FONT_SIZE_12, COLOR_WHITE, TextPosX::LEFT, TextPosY::TOP);
+            270, 138, FONT_SIZE_12, COLOR_WHITE, TextPosX::LEFT, TextPosY::TOP);
+        Gui::text(Configuration::getInstance().incrementalBackups() ? i18n::localize("YES")
+                                                                    : i18n::localize("NO"),
+            270, 156, FONT_SIZE_12, COLOR_WHITE, TextPosX::LEFT, TextPosY::TOP);
         Gui::text(Configuration::getInstance().autoUpdate() ? i18n::localize("YES")
                                                             : i18n::localize("NO"),
-            270, 170, FONT_SIZE_12, COLOR_WHITE, TextPosX::LEFT, TextPosY::TOP);
+            270, 174, FONT_SIZE_12, COLOR_WHITE, TextPosX::LEFT, TextPosY::TOP);
     }
     else if (currentTab == 3)
     {
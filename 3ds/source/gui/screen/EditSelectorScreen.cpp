@@ -122,7 +122,7 @@ bool EditSelectorScreen::doQR()
     {
         int slot = cursorPos ? cursorPos - 1
                              : 0; // make sure it writes to a good position, AKA not the title bar
-        TitleLoader::save->pkm(*pkm, box, slot, false);
+        TitleLoader::setPkm(*pkm, box, slot, false);
         return true;
     }
     return false;
@@ -130,7 +130,8 @@ bool EditSelectorScreen::doQR()
 
 EditSelectorScreen::EditSelectorScreen()
     : Screen(i18n::localize("A_SELECT") + '\n' + i18n::localize("X_CLONE") + '\n' +
-             i18n::localize("B_BACK"))
+             i18n::localize("B_BACK")),
+      saveCache([](int box, int slot) { return TitleLoader::save->pkm(box, slot); }, 1)
 {
     addOverlay<ViewOverlay>(infoMon, false);
 
@@ -263,10 +264,11 @@ void EditSelectorScreen::drawBottom() const
             }
             else
             {
-                std::unique_ptr<pksm::PKX> pokemon = TitleLoader::save->pkm(box, row * 6 + column);
-                if (pokemon->species() != pksm::Species::None)
+                const pksm::PKX& pokemon =
+                    saveCache.pkm(box, row * 6 + column, TitleLoader::saveRevision());
+                if (pokemon.species() != pksm::Species::None)
                 {
-                    Gui::pkm(*pokemon, x, y);
+                    Gui::pkm(pokemon, x, y);
                 }
                 if (TitleLoader::save->generation() == pksm::Generation::LGPE)
                 {
@@ -451,7 +453,7 @@ void EditSelectorScreen::update(touchPosition* touch)
                     {
                         tmpMon = nullptr;
                     }
-                    TitleLoader::save->pkm(*moveMon, box, cursorPos - 1, false);
+                    TitleLoader::setPkm(*moveMon, box, cursorPos - 1, false);
                     moveMon = std::move(tmpMon);
                 }
             }
@@ -466,9 +468,9 @@ void EditSelectorScreen::update(touchPosition* touch)
                 {
                     tmpMon = nullptr;
                 }
-                TitleLoader::save->pkm(*moveMon, cursorPos - 31);
+                TitleLoader::setPkm(*moveMon, cursorPos - 31);
                 moveMon = std::move(tmpMon);
-                TitleLoader::save->fixParty();
+                TitleLoader::fixParty();
             }
             else
             {
@@ -712,9 +714,9 @@ bool EditSelectorScreen::clonePkm()
                 {
                     tmpMon = nullptr;
                 }
-                TitleLoader::save->pkm(*moveMon, cursorPos - 31);
+                TitleLoader::setPkm(*moveMon, cursorPos - 31);
                 moveMon = std::move(tmpMon);
-                TitleLoader::save->fixParty();
+                TitleLoader::fixParty();
             }
         }
         else if (box * 30 + cursorPos - 1 < TitleLoader::save->maxSlot())
@@ -734,7 +736,7 @@ bool EditSelectorScreen::clonePkm()
                 {
                     tmpMon = nullptr;
                 }
-                TitleLoader::save->pkm(*moveMon, box, cursorPos - 1, false);
+                TitleLoader::setPkm(*moveMon, box, cursorPos - 1, false);
                 moveMon = std::move(tmpMon);
             }
         }
@@ -780,7 +782,7 @@ bool EditSelectorScreen::releasePokemon()
     {
         if (cursorPos < 31 && box * 30 + cursorPos - 1 < TitleLoader::save->maxSlot())
         {
-            TitleLoader::save->pkm(*TitleLoader::save->emptyPkm(), box, cursorPos - 1, false);
+            TitleLoader::setPkm(*TitleLoader::save->emptyPkm(), box, cursorPos - 1, false);
             if (TitleLoader::save->generation() == pksm::Generation::LGPE)
             {
                 pksm::SavLGPE* sav = (pksm::SavLGPE*)TitleLoader::save.get();
@@ -789,7 +791,7 @@ bool EditSelectorScreen::releasePokemon()
                     if (sav->partyBoxSlot(i) == box * 30 + cursorPos - 1)
                     {
                         sav->partyBoxSlot(i, 1001);
-                        sav->fixParty();
+                        TitleLoader::fixParty();
                     }
                 }
             }
@@ -798,8 +800,8 @@ bool EditSelectorScreen::releasePokemon()
         {
             if (TitleLoader::save->partyCount() > 1)
             {
-                TitleLoader::save->pkm(*TitleLoader::save->emptyPkm(), cursorPos - 31);
-                TitleLoader::save->fixParty();
+                TitleLoader::setPkm(*TitleLoader::save->emptyPkm(), cursorPos - 31);
+                TitleLoader::fixParty();
             }
             else
             {
@@ -435,7 +435,7 @@ bool EditorScreen::goBack()
         Gui::screenBack();
         if (!emergency && TitleLoader::save)
         {
-            TitleLoader::save->fixParty();
+            TitleLoader::fixParty();
         }
         return true;
     }
@@ -446,7 +446,7 @@ bool EditorScreen::advanceMon(bool forward)
 {
     if (saved() || Gui::showChoiceMessage(i18n::localize("EDITOR_CHECK_EXIT")))
     {
-        TitleLoader::save->fixParty();
+        TitleLoader::fixParty();
         do
         {
             if (box == PARTY_MAGIC_NUM)
@@ -703,12 +703,12 @@ bool EditorScreen::save()
             {
                 partyUpdate();
             }
-            TitleLoader::save->pkm(*pkm, box, index, false);
+            TitleLoader::setPkm(*pkm, box, index, false);
         }
         else
         {
             partyUpdate();
-            TitleLoader::save->pkm(*pkm, index);
+            TitleLoader::setPkm(*pkm, index);
         }
         TitleLoader::save->dex(*pkm);
     }
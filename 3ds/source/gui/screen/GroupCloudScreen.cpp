@@ -235,11 +235,11 @@ void GroupCloudScreen::drawTop() const
         u16 x = 45;
         for (u8 column = 0; column < 6; column++)
         {
-            auto pkm = access.pkm(row, column);
-            if (pkm->species() != pksm::Species::None)
+            const auto& pkm = access.viewPkm(row, column);
+            if (pkm.species() != pksm::Species::None)
             {
-                float blend = *pkm == *filter ? 0.0f : 0.5f;
-                Gui::pkm(*pkm, x, y, 1.0f, COLOR_BLACK, blend);
+                float blend = pkm == *filter ? 0.0f : 0.5f;
+                Gui::pkm(pkm, x, y, 1.0f, COLOR_BLACK, blend);
             }
             x += 34;
         }
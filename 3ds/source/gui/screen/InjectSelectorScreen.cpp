@@ -152,7 +152,13 @@ void InjectSelectorScreen::update(touchPosition* touch)
                 Gui::showChoiceMessage(
                     "Not all of these wonder card(s) are released.\nContinue to injection screen?"))
             {
-                Gui::setScreen(std::make_unique<InjectorScreen>(wondercards[hid.fullIndex()]));
+                auto injector = std::make_unique<InjectorScreen>(wondercards[hid.fullIndex()]);
+                if (!injector->hasCard())
+                {
+                    Gui::warn("Could not read the wonder card data.");
+                    return;
+                }
+                Gui::setScreen(std::move(injector));
                 updateGifts = true;
                 return;
             }
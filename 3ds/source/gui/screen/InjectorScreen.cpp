@@ -46,8 +46,13 @@ bool InjectorScreen::setLanguage(pksm::Language language)
 {
     if (isLangAvailable(language))
     {
+        auto card = MysteryGift::wondercard((*ids)[i18n::langString(language)]);
+        if (!card)
+        {
+            return false;
+        }
         lang       = language;
-        wondercard = MysteryGift::wondercard((*ids)[i18n::langString(lang)]);
+        wondercard = std::move(card);
 
         wondercard->date(Configuration::getInstance().date());
     }
@@ -92,7 +97,10 @@ InjectorScreen::InjectorScreen(nlohmann::json myIds)
 
     makeButtons();
 
-    wondercard->date(Configuration::getInstance().date());
+    if (wondercard)
+    {
+        wondercard->date(Configuration::getInstance().date());
+    }
 }
 
 InjectorScreen::InjectorScreen(std::unique_ptr<pksm::WCX> wcx)
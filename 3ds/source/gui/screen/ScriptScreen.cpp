@@ -392,6 +392,8 @@ void ScriptScreen::parsePicoCScript(std::string& file)
         args[0]      = &version;
         PicocCallMain(picoc, NUM_ARGS, args);
     }
+    // Scripts can write anywhere in the save
+    TitleLoader::saveChanged();
 
     // Restore stdout state
     dup2(stdout_save, STDOUT_FILENO);
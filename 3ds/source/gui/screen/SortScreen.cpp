@@ -352,11 +352,11 @@ void SortScreen::sort()
         {
             for (size_t i = 0; i < sortMe.size(); i++)
             {
-                TitleLoader::save->pkm(*sortMe[i], i / 30, i % 30, false);
+                TitleLoader::setPkm(*sortMe[i], i / 30, i % 30, false);
             }
             for (int i = sortMe.size(); i < TitleLoader::save->maxSlot(); i++)
             {
-                TitleLoader::save->pkm(*TitleLoader::save->emptyPkm(), i / 30, i % 30, false);
+                TitleLoader::setPkm(*TitleLoader::save->emptyPkm(), i / 30, i % 30, false);
             }
         }
     }
@@ -119,7 +119,9 @@ StorageScreen::StorageScreen()
     : Screen(i18n::localize("A_PICKUP") + '\n' + i18n::localize("X_CLONE") + '\n' +
              i18n::localize("Y_CURSOR_MODE") + '\n' + i18n::localize("L_BOX_PREV") + '\n' +
              i18n::localize("R_BOX_NEXT") + '\n' + i18n::localize("START_EXTRA_FUNC") + '\n' +
-             i18n::localize("B_BACK"))
+             i18n::localize("B_BACK")),
+      saveCache([](int box, int slot) { return TitleLoader::save->pkm(box, slot); }),
+      bankCache([](int box, int slot) { return Banks::bank->pkm(box, slot); })
 {
     instructions.addBox(
         true, 69, 21, 156, 24, COLOR_GREY, i18n::localize("A_BOX_NAME"), COLOR_WHITE);
@@ -241,12 +243,15 @@ void StorageScreen::drawBottom() const
             }
             else
             {
-                std::unique_ptr<pksm::PKX> pokemon =
-                    TitleLoader::save->pkm(boxBox, row * 6 + column);
-                if (pokemon->species() != pksm::Species::None)
+                const pksm::PKX& pokemon =
+                    saveCache.pkm(boxBox, row * 6 + column, TitleLoader::saveRevision());
+                if (pokemon.species() != pksm::Species::None)
                 {
-                    float blend = *pokemon == *filter ? 0.0f : 0.5f;
-                    Gui::pkm(*pokemon, x, y, 1.0f, COLOR_BLACK, blend);
+                    float blend = saveCache.matchesFilter(boxBox, row * 6 + column,
+                                      TitleLoader::saveRevision(), *filter, Gui::inputRevision())
+                                      ? 0.0f
+                                      : 0.5f;
+                    Gui::pkm(pokemon, x, y, 1.0f, COLOR_BLACK, blend);
                 }
                 if (TitleLoader::save->generation() == pksm::Generation::LGPE)
                 {
@@ -379,11 +384,15 @@ void StorageScreen::drawTop() const
             {
                 Gui::drawSolidRect(x, y, 34, 30, COLOR_GREEN_HIGHLIGHT);
             }
-            auto pkm = Banks::bank->pkm(storageBox, row * 6 + column);
-            if (pkm->species() != pksm::Species::None)
+            const pksm::PKX& pkm =
+                bankCache.pkm(storageBox, row * 6 + column, Banks::bank->revision());
+            if (pkm.species() != pksm::Species::None)
             {
-                float blend = *pkm == *filter ? 0.0f : 0.5f;
-                Gui::pkm(*pkm, x, y, 1.0f, COLOR_BLACK, blend);
+                float blend = bankCache.matchesFilter(storageBox, row * 6 + column,
+                                  Banks::bank->revision(), *filter, Gui::inputRevision())
+                                  ? 0.0f
+                                  : 0.5f;
+                Gui::pkm(pkm, x, y, 1.0f, COLOR_BLACK, blend);
             }
         }
     }
@@ -885,7 +894,7 @@ bool StorageScreen::clearBox()
             }
             else if (boxBox * 30 + cursorIndex - 1 < TitleLoader::save->maxSlot())
             {
-                TitleLoader::save->pkm(*TitleLoader::save->emptyPkm(), boxBox, i, false);
+                TitleLoader::setPkm(*TitleLoader::save->emptyPkm(), boxBox, i, false);
             }
         }
     }
@@ -912,7 +921,7 @@ bool StorageScreen::releasePkm()
             }
             else if (boxBox * 30 + cursorIndex - 1 < TitleLoader::save->maxSlot())
             {
-                TitleLoader::save->pkm(
+                TitleLoader::setPkm(
                     *TitleLoader::save->emptyPkm(), boxBox, cursorIndex - 1, false);
                 if (TitleLoader::save->generation() == pksm::Generation::LGPE)
                 {
@@ -922,7 +931,7 @@ bool StorageScreen::releasePkm()
                         if (sav->partyBoxSlot(i) == boxBox * 30 + cursorIndex - 1)
                         {
                             sav->partyBoxSlot(i, 1001);
-                            sav->fixParty();
+                            TitleLoader::fixParty();
                         }
                     }
                 }
@@ -977,7 +986,7 @@ void StorageScreen::pickupSwap()
             }
         }
         moveMon.push_back(TitleLoader::save->pkm(boxBox, cursorIndex - 1));
-        TitleLoader::save->pkm(*TitleLoader::save->emptyPkm(), boxBox, cursorIndex - 1, false);
+        TitleLoader::setPkm(*TitleLoader::save->emptyPkm(), boxBox, cursorIndex - 1, false);
     }
     else
     {
@@ -1017,7 +1026,7 @@ void StorageScreen::pickupSingle()
             }
         }
         moveMon.push_back(TitleLoader::save->pkm(boxBox, cursorIndex - 1));
-        TitleLoader::save->pkm(*TitleLoader::save->emptyPkm(), boxBox, cursorIndex - 1, false);
+        TitleLoader::setPkm(*TitleLoader::save->emptyPkm(), boxBox, cursorIndex - 1, false);
     }
     else
     {
@@ -1104,9 +1113,9 @@ void StorageScreen::putDownSwap()
     }
     else if (!storageChosen && !fromStorage)
     {
-        TitleLoader::save->pkm(*TitleLoader::save->pkm(boxBox, cursorIndex - 1),
+        TitleLoader::setPkm(*TitleLoader::save->pkm(boxBox, cursorIndex - 1),
             selectDimensions.first, selectDimensions.second, false);
-        TitleLoader::save->pkm(*moveMon[0], boxBox, cursorIndex - 1, false);
+        TitleLoader::setPkm(*moveMon[0], boxBox, cursorIndex - 1, false);
         if (TitleLoader::save->generation() == pksm::Generation::LGPE)
         {
             pksm::SavLGPE* save = (pksm::SavLGPE*)TitleLoader::save.get();
@@ -1159,9 +1168,9 @@ void StorageScreen::putDownSwap()
                 if (partyNum[0] != -1)
                 {
                     ((pksm::SavLGPE*)TitleLoader::save.get())->partyBoxSlot(partyNum[0], 1001);
-                    TitleLoader::save->fixParty();
+                    TitleLoader::fixParty();
                 }
-                TitleLoader::save->pkm(*bankMon, selectDimensions.first, selectDimensions.second,
+                TitleLoader::setPkm(*bankMon, selectDimensions.first, selectDimensions.second,
                     Configuration::getInstance().transferEdit() && fromStorage);
                 TitleLoader::save->dex(*bankMon);
                 Banks::bank->pkm(*saveMon, storageBox, cursorIndex - 1);
@@ -1178,7 +1187,7 @@ void StorageScreen::putDownSwap()
                         break;
                     }
                 }
-                TitleLoader::save->pkm(*bankMon, boxBox, cursorIndex - 1,
+                TitleLoader::setPkm(*bankMon, boxBox, cursorIndex - 1,
                     Configuration::getInstance().transferEdit() && fromStorage);
                 TitleLoader::save->dex(*bankMon);
                 Banks::bank->pkm(*saveMon, selectDimensions.first, selectDimensions.second);
@@ -1263,7 +1272,7 @@ void StorageScreen::putDownNonSwap()
                 if (moveMon[index]->generation() == TitleLoader::save->generation() ||
                     acceptGenChange)
                 {
-                    TitleLoader::save->pkm(*TitleLoader::save->transfer(*moveMon[index]), boxBox,
+                    TitleLoader::setPkm(*TitleLoader::save->transfer(*moveMon[index]), boxBox,
                         cursorIndex - 1 + x + y * 6,
                         Configuration::getInstance().transferEdit() && fromStorage);
                     TitleLoader::save->dex(*moveMon[index]);
@@ -1483,7 +1492,7 @@ bool StorageScreen::swapBoxWithStorage()
                 if (temPkm->species() == pksm::Species::None || isValidTransfer(*temPkm, true))
                 {
                     std::unique_ptr<pksm::PKX> otherTemPkm = TitleLoader::save->pkm(boxBox, i);
-                    TitleLoader::save->pkm(
+                    TitleLoader::setPkm(
                         *temPkm, boxBox, i, Configuration::getInstance().transferEdit());
                     TitleLoader::save->dex(*temPkm);
                     Banks::bank->pkm(*otherTemPkm, storageBox, i);
@@ -1682,7 +1691,7 @@ void StorageScreen::grabSelection(bool remove)
                 }
                 if (remove)
                 {
-                    TitleLoader::save->pkm(
+                    TitleLoader::setPkm(
                         *TitleLoader::save->emptyPkm(), boxBox, pickupIndex, false);
                 }
             }
@@ -35,13 +35,33 @@
 
 namespace
 {
-    constexpr u64 MOVE_BUFFER_SIZE = 16 * 1024;
-
     constexpr FS_ExtSaveDataInfo PKSM_ARCHIVE_DATA = {MEDIATYPE_SD, 0, 0, UNIQUE_ID, 0};
 
     Archive sdArchive;
     Archive dataArchive;
 
+    class FileReader : public CopyEngine::Reader
+    {
+    public:
+        explicit FileReader(File& file) : mFile(file) {}
+        u32 read(u8* buf, u32 size) override { return mFile.read(buf, size); }
+        Result result() const override { return mFile.result(); }
+
+    private:
+        File& mFile;
+    };
+
+    class FileWriter : public CopyEngine::Writer
+    {
+    public:
+        explicit FileWriter(File& file) : mFile(file) {}
+        u32 write(const u8* buf, u32 size) override { return mFile.write(buf, size); }
+        Result result() const override { return mFile.result(); }
+
+    private:
+        File& mFile;
+    };
+
     void moveOldBackups()
     {
         STDirectory d("/3ds/PKSM/backup");
@@ -185,8 +205,8 @@ Archive& Archive::operator=(Archive&& other)
     return *this;
 }
 
-Result Archive::moveDir(
-    Archive& src, const std::u16string& dir, Archive& dst, const std::u16string& dest)
+Result Archive::moveDir(Archive& src, const std::u16string& dir, Archive& dst,
+    const std::u16string& dest, const CopyEngine::Progress& progress)
 {
     Result res;
 
@@ -206,52 +226,70 @@ Result Archive::moveDir(
     }
     else
     {
-        if (R_FAILED(res = dst.createDir(dest, 0)) && res != (long)0xC82044BE &&
-            res != (long)0xC82044B9)
-            return res;
-        auto d                = src.directory(dir);
-        std::u16string srcDir = dir.back() == u'/' ? dir : dir + u'/';
-        std::u16string dstDir = dest.back() == u'/' ? dest : dest + u'/';
-        if (d)
+        CopyEngine engine(progress, progress ? dirSize(src, dir) : 0);
+        return moveDir(src, dir, dst, dest, engine);
+    }
+}
+
+Result Archive::moveDir(Archive& src, const std::u16string& dir, Archive& dst,
+    const std::u16string& dest, CopyEngine& engine)
+{
+    Result res;
+    if (R_FAILED(res = dst.createDir(dest, 0)) && res != (long)0xC82044BE &&
+        res != (long)0xC82044B9)
+        return res;
+    auto d                = src.directory(dir);
+    std::u16string srcDir = dir.back() == u'/' ? dir : dir + u'/';
+    std::u16string dstDir = dest.back() == u'/' ? dest : dest + u'/';
+    if (d)
+    {
+        for (size_t i = 0; i < d->count(); i++)
         {
-            for (size_t i = 0; i < d->count(); i++)
+            if (d->folder(i))
             {
-                if (d->folder(i))
+                if (R_FAILED(res = moveDir(
+                                 src, srcDir + d->item(i), dst, dstDir + d->item(i), engine)))
                 {
-                    if (R_FAILED(res = moveDir(src, srcDir + d->item(i), dst, dstDir + d->item(i))))
-                    {
-                        dst.deleteDir(dest);
-                        return res;
-                    }
+                    dst.deleteDir(dest);
+                    return res;
                 }
-                else
+            }
+            else
+            {
+                std::u16string from = srcDir + d->item(i);
+                std::u16string to   = dstDir + d->item(i);
+                if (R_FAILED(res = moveFile(src, fsMakePath(PATH_UTF16, from.c_str()), dst,
+                                 fsMakePath(PATH_UTF16, to.c_str()), engine)))
                 {
-                    if (R_FAILED(
-                            res = moveFile(src, srcDir + d->item(i), dst, dstDir + d->item(i))))
-                    {
-                        dst.deleteDir(dest);
-                        return res;
-                    }
+                    dst.deleteDir(dest);
+                    return res;
                 }
             }
         }
-        else
-        {
-            dst.deleteDir(dest);
-            return src.result();
-        }
+    }
+    else
+    {
+        dst.deleteDir(dest);
+        return src.result();
+    }
 
-        res = src.deleteDir(dir);
+    res = src.deleteDir(dir);
 
-        if (res == (long)0xC82044BE || res == (long)0xC82044B9)
-            return 0;
+    if (res == (long)0xC82044BE || res == (long)0xC82044B9)
+        return 0;
 
-        return res;
-    }
+    return res;
+}
+
+Result Archive::copyDir(Archive& src, const std::u16string& dir, Archive& dst,
+    const std::u16string& dest, const CopyEngine::Progress& progress)
+{
+    CopyEngine engine(progress, progress ? dirSize(src, dir) : 0);
+    return copyDir(src, dir, dst, dest, engine);
 }
 
-Result Archive::copyDir(
-    Archive& src, const std::u16string& dir, Archive& dst, const std::u16string& dest)
+Result Archive::copyDir(Archive& src, const std::u16string& dir, Archive& dst,
+    const std::u16string& dest, CopyEngine& engine)
 {
     Result res;
     dst.deleteDir(dest);
@@ -267,7 +305,8 @@ Result Archive::copyDir(
         {
             if (d->folder(i))
             {
-                if (R_FAILED(res = copyDir(src, srcDir + d->item(i), dst, dstDir + d->item(i))))
+                if (R_FAILED(res = copyDir(
+                                 src, srcDir + d->item(i), dst, dstDir + d->item(i), engine)))
                 {
                     dst.deleteDir(dest);
                     return res;
@@ -275,7 +314,10 @@ Result Archive::copyDir(
             }
             else
             {
-                if (R_FAILED(res = copyFile(src, srcDir + d->item(i), dst, dstDir + d->item(i))))
+                std::u16string from = srcDir + d->item(i);
+                std::u16string to   = dstDir + d->item(i);
+                if (R_FAILED(res = copyFile(src, fsMakePath(PATH_UTF16, from.c_str()), dst,
+                                 fsMakePath(PATH_UTF16, to.c_str()), engine)))
                 {
                     dst.deleteDir(dest);
                     return res;
@@ -295,7 +337,30 @@ Result Archive::copyDir(
     return res;
 }
 
-Result Archive::moveFile(Archive& src, FS_Path file, Archive& dst, FS_Path dest)
+u64 Archive::dirSize(Archive& src, const std::u16string& dir)
+{
+    u64 ret               = 0;
+    auto d                = src.directory(dir);
+    std::u16string srcDir = dir.back() == u'/' ? dir : dir + u'/';
+    if (d)
+    {
+        for (size_t i = 0; i < d->count(); i++)
+        {
+            if (d->folder(i))
+            {
+                ret += dirSize(src, srcDir + d->item(i));
+            }
+            else if (auto stream = src.file(srcDir + d->item(i), FS_OPEN_READ))
+            {
+                ret += stream->size();
+            }
+        }
+    }
+    return ret;
+}
+
+Result Archive::moveFile(
+    Archive& src, FS_Path file, Archive& dst, FS_Path dest, const CopyEngine::Progress& progress)
 {
     Result res;
 
@@ -313,54 +378,29 @@ Result Archive::moveFile(Archive& src, FS_Path file, Archive& dst, FS_Path dest)
     }
     else
     {
-        auto stream = src.file(file, FS_OPEN_READ);
-        if (stream)
-        {
-            u64 target = stream->size();
-            res        = dst.createFile(dest, 0, target);
-            auto out   = dst.file(dest, FS_OPEN_WRITE);
-            if (out)
-            {
-                size_t written = 0;
-                u8* data       = new u8[MOVE_BUFFER_SIZE];
-                while (written < target)
-                {
-                    stream->read(data, std::min(MOVE_BUFFER_SIZE, target - written));
-                    if (R_FAILED(res = stream->result()))
-                    {
-                        break;
-                    }
-                    written += out->write(data, std::min(MOVE_BUFFER_SIZE, target - written));
-                    if (R_FAILED(res = out->result()))
-                    {
-                        break;
-                    }
-                }
-                stream->close();
-                out->close();
-                delete[] data;
-                if (R_SUCCEEDED(res))
-                {
-                    src.deleteFile(file);
-                }
-            }
-            else
-            {
-                res = dst.result();
-                dst.deleteFile(dest);
-                stream->close();
-            }
-        }
-        else
-        {
-            dst.deleteFile(dest);
-            res = src.result();
-        }
-        return res;
+        CopyEngine engine(progress);
+        return moveFile(src, file, dst, dest, engine);
     }
 }
 
-Result Archive::copyFile(Archive& src, FS_Path file, Archive& dst, FS_Path dest)
+Result Archive::moveFile(Archive& src, FS_Path file, Archive& dst, FS_Path dest, CopyEngine& engine)
+{
+    Result res = copyFile(src, file, dst, dest, engine);
+    if (R_SUCCEEDED(res))
+    {
+        src.deleteFile(file);
+    }
+    return res;
+}
+
+Result Archive::copyFile(
+    Archive& src, FS_Path file, Archive& dst, FS_Path dest, const CopyEngine::Progress& progress)
+{
+    CopyEngine engine(progress);
+    return copyFile(src, file, dst, dest, engine);
+}
+
+Result Archive::copyFile(Archive& src, FS_Path file, Archive& dst, FS_Path dest, CopyEngine& engine)
 {
     Result res  = 0;
     auto stream = src.file(file, FS_OPEN_READ);
@@ -372,24 +412,11 @@ Result Archive::copyFile(Archive& src, FS_Path file, Archive& dst, FS_Path dest)
         auto out = dst.file(dest, FS_OPEN_WRITE);
         if (out)
         {
-            size_t written = 0;
-            u8* data       = new u8[MOVE_BUFFER_SIZE];
-            while (written < target)
-            {
-                stream->read(data, std::min(MOVE_BUFFER_SIZE, target - written));
-                if (R_FAILED(res = stream->result()))
-                {
-                    break;
-                }
-                written += out->write(data, std::min(MOVE_BUFFER_SIZE, target - written));
-                if (R_FAILED(res = out->result()))
-                {
-                    break;
-                }
-            }
+            FileReader reader(*stream);
+            FileWriter writer(*out);
+            res = engine.copy(reader, writer, target);
             stream->close();
             out->close();
-            delete[] data;
         }
         else
         {
@@ -383,7 +383,7 @@ void sav_inject_pkx(
         else
         {
             pkm->refreshChecksum();
-            TitleLoader::save->pkm(*pkm, box, slot, doTradeEdits);
+            TitleLoader::setPkm(*pkm, box, slot, doTradeEdits);
             TitleLoader::save->dex(*pkm);
         }
     }
@@ -769,8 +769,8 @@ void party_inject_pkx(
         else
         {
             pkm->refreshChecksum();
-            TitleLoader::save->pkm(*pkm, slot);
-            TitleLoader::save->fixParty();
+            TitleLoader::setPkm(*pkm, slot);
+            TitleLoader::fixParty();
             TitleLoader::save->dex(*pkm);
         }
     }
@@ -27,13 +27,16 @@
 #include "sound.hpp"
 #include "Configuration.hpp"
 #include "Decoder.hpp"
+#include "PcmRing.hpp"
 #include "STDirectory.hpp"
 #include "io.hpp"
 #include "random.hpp"
 #include "thread.hpp"
 #include <3ds.h>
+#include <algorithm>
 #include <atomic>
 #include <unordered_map>
+#include <vector>
 
 namespace
 {
@@ -48,12 +51,56 @@ namespace
     std::atomic_flag occupiedChannels[NUM_CHANNELS];
     LightEvent frameEvent;
 
-    std::unordered_map<std::string, std::string> effects; // effect name to file name
+    // Background music is decoded ahead of time on its own thread, so that a slow read from the SD
+    // card holds up the decoder instead of playback. The ring is in linear memory, so the sound
+    // thread hands finished blocks to NDSP as they are and only frees them once they've played
+    std::unique_ptr<PcmRing> bgmRing;
+    // One wave buffer per block of the ring
+    std::vector<ndspWaveBuf> bgmBuffers;
+    // How many blocks at the front of the ring are queued on channel 0. Only touched by the sound
+    // thread
+    size_t bgmQueued = 0;
+    // Signalled whenever a block is freed up for the decode thread
+    LightEvent bgmSpaceEvent;
+    // Bumped by the sound thread to skip the song the decode thread is on
+    std::atomic<u32> bgmTrack = 0;
+    // Whether a song is going on channel 0. Only touched by the sound thread
+    bool bgmActive = false;
+    bool bgmDry    = false;
+
+    // Effects are decoded in full when they're registered, as long as they fit in the pool, and
+    // played straight out of it. Any that don't fit are streamed from the SD card like music
+    constexpr size_t EFFECT_POOL_SIZE    = 512 * 1024;
+    constexpr size_t MAX_PENDING_EFFECTS = 8;
+    struct Effect
+    {
+        std::string fileName;
+        // Linear memory so that NDSP can read it directly. nullptr if not loaded
+        s16* pcm       = nullptr;
+        u32 samples    = 0;
+        u32 sampleRate = 0;
+        bool stereo    = false;
+        u32 lastUsed   = 0;
+        // How many channels are playing from pcm right now
+        std::atomic<u8> users = 0;
+    };
+    std::unordered_map<std::string, Effect> effects; // effect name to effect
+    size_t effectPoolUsed = 0;
+    u32 effectClock       = 0;
+    // Held while freeing effect memory and while starting voices, so nothing is freed mid-start
+    LightLock effectLock;
+    // Effects waiting for the sound thread to give them a channel
+    std::array<std::atomic<Effect*>, MAX_PENDING_EFFECTS> pendingEffects;
+    // Wave buffers for loaded effects, one per channel, and the effect each one is playing
+    std::array<ndspWaveBuf, NUM_CHANNELS> voices;
+    std::array<Effect*, NUM_CHANNELS> voiceEffects;
     std::vector<std::string> bgm;
-    size_t currentSong         = 0;
-    std::atomic<bool> playing  = false;
-    std::atomic<bool> finished = true;
-    u8 currentVolume           = 0;
+    std::atomic<size_t> songCount    = 0;
+    size_t currentSong               = 0;
+    std::atomic<bool> playing        = false;
+    std::atomic<bool> finished       = true;
+    std::atomic<bool> decodeFinished = true;
+    u8 currentVolume                 = 0;
 
     void ndspFrameCallback(void*)
     {
@@ -137,11 +184,236 @@ namespace
             if (!(ret && ret->good()))
             {
                 bgm.erase(bgm.begin() + currentSong);
+                songCount = bgm.size();
             }
         }
         return ret;
     }
 
+    void decodeThread(void*)
+    {
+        std::unique_ptr<Decoder> decoder = nullptr;
+        u32 track                        = bgmTrack;
+        bool first                       = true;
+        while (playing)
+        {
+            if (track != bgmTrack)
+            {
+                track   = bgmTrack;
+                decoder = nullptr;
+            }
+            if (!decoder)
+            {
+                decoder = getNextBgm();
+                first   = true;
+                // Every song failed to load
+                if (!decoder)
+                {
+                    break;
+                }
+            }
+
+            PcmRing::Block* block = bgmRing->back();
+            if (!block)
+            {
+                LightEvent_Wait(&bgmSpaceEvent);
+                continue;
+            }
+
+            block->samples = decoder->decode(block->data, bgmRing->blockSize());
+            if (block->samples == 0)
+            {
+                decoder = nullptr;
+                continue;
+            }
+            block->sampleRate = decoder->sampleRate();
+            block->stereo     = decoder->stereo();
+            block->track      = track;
+            block->first      = first;
+            first             = false;
+            bgmRing->push();
+        }
+        decoder        = nullptr;
+        decodeFinished = true;
+    }
+
+    void stopBgm()
+    {
+        ndspChnWaveBufClear(0);
+        // Nothing is playing from the queued blocks anymore, so they can go back to the decoder
+        for (; bgmQueued > 0; bgmQueued--)
+        {
+            bgmRing->pop();
+        }
+        LightEvent_Signal(&bgmSpaceEvent);
+        bgmActive = false;
+    }
+
+    void fillBgm()
+    {
+        // Free the blocks NDSP has finished with. They finish in the order they were queued
+        while (bgmQueued > 0 &&
+               bgmBuffers[bgmRing->index(bgmRing->front())].status == NDSP_WBUF_DONE)
+        {
+            bgmRing->pop();
+            bgmQueued--;
+            LightEvent_Signal(&bgmSpaceEvent);
+        }
+
+        while (bgmQueued < BUFFERS_PER_CHANNEL)
+        {
+            PcmRing::Block* block = bgmRing->peek(bgmQueued);
+            if (!block)
+            {
+                // Only counted once per gap in playback
+                if (bgmActive && !bgmDry && !ndspChnIsPlaying(0))
+                {
+                    bgmRing->underrun();
+                    bgmDry = true;
+                }
+                break;
+            }
+            // Anything still in the ring from a skipped song is thrown away. Skipping clears the
+            // channel, so these are always at the front
+            if (block->track != bgmTrack)
+            {
+                if (bgmQueued > 0)
+                {
+                    break;
+                }
+                bgmRing->pop();
+                LightEvent_Signal(&bgmSpaceEvent);
+                continue;
+            }
+
+            if (block->first)
+            {
+                // Let the last song finish before the channel is set up for the next one
+                if (bgmQueued > 0 || (bgmActive && ndspChnIsPlaying(0)))
+                {
+                    break;
+                }
+                ndspChnReset(0);
+                ndspChnSetInterp(0, block->stereo ? NDSP_INTERP_POLYPHASE : NDSP_INTERP_LINEAR);
+                ndspChnSetRate(0, block->sampleRate);
+                ndspChnSetFormat(
+                    0, block->stereo ? NDSP_FORMAT_STEREO_PCM16 : NDSP_FORMAT_MONO_PCM16);
+                block->first = false;
+                bgmActive    = true;
+            }
+
+            ndspWaveBuf& buffer = bgmBuffers[bgmRing->index(block)];
+            buffer.data_pcm16   = block->data;
+            // Correct size for stereo mode
+            buffer.nsamples = block->stereo ? block->samples / 2 : block->samples;
+            buffer.looping  = false;
+            buffer.status   = NDSP_WBUF_DONE;
+            DSP_FlushDataCache(block->data, block->samples * sizeof(s16));
+            ndspChnWaveBufAdd(0, &buffer);
+            bgmQueued++;
+            bgmDry = false;
+        }
+    }
+
+    void startEffects()
+    {
+        LightLock_Lock(&effectLock);
+        for (auto& pending : pendingEffects)
+        {
+            Effect* effect = pending.exchange(nullptr);
+            // It may have been pushed out of the pool since it was asked for
+            if (!effect || !effect->pcm)
+            {
+                continue;
+            }
+            // First channel is reserved for BGM
+            for (size_t channel = 1; channel < NUM_CHANNELS; channel++)
+            {
+                if (!occupiedChannels[channel].test_and_set())
+                {
+                    ndspChnReset(channel);
+                    ndspChnSetInterp(
+                        channel, effect->stereo ? NDSP_INTERP_POLYPHASE : NDSP_INTERP_LINEAR);
+                    ndspChnSetRate(channel, effect->sampleRate);
+                    ndspChnSetFormat(channel,
+                        effect->stereo ? NDSP_FORMAT_STEREO_PCM16 : NDSP_FORMAT_MONO_PCM16);
+                    voices[channel].data_pcm16 = effect->pcm;
+                    voices[channel].nsamples =
+                        effect->stereo ? effect->samples / 2 : effect->samples;
+                    voices[channel].looping = false;
+                    voices[channel].status  = NDSP_WBUF_DONE;
+                    voiceEffects[channel]   = effect;
+                    effect->users++;
+                    ndspChnWaveBufAdd(channel, &voices[channel]);
+                    break;
+                }
+            }
+        }
+        LightLock_Unlock(&effectLock);
+    }
+
+    // Frees the least recently played effects not currently playing until size more bytes fit
+    bool makeEffectRoom(size_t size)
+    {
+        while (effectPoolUsed + size > EFFECT_POOL_SIZE)
+        {
+            Effect* oldest = nullptr;
+            for (auto& [name, effect] : effects)
+            {
+                if (effect.pcm && effect.users == 0 &&
+                    (!oldest || effect.lastUsed < oldest->lastUsed))
+                {
+                    oldest = &effect;
+                }
+            }
+            if (!oldest)
+            {
+                return false;
+            }
+            effectPoolUsed -= oldest->samples * sizeof(s16);
+            linearFree(oldest->pcm);
+            oldest->pcm = nullptr;
+        }
+        return true;
+    }
+
+    void loadEffect(Effect& effect, Decoder& decoder)
+    {
+        // Anything that would take up more than half of the pool is left to be streamed
+        std::vector<s16> pcm(EFFECT_POOL_SIZE / 2 / sizeof(s16));
+        u32 samples = 0;
+        u32 decoded;
+        do
+        {
+            decoded = decoder.decode(pcm.data() + samples, (pcm.size() - samples) * sizeof(s16));
+            samples += decoded;
+            if (samples == pcm.size())
+            {
+                return;
+            }
+        } while (decoded > 0);
+        if (samples == 0)
+        {
+            return;
+        }
+
+        LightLock_Lock(&effectLock);
+        if (makeEffectRoom(samples * sizeof(s16)))
+        {
+            effect.pcm = (s16*)linearAlloc(samples * sizeof(s16));
+            if (effect.pcm)
+            {
+                std::copy(pcm.begin(), pcm.begin() + samples, effect.pcm);
+                DSP_FlushDataCache(effect.pcm, samples * sizeof(s16));
+                effect.samples    = samples;
+                effect.sampleRate = decoder.sampleRate();
+                effect.stereo     = decoder.stereo();
+                effectPoolUsed += samples * sizeof(s16);
+            }
+        }
+        LightLock_Unlock(&effectLock);
+    }
+
     void soundThread(void*)
     {
         finished = false;
@@ -150,19 +422,16 @@ namespace
             // Get volume for later usage
             HIDUSER_GetSoundVolume(&currentVolume);
             // Explicitly do the BGM channel with its special handling:
-            // Replace the song if the volume slider is pushed all the way down and we haven't
-            // already replaced it or the decoder is gone and the channel is done or paused
-            bool replaceBGM = (currentVolume == 0 && bgm.size() > 1 && !ndspChnIsPaused(0)) ||
-                              (!decoders[0] && (!ndspChnIsPlaying(0) || ndspChnIsPaused(0)));
-            // If the decoder still exists and we're not about to replace it, fill the buffers
-            if (!replaceBGM && decoders[0])
+            // Skip the song if the volume slider is pushed all the way down and we haven't
+            // already skipped it
+            if (currentVolume == 0 && songCount > 1 && !ndspChnIsPaused(0) && bgmRing)
             {
-                fillBuffers(0, decoders[0]);
+                bgmTrack++;
+                stopBgm();
             }
-            // Otherwise, if there's anything to replace it with, then do so
-            else if (!bgm.empty())
+            else if (bgmRing)
             {
-                setDecoder(0, getNextBgm());
+                fillBgm();
             }
 
             // Pause the song if the volume slider is all the way down
@@ -184,12 +453,20 @@ namespace
                     fillBuffers(channel, decoders[channel]);
                 }
                 // Otherwise, once it's done playing, add the channel back into the pool
-                else if (!ndspChnIsPlaying(channel))
+                else if (!ndspChnIsPlaying(channel) && voices[channel].status != NDSP_WBUF_QUEUED &&
+                         voices[channel].status != NDSP_WBUF_PLAYING)
                 {
+                    if (voiceEffects[channel])
+                    {
+                        voiceEffects[channel]->users--;
+                        voiceEffects[channel] = nullptr;
+                    }
                     occupiedChannels[channel].clear();
                 }
             }
 
+            startEffects();
+
             LightEvent_Wait(&frameEvent);
         }
         finished = true;
@@ -199,6 +476,12 @@ namespace
 Result Sound::init()
 {
     LightEvent_Init(&frameEvent, RESET_ONESHOT);
+    LightEvent_Init(&bgmSpaceEvent, RESET_ONESHOT);
+    LightLock_Init(&effectLock);
+    for (auto& voice : voices)
+    {
+        voice.status = NDSP_WBUF_DONE;
+    }
     STDirectory dir("/3ds/PKSM/songs");
     if (dir.good())
     {
@@ -214,6 +497,7 @@ Result Sound::init()
             }
         }
     }
+    songCount = bgm.size();
     Result res = ndspInit();
     ndspSetCallback(ndspFrameCallback, nullptr);
     if (R_FAILED(res))
@@ -240,9 +524,11 @@ void Sound::registerEffect(const std::string& effectName, const std::string& fil
     if (io::exists(fileName))
     {
         auto dec = Decoder::get(fileName);
-        if (dec && dec->good())
+        if (dec && dec->good() && !effects.contains(effectName))
         {
-            effects.emplace(effectName, fileName);
+            Effect& effect  = effects[effectName];
+            effect.fileName = fileName;
+            loadEffect(effect, *dec);
         }
     }
 }
@@ -250,6 +536,12 @@ void Sound::registerEffect(const std::string& effectName, const std::string& fil
 void Sound::exit()
 {
     stop();
+    for (auto& [name, effect] : effects)
+    {
+        linearFree(effect.pcm);
+        effect.pcm = nullptr;
+    }
+    effectPoolUsed = 0;
     linearFree(bufferMem);
     ndspExit();
 }
@@ -257,6 +549,29 @@ void Sound::exit()
 void Sound::start()
 {
     playing = true;
+    if (!bgm.empty())
+    {
+        size_t lookahead = std::clamp(Configuration::getInstance().musicLookahead(), 2, 32);
+        // The blocks queued on the channel are on top of the ones decoded ahead
+        bgmRing = std::make_unique<PcmRing>(
+            lookahead + BUFFERS_PER_CHANNEL, BUFFER_SIZE, linearAlloc, linearFree);
+        if (bgmRing->good())
+        {
+            bgmBuffers.assign(bgmRing->capacity(), ndspWaveBuf{});
+            bgmQueued = 0;
+            bgmActive = false;
+            stopBgm();
+            decodeFinished = false;
+            if (!Threads::create(&decodeThread, nullptr, 16 * 1024))
+            {
+                decodeFinished = true;
+            }
+        }
+        else
+        {
+            bgmRing = nullptr;
+        }
+    }
     Threads::create(&soundThread, nullptr, 16 * 1024);
 }
 
@@ -265,9 +580,10 @@ void Sound::stop()
     if (playing)
     {
         playing = false;
-        // Signal and wait for sound thread to end
+        // Signal and wait for sound and decode threads to end
         LightEvent_Signal(&frameEvent);
-        while (!finished)
+        LightEvent_Signal(&bgmSpaceEvent);
+        while (!finished || !decodeFinished)
         {
             svcSleepThread(125000000);
         }
@@ -278,6 +594,11 @@ void Sound::stop()
     }
 }
 
+u32 Sound::underruns()
+{
+    return bgmRing ? bgmRing->underruns() : 0;
+}
+
 void Sound::playEffect(const std::string& effectName)
 {
     if (currentVolume > 0)
@@ -285,7 +606,22 @@ void Sound::playEffect(const std::string& effectName)
         auto effect = effects.find(effectName);
         if (effect != effects.end())
         {
-            auto decoder = Decoder::get(effect->second);
+            effect->second.lastUsed = ++effectClock;
+            // Loaded effects are started by the sound thread on its next frame
+            if (effect->second.pcm)
+            {
+                for (auto& pending : pendingEffects)
+                {
+                    Effect* expected = nullptr;
+                    if (pending.compare_exchange_strong(expected, &effect->second))
+                    {
+                        break;
+                    }
+                }
+                return;
+            }
+
+            auto decoder = Decoder::get(effect->second.fileName);
             if (decoder && decoder->good())
             {
                 // First channel is reserved for BGM
@@ -0,0 +1,295 @@
+/*
+ *   This file is part of PKSM
+ *   Copyright (C) 2016-2021 Bernardo Giordano, Admiral Fish, piepie62
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *   Additional Terms 7.b and 7.c of GPLv3 apply to this file:
+ *       * Requiring preservation of specified reasonable legal notices or
+ *         author attributions in that material or in the Appropriate Legal
+ *         Notices displayed by works containing it.
+ *       * Prohibiting misrepresentation of the origin of that material,
+ *         or requiring that modified versions of such material be marked in
+ *         reasonable ways as different from the original version.
+ */
+
+#include "IconAtlas.hpp"
+#include "Swizzle.hpp"
+#include <array>
+#include <cstring>
+#include <mutex>
+
+#define ICON_CACHE_PATH "/3ds/PKSM/iconcache.bin"
+
+namespace
+{
+    constexpr u16 ATLAS_WIDTH    = 512;
+    constexpr u16 ATLAS_HEIGHT   = 256;
+    constexpr u16 SLOT_SIZE      = 48;
+    constexpr size_t COLUMNS     = ATLAS_WIDTH / SLOT_SIZE;
+    constexpr size_t SLOTS       = COLUMNS * (ATLAS_HEIGHT / SLOT_SIZE);
+    constexpr size_t MAX_CACHED  = 64;
+    constexpr char CACHE_MAGIC[] = "PKSMICO1";
+
+    struct Slot
+    {
+        u64 key;
+        u32 revision;
+        // 0 if free. A free slot keeps its icon in case the same one is placed again
+        u32 refs  = 0;
+        bool used = false;
+        Tex3DS_SubTexture subtex;
+    };
+
+    struct CacheEntry
+    {
+        u64 key;
+        u32 revision;
+        IconAtlas::Icon icon;
+    };
+
+    std::mutex atlasLock;
+    C3D_Tex* atlas = nullptr;
+    std::array<Slot, SLOTS> slots;
+
+    std::mutex cacheLock;
+    bool cacheLoaded = false;
+    bool cacheDirty  = false;
+    // Oldest first, so the front is what goes when there are too many
+    std::vector<CacheEntry> cacheEntries;
+
+    template <typename T>
+    bool readValue(FILE* in, T& value)
+    {
+        return fread(&value, sizeof(T), 1, in) == 1;
+    }
+
+    template <typename T>
+    void writeValue(FILE* out, const T& value)
+    {
+        fwrite(&value, sizeof(T), 1, out);
+    }
+
+    void loadCache()
+    {
+        cacheLoaded = true;
+        FILE* in    = fopen(ICON_CACHE_PATH, "rb");
+        if (!in)
+        {
+            return;
+        }
+
+        char magic[sizeof(CACHE_MAGIC) - 1];
+        u32 count;
+        bool good = fread(magic, 1, sizeof(magic), in) == sizeof(magic) &&
+                    std::memcmp(magic, CACHE_MAGIC, sizeof(magic)) == 0 && readValue(in, count) &&
+                    count <= MAX_CACHED;
+        for (u32 i = 0; good && i < count; i++)
+        {
+            CacheEntry entry;
+            u16 nameSize;
+            good = readValue(in, entry.key) && readValue(in, entry.revision) &&
+                   readValue(in, entry.icon.width) && readValue(in, entry.icon.height) &&
+                   readValue(in, nameSize) && entry.icon.width <= SLOT_SIZE &&
+                   entry.icon.height <= SLOT_SIZE && entry.icon.width % 8 == 0 &&
+                   entry.icon.height % 8 == 0;
+            if (good)
+            {
+                entry.icon.name.resize(nameSize);
+                entry.icon.pixels.resize(entry.icon.width * entry.icon.height);
+                good = fread(entry.icon.name.data(), 1, nameSize, in) == nameSize &&
+                       fread(entry.icon.pixels.data(), sizeof(u16), entry.icon.pixels.size(),
+                           in) == entry.icon.pixels.size();
+            }
+            if (good)
+            {
+                cacheEntries.emplace_back(std::move(entry));
+            }
+        }
+        fclose(in);
+
+        if (!good)
+        {
+            cacheEntries.clear();
+        }
+    }
+
+    void saveCache()
+    {
+        FILE* out = fopen(ICON_CACHE_PATH, "wb");
+        if (!out)
+        {
+            return;
+        }
+        fwrite(CACHE_MAGIC, 1, sizeof(CACHE_MAGIC) - 1, out);
+        writeValue(out, (u32)cacheEntries.size());
+        for (const auto& entry : cacheEntries)
+        {
+            writeValue(out, entry.key);
+            writeValue(out, entry.revision);
+            writeValue(out, entry.icon.width);
+            writeValue(out, entry.icon.height);
+            writeValue(out, (u16)entry.icon.name.size());
+            fwrite(entry.icon.name.data(), 1, entry.icon.name.size(), out);
+            fwrite(entry.icon.pixels.data(), sizeof(u16), entry.icon.pixels.size(), out);
+        }
+        fclose(out);
+    }
+
+    C2D_Image slotImage(Slot& slot)
+    {
+        return C2D_Image{atlas, &slot.subtex};
+    }
+}
+
+u64 IconAtlas::dsKey(const std::string& gameCode)
+{
+    // No title ID has all of its high bits set
+    u64 ret = 0xFFFFFFFF00000000;
+    for (size_t i = 0; i < 4 && i < gameCode.size(); i++)
+    {
+        ret |= u64((u8)gameCode[i]) << (i * 8);
+    }
+    return ret;
+}
+
+std::optional<IconAtlas::Icon> IconAtlas::cached(u64 key, u32 revision)
+{
+    std::lock_guard<std::mutex> lock(cacheLock);
+    if (!cacheLoaded)
+    {
+        loadCache();
+    }
+    for (const auto& entry : cacheEntries)
+    {
+        if (entry.key == key && entry.revision == revision)
+        {
+            return entry.icon;
+        }
+    }
+    return std::nullopt;
+}
+
+void IconAtlas::cache(u64 key, u32 revision, const Icon& icon)
+{
+    std::lock_guard<std::mutex> lock(cacheLock);
+    if (!cacheLoaded)
+    {
+        loadCache();
+    }
+    // Only one revision of each icon is worth keeping
+    std::erase_if(cacheEntries, [key](const CacheEntry& entry) { return entry.key == key; });
+    if (cacheEntries.size() >= MAX_CACHED)
+    {
+        cacheEntries.erase(cacheEntries.begin());
+    }
+    cacheEntries.emplace_back(CacheEntry{key, revision, icon});
+    cacheDirty = true;
+}
+
+void IconAtlas::flush()
+{
+    std::lock_guard<std::mutex> lock(cacheLock);
+    if (cacheDirty)
+    {
+        saveCache();
+        cacheDirty = false;
+    }
+}
+
+std::optional<C2D_Image> IconAtlas::place(u64 key, u32 revision, const Icon& icon)
+{
+    if (icon.width > SLOT_SIZE || icon.height > SLOT_SIZE)
+    {
+        return std::nullopt;
+    }
+
+    std::lock_guard<std::mutex> lock(atlasLock);
+    for (auto& slot : slots)
+    {
+        if (slot.used && slot.key == key && slot.revision == revision &&
+            slot.subtex.width == icon.width && slot.subtex.height == icon.height)
+        {
+            slot.refs++;
+            return slotImage(slot);
+        }
+    }
+
+    // Prefer slots that have never been used so that freed icons stay around longer
+    Slot* target = nullptr;
+    for (auto& slot : slots)
+    {
+        if (!slot.used)
+        {
+            target = &slot;
+            break;
+        }
+        else if (slot.refs == 0 && !target)
+        {
+            target = &slot;
+        }
+    }
+    if (!target)
+    {
+        return std::nullopt;
+    }
+
+    if (!atlas)
+    {
+        atlas = new C3D_Tex;
+        if (!C3D_TexInit(atlas, ATLAS_WIDTH, ATLAS_HEIGHT, GPU_RGB565))
+        {
+            delete atlas;
+            atlas = nullptr;
+            return std::nullopt;
+        }
+        atlas->border = 0xFFFFFFFF;
+        C3D_TexSetWrap(atlas, GPU_CLAMP_TO_BORDER, GPU_CLAMP_TO_BORDER);
+    }
+
+    const size_t index = target - slots.data();
+    const u16 x        = (index % COLUMNS) * SLOT_SIZE;
+    const u16 y        = (index / COLUMNS) * SLOT_SIZE;
+    Swizzle::blit(
+        icon.pixels.data(), icon.width, icon.height, (u16*)atlas->data, ATLAS_WIDTH, x, y);
+    C3D_TexFlush(atlas);
+
+    // Texture rows go from the top down, but t goes from the bottom up
+    target->subtex   = {icon.width, icon.height, float(x) / ATLAS_WIDTH,
+        1.0f - float(y) / ATLAS_HEIGHT, float(x + icon.width) / ATLAS_WIDTH,
+        1.0f - float(y + icon.height) / ATLAS_HEIGHT};
+    target->key      = key;
+    target->revision = revision;
+    target->refs     = 1;
+    target->used     = true;
+    return slotImage(*target);
+}
+
+bool IconAtlas::release(const C2D_Image& image)
+{
+    std::lock_guard<std::mutex> lock(atlasLock);
+    if (!atlas || image.tex != atlas)
+    {
+        return false;
+    }
+    for (auto& slot : slots)
+    {
+        if (&slot.subtex == image.subtex && slot.refs > 0)
+        {
+            slot.refs--;
+            break;
+        }
+    }
+    return true;
+}
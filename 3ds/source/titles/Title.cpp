@@ -26,14 +26,13 @@
 
 #include "Title.hpp"
 #include "Archive.hpp"
+#include "IconAtlas.hpp"
+#include "Swizzle.hpp"
 #include "format.h"
 #include "smdh.hpp"
 
-// Allocate once because threading shenanigans
 namespace
 {
-    constexpr Tex3DS_SubTexture dsIconSubt3x = {32, 32, 0.0f, 1.0f, 1.0f, 0.0f};
-    C2D_Image dsIcon                         = {nullptr, &dsIconSubt3x};
     struct bannerData
     {
         u16 version;
@@ -48,67 +47,37 @@ namespace
         u16 dsiSequence[64];
     };
 
-    void loadDSIcon(bannerData* iconData)
+    // Only used if the atlas is full
+    C2D_Image loadTextureIcon(const IconAtlas::Icon& icon)
     {
-        static constexpr int WIDTH_POW2  = 32;
-        static constexpr int HEIGHT_POW2 = 32;
-        if (!dsIcon.tex)
-        {
-            dsIcon.tex = new C3D_Tex;
-            C3D_TexInit(dsIcon.tex, WIDTH_POW2, HEIGHT_POW2, GPU_RGB565);
-            dsIcon.tex->border = 0xFFFFFFFF;
-            C3D_TexSetWrap(dsIcon.tex, GPU_CLAMP_TO_BORDER, GPU_CLAMP_TO_BORDER);
-        }
-
-        u16* output = (u16*)dsIcon.tex->data;
-        for (size_t x = 0; x < 32; x++)
-        {
-            for (size_t y = 0; y < 32; y++)
-            {
-                u32 srcOff   = (((y >> 3) * 4 + (x >> 3)) * 8 + (y & 7)) * 4 + ((x & 7) >> 1);
-                u32 srcShift = (x & 1) * 4;
-
-                u16 pIndex = (iconData->data[srcOff] >> srcShift) & 0xF;
-                u16 color  = 0xFFFF;
-                if (pIndex != 0)
-                {
-                    u16 r = iconData->palette[pIndex] & 0x1F;
-                    u16 g = (iconData->palette[pIndex] >> 5) & 0x1F;
-                    u16 b = (iconData->palette[pIndex] >> 10) & 0x1F;
-                    color = (r << 11) | (g << 6) | (g >> 4) | (b);
-                }
+        static constexpr Tex3DS_SubTexture subt3x48 = {48, 48, 0.0f, 48 / 64.0f, 48 / 64.0f, 0.0f};
+        static constexpr Tex3DS_SubTexture subt3x32 = {32, 32, 0.0f, 1.0f, 1.0f, 0.0f};
+        const u16 size                              = icon.width > 32 ? 64 : 32;
 
-                u32 dst     = ((((y >> 3) * (WIDTH_POW2 >> 3) + (x >> 3)) << 6) +
-                           ((x & 1) | ((y & 1) << 1) | ((x & 2) << 1) | ((y & 2) << 2) |
-                               ((x & 4) << 2) | ((y & 4) << 3)));
-                output[dst] = color;
-            }
-        }
-    }
-    C2D_Image loadTextureIcon(smdh_s* smdh)
-    {
-        C3D_Tex* tex                              = new C3D_Tex;
-        static constexpr Tex3DS_SubTexture subt3x = {48, 48, 0.0f, 48 / 64.0f, 48 / 64.0f, 0.0f};
-        C3D_TexInit(tex, 64, 64, GPU_RGB565);
+        C3D_Tex* tex = new C3D_Tex;
+        C3D_TexInit(tex, size, size, GPU_RGB565);
         tex->border = 0xFFFFFFFF;
         C3D_TexSetWrap(tex, GPU_CLAMP_TO_BORDER, GPU_CLAMP_TO_BORDER);
+        Swizzle::blit(icon.pixels.data(), icon.width, icon.height, (u16*)tex->data, size, 0,
+            size - icon.height);
+        C3D_TexFlush(tex);
 
-        u16* dest = (u16*)tex->data + (64 - 48) * 64;
-        u16* src  = (u16*)smdh->bigIconData;
-        for (int j = 0; j < 48; j += 8)
+        return C2D_Image{tex, size == 64 ? &subt3x48 : &subt3x32};
+    }
+
+    C2D_Image loadIcon(u64 key, u32 revision, const IconAtlas::Icon& icon)
+    {
+        if (auto image = IconAtlas::place(key, revision, icon))
         {
-            std::copy(src, src + 48 * 8, dest);
-            src += 48 * 8;
-            dest += 64 * 8;
+            return *image;
         }
-
-        return C2D_Image{tex, &subt3x};
+        return loadTextureIcon(icon);
     }
 }
 
 Title::~Title(void)
 {
-    if (mIcon.tex && mIcon.tex != dsIcon.tex)
+    if (mIcon.tex && !IconAtlas::release(mIcon))
     {
         C3D_TexDelete(mIcon.tex);
         delete mIcon.tex;
@@ -124,20 +93,39 @@ bool Title::load(u64 id, FS_MediaType media, FS_CardType card)
 
     if (mCard == CARD_CTR)
     {
-        smdh_s* smdh = loadSMDH(lowId(), highId(), mMedia);
-        if (smdh == NULL)
+        // The icon and name can only change with an update, so the cache is keyed by version
+        AM_TitleEntry info;
+        std::optional<IconAtlas::Icon> icon;
+        bool cacheable = R_SUCCEEDED(AM_GetTitleInfo(mMedia, 1, &mId, &info));
+        if (cacheable)
         {
-            return false;
+            icon = IconAtlas::cached(mId, info.version);
+        }
+        if (!icon)
+        {
+            smdh_s* smdh = loadSMDH(lowId(), highId(), mMedia);
+            if (smdh == NULL)
+            {
+                return false;
+            }
+            icon = IconAtlas::Icon{
+                StringUtils::UTF16toUTF8((char16_t*)smdh->applicationTitles[1].shortDescription),
+                48, 48, std::vector<u16>(smdh->bigIconData, smdh->bigIconData + 48 * 48)};
+            delete smdh;
+            if (cacheable)
+            {
+                IconAtlas::cache(mId, info.version, *icon);
+            }
         }
 
-        mName   = StringUtils::UTF16toUTF8((char16_t*)smdh->applicationTitles[1].shortDescription);
+        mName   = icon->name;
         mPrefix = fmt::format(FMT_STRING("0x{:05X}"), lowId() >> 8);
 
         Archive archive = Archive::save(mMedia, lowId(), highId(), false);
         if (R_SUCCEEDED(archive.result()))
         {
             loadTitle = true;
-            mIcon     = loadTextureIcon(smdh);
+            mIcon     = loadIcon(mId, info.version, *icon);
         }
         // Is it a GBA save? GBA saves are not in the normal archive format
         else
@@ -157,13 +145,12 @@ bool Title::load(u64 id, FS_MediaType media, FS_CardType card)
                 {
                     mGba      = true;
                     loadTitle = true;
-                    mIcon     = loadTextureIcon(smdh);
+                    mIcon     = loadIcon(mId, info.version, *icon);
                     out->close();
                 }
                 archive.close();
             }
         }
-        delete smdh;
     }
     else
     {
@@ -185,14 +172,29 @@ bool Title::load(u64 id, FS_MediaType media, FS_CardType card)
 
         bool infrared = headerData[12] == 'I';
 
-        delete[] headerData;
-        bannerData* banner = new bannerData;
-        FSUSER_GetLegacyBannerData(mMedia, 0LL, (u8*)banner);
-        loadDSIcon(banner);
-        mIcon = dsIcon;
+        // The banner CRC covers the icon, so it tells whether the cached one is current
+        bannerData* banner = new bannerData{};
+        u64 key            = IconAtlas::dsKey(mPrefix);
+        std::optional<IconAtlas::Icon> icon;
+        bool cacheable = R_SUCCEEDED(FSUSER_GetLegacyBannerData(mMedia, 0LL, (u8*)banner));
+        if (cacheable)
+        {
+            icon = IconAtlas::cached(key, banner->crc);
+        }
+        if (!icon)
+        {
+            icon = IconAtlas::Icon{_cardTitle, 32, 32, std::vector<u16>(32 * 32)};
+            Swizzle::dsIcon(banner->data, banner->palette, icon->pixels.data());
+            if (cacheable)
+            {
+                IconAtlas::cache(key, banner->crc, *icon);
+            }
+        }
+        mIcon = loadIcon(key, banner->crc, *icon);
         delete banner;
 
-        res = SPIGetCardType(&mCardType, infrared);
+        res = SPIGetCardType(&mCardType, infrared, headerData, 0x3B4);
+        delete[] headerData;
         if (R_FAILED(res))
         {
             return false;
@@ -27,18 +27,22 @@
 #include "loader.hpp"
 #include "../io/internal_fspxi.hpp"
 #include "Archive.hpp"
+#include "BackupStore.hpp"
 #include "Configuration.hpp"
 #include "DateTime.hpp"
-#include "Directory.hpp"
+#include "IconAtlas.hpp"
+#include "SaveIndex.hpp"
 #include "Title.hpp"
 #include "format.h"
 #include "gui.hpp"
 #include "io.hpp"
 #include "sav/Sav.hpp"
+#include "thread.hpp"
 #include "utils/crypto.hpp"
 #include <3ds.h>
 #include <atomic>
 #include <format.h>
+#include <mutex>
 #include <sys/stat.h>
 
 namespace
@@ -61,8 +65,6 @@ namespace
         u8 padding4[0x198];  // Get it to the proper size
     };
 
-    std::unordered_map<std::u16string, std::shared_ptr<Directory>> directories;
-
     constexpr char langIds[8] = {
         'E', // USA
         'S', // Spain
@@ -87,6 +89,11 @@ namespace
     };
 
     std::atomic<bool> cartWasUpdated = false;
+    // The last DS card whose save was found valid. Scanning it again doesn't need to reread it
+    std::atomic<u64> validCardIdentity = 0;
+    // Save read while scanning the DS card, handed to the first load of it
+    std::mutex scannedCardSaveMutex;
+    std::shared_ptr<u8[]> scannedCardSave;
     std::atomic_flag continueScan;
 
     std::array<u64, 5> vcTitleIds                              = {0, 0, 0, 0, 0};
@@ -201,79 +208,11 @@ namespace
     }
 
     bool saveIsFile;
+    // Loaded from a BackupStore manifest, so changes are written back as one
+    bool saveIsManifest;
     std::string saveFileName;
     std::shared_ptr<Title> loadedTitle;
-
-    std::vector<std::string> scanDirectoryFor(const std::u16string& dir, const std::u16string& id)
-    {
-        if (directories.count(dir) == 0)
-        {
-            std::shared_ptr<Directory> d = Archive::sd().directory(dir);
-            if (d)
-            {
-                directories.emplace(dir, d);
-            }
-            else
-            {
-                return {};
-            }
-        }
-        else
-        {
-            // Attempt to re-read directory
-            if (!directories[dir]->loaded())
-            {
-                std::shared_ptr<Directory> d = Archive::sd().directory(dir);
-                if (d)
-                {
-                    directories[dir] = d;
-                }
-                else
-                {
-                    return {};
-                }
-            }
-        }
-        std::vector<std::string> ret;
-        auto& directory = directories[dir];
-        if (directory->loaded())
-        {
-            for (size_t j = 0; j < directory->count(); j++)
-            {
-                if (directory->folder(j))
-                {
-                    std::u16string fileName = directory->item(j);
-                    if (fileName.substr(0, id.size()) == id)
-                    {
-                        auto subdir = Archive::sd().directory(dir + u"/" + fileName);
-                        if (subdir)
-                        {
-                            for (size_t k = 0; k < subdir->count(); k++)
-                            {
-                                if (subdir->folder(k))
-                                {
-                                    std::string savePath =
-                                        StringUtils::UTF16toUTF8(
-                                            dir + u"/" + fileName + u"/" + subdir->item(k) + u"/") +
-                                        idToSaveName(id);
-                                    if (io::exists(savePath))
-                                    {
-                                        ret.emplace_back(savePath);
-                                    }
-                                }
-                            }
-                        }
-                    }
-                }
-            }
-        }
-        return ret;
-    }
-
-    std::vector<std::string> scanDirectoryFor(const std::u16string& dir, const std::string& id)
-    {
-        return scanDirectoryFor(dir, StringUtils::UTF8toUTF16(id));
-    }
+    std::atomic<u32> currentSaveRevision = 0;
 
     // file must be at header address. On return, will be at the end of the save described by the
     // header.
@@ -419,67 +358,75 @@ void TitleLoader::scanTitles(void)
     }
 
     // Titles are already sorted by GameVersion
+
+    IconAtlas::flush();
 }
 
 void TitleLoader::scanSaves(void)
 {
     Gui::waitFrame(i18n::localize("SCAN_SAVES"));
-    auto scan = [](auto& tids)
+
+    std::vector<std::string> ids;
+    for (const auto& tid : vcTitleIds)
+    {
+        ids.emplace_back(fmt::format(FMT_STRING("0x{:05X}"), ((u32)tid) >> 8));
+    }
+    for (const auto& tid : ctrTitleIds)
     {
-        for (const auto& tid : tids)
+        ids.emplace_back(fmt::format(FMT_STRING("0x{:05X}"), ((u32)tid) >> 8));
+    }
+    for (size_t game = 0; game < 9; game++)
+    {
+        for (size_t lang = 0; lang < 8; lang++)
         {
-            std::string id                 = fmt::format(FMT_STRING("0x{:05X}"), ((u32)tid) >> 8);
-            std::vector<std::string> saves = scanDirectoryFor(u"/3ds/Checkpoint/saves", id);
-            if (Configuration::getInstance().showBackups())
-            {
-                std::vector<std::string> moreSaves = scanDirectoryFor(u"/3ds/PKSM/backups", id);
-                saves.insert(saves.end(), moreSaves.begin(), moreSaves.end());
-            }
-            auto extraSaves = Configuration::getInstance().extraSaves(id);
-            if (!extraSaves.empty())
-            {
-                for (const auto& save : extraSaves)
-                {
-                    if (io::exists(save))
-                    {
-                        saves.emplace_back(save);
-                    }
-                }
-            }
-            sdSaves[id] = saves;
+            ids.emplace_back(std::string(dsIds[game]) + langIds[lang]);
         }
-    };
+    }
 
-    sdSaves.clear();
+    std::vector<SaveIndex::Title> titles;
+    for (const auto& id : ids)
+    {
+        titles.emplace_back(SaveIndex::Title{id, idToSaveName(id)});
+    }
 
-    scan(vcTitleIds);
-    scan(ctrTitleIds);
+    // Each folder is read once for every ID instead of once per ID
+    SaveIndex index;
+    bool showBackups = Configuration::getInstance().showBackups();
+    index.scan("/3ds/Checkpoint/saves", titles);
+    if (showBackups)
+    {
+        index.scan("/3ds/PKSM/backups", titles);
+    }
 
-    for (size_t game = 0; game < 9; game++)
+    sdSaves.clear();
+    // Anything a backup manifest could be opened from and saved back to
+    std::vector<std::string> manifestPaths = {"/3ds/PKSM/backups"};
+    for (const auto& id : ids)
     {
-        for (size_t lang = 0; lang < 8; lang++)
+        std::vector<std::string> saves = index.find("/3ds/Checkpoint/saves", id);
+        if (showBackups)
         {
-            std::string id                 = std::string(dsIds[game]) + langIds[lang];
-            std::vector<std::string> saves = scanDirectoryFor(u"/3ds/Checkpoint/saves", id);
-            if (Configuration::getInstance().showBackups())
-            {
-                std::vector<std::string> moreSaves = scanDirectoryFor(u"/3ds/PKSM/backups", id);
-                saves.insert(saves.end(), moreSaves.begin(), moreSaves.end());
-            }
-            auto extraSaves = Configuration::getInstance().extraSaves(id);
-            if (!extraSaves.empty())
+            std::vector<std::string> moreSaves = index.find("/3ds/PKSM/backups", id);
+            saves.insert(saves.end(), moreSaves.begin(), moreSaves.end());
+        }
+        auto extraSaves = Configuration::getInstance().extraSaves(id);
+        if (!extraSaves.empty())
+        {
+            for (const auto& save : extraSaves)
             {
-                for (const auto& save : extraSaves)
+                if (io::exists(save))
                 {
-                    if (io::exists(save))
-                    {
-                        saves.emplace_back(save);
-                    }
+                    saves.emplace_back(save);
+                    manifestPaths.emplace_back(save);
                 }
             }
-            sdSaves[id] = saves;
         }
+        sdSaves[id] = saves;
     }
+
+    // Chunks are shared between backups, so deleting a backup folder doesn't free them by itself
+    Threads::executeTask([manifestPaths] { BackupStore::collect(manifestPaths); },
+        Threads::Priority::LOW);
 }
 
 void TitleLoader::backupSave(const std::string& id)
@@ -496,13 +443,22 @@ void TitleLoader::backupSave(const std::string& id)
         now.month(), now.day(), now.hour(), now.minute(), now.second());
     mkdir(path.c_str(), 777);
     path += idToSaveName(id);
-    FILE* out = fopen(path.c_str(), "wb");
-    if (out)
+    bool written = false;
+    TitleLoader::save->finishEditing();
+    if (Configuration::getInstance().incrementalBackups())
+    {
+        written = BackupStore::write(
+            path, TitleLoader::save->rawData().get(), TitleLoader::save->getLength());
+    }
+    else if (FILE* out = fopen(path.c_str(), "wb"))
     {
-        TitleLoader::save->finishEditing();
         fwrite(TitleLoader::save->rawData().get(), 1, TitleLoader::save->getLength(), out);
         fclose(out);
-        TitleLoader::save->beginEditing();
+        written = true;
+    }
+    TitleLoader::save->beginEditing();
+    if (written)
+    {
         if (Configuration::getInstance().showBackups())
         {
             sdSaves[id].emplace_back(path);
@@ -517,6 +473,7 @@ void TitleLoader::backupSave(const std::string& id)
 bool TitleLoader::load(std::shared_ptr<u8[]> data, size_t size)
 {
     save = pksm::Sav::getSave(data, size);
+    saveChanged();
     return save != nullptr;
 }
 
@@ -714,6 +671,7 @@ bool TitleLoader::load(std::shared_ptr<Title> title)
                 in->close();
             }
             save = pksm::Sav::getSave(data, size);
+            saveChanged();
             if (save)
             {
                 if (Configuration::getInstance().autoBackup())
@@ -744,16 +702,19 @@ bool TitleLoader::load(std::shared_ptr<Title> title)
             return false;
         }
 
-        std::shared_ptr<u8[]> data = std::shared_ptr<u8[]>(new u8[cap]);
-        u32 sectorSize             = (cap < 0x10000) ? cap : 0x10000;
-
-        for (u32 i = 0; i < cap / sectorSize; ++i)
+        std::shared_ptr<u8[]> data;
+        {
+            std::lock_guard<std::mutex> lock(scannedCardSaveMutex);
+            data = std::move(scannedCardSave);
+        }
+        if (!data)
         {
-            SPIReadSaveData(
-                title->SPICardType(), sectorSize * i, &data[sectorSize * i], sectorSize);
+            data = std::shared_ptr<u8[]>(new u8[cap]);
+            SPIReadSaveData(title->SPICardType(), 0, data.get(), cap);
         }
 
         save = pksm::Sav::getSave(data, cap);
+        saveChanged();
         if (Configuration::getInstance().autoBackup())
         {
             backupSave(title->checkpointPrefix());
@@ -766,10 +727,11 @@ bool TitleLoader::load(std::shared_ptr<Title> title)
 
 bool TitleLoader::load(std::shared_ptr<Title> title, const std::string& savePath)
 {
-    saveIsFile   = true;
-    saveFileName = savePath;
-    loadedTitle  = title;
-    FILE* in     = fopen(savePath.c_str(), "rb");
+    saveIsFile     = true;
+    saveIsManifest = false;
+    saveFileName   = savePath;
+    loadedTitle    = title;
+    FILE* in       = fopen(savePath.c_str(), "rb");
     u32 size;
     std::shared_ptr<u8[]> saveData = nullptr;
     if (in)
@@ -788,6 +750,21 @@ bool TitleLoader::load(std::shared_ptr<Title> title, const std::string& savePath
         saveData = std::shared_ptr<u8[]>(new u8[size]);
         fread(saveData.get(), 1, size, in);
         fclose(in);
+
+        if (BackupStore::isManifest(saveData.get(), size))
+        {
+            size_t fullSize;
+            saveData = BackupStore::read(saveData.get(), size, fullSize, 0x200000);
+            if (!saveData)
+            {
+                Gui::warn(saveFileName + '\n' + i18n::localize("SAVE_INVALID"));
+                loadedTitle  = nullptr;
+                saveFileName = "";
+                return false;
+            }
+            size           = fullSize;
+            saveIsManifest = true;
+        }
     }
     else
     {
@@ -797,6 +774,7 @@ bool TitleLoader::load(std::shared_ptr<Title> title, const std::string& savePath
         return false;
     }
     save = pksm::Sav::getSave(saveData, size);
+    saveChanged();
     if (!save)
     {
         Gui::warn(saveFileName + '\n' + i18n::localize("SAVE_INVALID"));
@@ -1105,8 +1083,14 @@ void TitleLoader::saveChanges()
     save->finishEditing();
     if (saveIsFile)
     {
-        FILE* out = fopen(saveFileName.c_str(), "wb");
-        if (out)
+        if (saveIsManifest)
+        {
+            if (!BackupStore::write(saveFileName, save->rawData().get(), save->getLength()))
+            {
+                Gui::warn(saveFileName + '\n' + i18n::localize("FAIL_SAVE_COMMIT"));
+            }
+        }
+        else if (FILE* out = fopen(saveFileName.c_str(), "wb"))
         {
             fwrite(save->rawData().get(), 1, save->getLength(), out);
             fclose(out);
@@ -1123,6 +1107,34 @@ void TitleLoader::saveChanges()
     save->beginEditing();
 }
 
+u32 TitleLoader::saveRevision(void)
+{
+    return currentSaveRevision;
+}
+
+void TitleLoader::saveChanged(void)
+{
+    currentSaveRevision++;
+}
+
+void TitleLoader::setPkm(const pksm::PKX& pkm, u8 box, u8 slot, bool applyTrade)
+{
+    save->pkm(pkm, box, slot, applyTrade);
+    saveChanged();
+}
+
+void TitleLoader::setPkm(const pksm::PKX& pkm, u8 slot)
+{
+    save->pkm(pkm, slot);
+    saveChanged();
+}
+
+void TitleLoader::fixParty(void)
+{
+    save->fixParty();
+    saveChanged();
+}
+
 std::string TitleLoader::savePath()
 {
     if (saveIsFile)
@@ -1139,6 +1151,8 @@ void TitleLoader::exit()
     vcTitles.clear();
     cardTitle   = nullptr;
     loadedTitle = nullptr;
+    // In case a scan was stopped before it got to writing the icons it decoded
+    IconAtlas::flush();
 }
 
 bool TitleLoader::scanCard()
@@ -1156,6 +1170,11 @@ bool TitleLoader::scanCard()
     cardTitle  = nullptr;
     Result res = 0;
     u32 count  = 0;
+    {
+        // Whatever was read last time may not be what's on the card now
+        std::lock_guard<std::mutex> lock(scannedCardSaveMutex);
+        scannedCardSave = nullptr;
+    }
     // check for cartridge and push at the beginning of the title list
     FS_CardType cardType;
     res = FSUSER_GetCardType(&cardType);
@@ -1198,24 +1217,26 @@ bool TitleLoader::scanCard()
             auto title = std::make_shared<Title>();
             if (title->load(0, MEDIATYPE_GAME_CARD, cardType))
             {
-                ret                            = true;
-                CardType spiCardType           = title->SPICardType();
-                u32 saveSize                   = SPIGetCapacity(spiCardType);
-                u32 sectorSize                 = (saveSize < 0x10000) ? saveSize : 0x10000;
-                std::shared_ptr<u8[]> saveFile = std::shared_ptr<u8[]>(new u8[saveSize]);
-                for (u32 i = 0; i < saveSize / sectorSize; ++i)
+                ret          = true;
+                u64 identity = SPICardIdentity();
+                if (identity != 0 && identity == validCardIdentity)
                 {
-                    res = SPIReadSaveData(
-                        spiCardType, sectorSize * i, &saveFile[sectorSize * i], sectorSize);
-                    if (R_FAILED(res))
-                    {
-                        break;
-                    }
+                    cardTitle = title;
                 }
-
-                if (R_SUCCEEDED(res) && pksm::Sav::isValidDSSave(saveFile))
+                else
                 {
-                    cardTitle = title;
+                    CardType spiCardType           = title->SPICardType();
+                    u32 saveSize                   = SPIGetCapacity(spiCardType);
+                    std::shared_ptr<u8[]> saveFile = std::shared_ptr<u8[]>(new u8[saveSize]);
+                    res = SPIReadSaveData(spiCardType, 0, saveFile.get(), saveSize);
+
+                    if (R_SUCCEEDED(res) && pksm::Sav::isValidDSSave(saveFile))
+                    {
+                        cardTitle         = title;
+                        validCardIdentity = identity;
+                        std::lock_guard<std::mutex> lock(scannedCardSaveMutex);
+                        scannedCardSave = saveFile;
+                    }
                 }
             }
             else
@@ -1228,6 +1249,7 @@ bool TitleLoader::scanCard()
             }
         }
     }
+    IconAtlas::flush();
     isScanning     = false;
     cartWasUpdated = true;
     return ret;
@@ -251,17 +251,54 @@ namespace TextParse
             fontSheets[i].lodParam = 0;
         }
         glyphSheets.emplace(font, std::move(fontSheets));
+        clearGlyphTable();
+        clearUnconditional();
     }
 
     void TextBuf::clear()
     {
-        if (currentGlyphs >= maxGlyphs)
+        lastStats  = frameStats;
+        frameStats = Stats{};
+
+        if (currentGlyphs > maxGlyphs)
         {
-            clearUnconditional();
+            // Evict down to three quarters of the budget so this doesn't happen every frame
+            std::vector<std::pair<u32, std::pair<float, const std::string*>>> byAge;
+            for (const auto& [maxWidth, texts] : parsedText)
+            {
+                for (const auto& [str, cached] : texts)
+                {
+                    if (cached.lastUsed != frame)
+                    {
+                        byAge.emplace_back(cached.lastUsed, std::pair{maxWidth, &str});
+                    }
+                }
+            }
+            std::sort(byAge.begin(), byAge.end(),
+                [](const auto& a, const auto& b) { return a.first < b.first; });
+            for (const auto& [lastUsed, key] : byAge)
+            {
+                if (currentGlyphs <= maxGlyphs * 3 / 4)
+                {
+                    break;
+                }
+                auto& texts = parsedText[key.first];
+                auto it     = texts.find(*key.second);
+                currentGlyphs -= it->second.text->glyphs.size();
+                texts.erase(it);
+            }
+            // Widths that were only used once would otherwise be kept around forever
+            std::erase_if(parsedText, [](const auto& texts) { return texts.second.empty(); });
         }
+
+        frame++;
     }
 
-    void TextBuf::clearUnconditional() { parsedText.clear(); }
+    void TextBuf::clearUnconditional()
+    {
+        parsedText.clear();
+        currentGlyphs = 0;
+    }
 
     bool TextBuf::fontHasChar(const C2D_Font& font, u32 codepoint)
     {
@@ -275,18 +312,89 @@ namespace TextParse
 
     C2D_Font TextBuf::fontForCodepoint(u32 codepoint)
     {
+        return fontOf(glyphForCodepoint(codepoint));
+    }
+
+    TextBuf::CodepointGlyph TextBuf::lookupGlyph(u32 codepoint)
+    {
+        CodepointGlyph ret{0, SYSTEM_FONT, 0, 0, 0};
+        // Not found in any of the fonts means the system font
+        ret.glyph = C2D_FontGlyphIndexFromCodePoint(nullptr, codepoint);
         if (codepoint != ' ')
         {
             for (size_t font = 0; font < fonts.size(); font++)
             {
                 if (TextBuf::fontHasChar(fonts[font], codepoint))
                 {
-                    return fonts[font];
+                    ret.glyph = C2D_FontGlyphIndexFromCodePoint(fonts[font], codepoint);
+                    ret.font  = font;
+                    break;
                 }
             }
         }
-        // Not found, so use the system font
-        return nullptr;
+        charWidthInfo_s* info = C2D_FontGetCharWidthInfo(fontOf(ret), ret.glyph);
+        ret.xOffset           = info->left;
+        ret.width             = info->glyphWidth;
+        ret.xAdvance          = info->charWidth;
+        return ret;
+    }
+
+    const TextBuf::CodepointGlyph& TextBuf::glyphForCodepoint(u32 codepoint)
+    {
+        if (codepoint < 0x10000)
+        {
+            auto& block = bmpGlyphs[codepoint >> 8];
+            if (!block)
+            {
+                block = std::make_unique<CodepointBlock>();
+                for (u32 i = 0; i < block->size(); i++)
+                {
+                    (*block)[i] = lookupGlyph((codepoint & ~0xFF) | i);
+                }
+            }
+            return (*block)[codepoint & 0xFF];
+        }
+        else
+        {
+            auto it = otherGlyphs.find(codepoint);
+            if (it == otherGlyphs.end())
+            {
+                it = otherGlyphs.emplace(codepoint, lookupGlyph(codepoint)).first;
+            }
+            return it->second;
+        }
+    }
+
+    C2D_Font TextBuf::fontOf(const CodepointGlyph& glyph) const
+    {
+        return glyph.font == SYSTEM_FONT ? nullptr : fonts[glyph.font];
+    }
+
+    // Texture coordinates worked out the same way C2D_FontCalcGlyphPos does: glyphs are laid out
+    // in cells of the font's sheets, row by row, with a pixel of padding around each cell
+    Glyph TextBuf::makeGlyph(const CodepointGlyph& glyph, u32 line, float xPos)
+    {
+        C2D_Font font = fontOf(glyph);
+        TGLP_s* tglp  = C2D_FontGetInfo(font)->tglp;
+        int perSheet  = tglp->nRows * tglp->nLines;
+        int cell      = glyph.glyph % perSheet;
+        int cellX     = (cell % tglp->nRows) * (tglp->cellWidth + 1) + 1;
+        int cellY     = (cell / tglp->nRows + 1) * (tglp->cellHeight + 1) + 1;
+        float left    = (float)cellX / tglp->sheetWidth;
+        float bottom  = 1.0f - (float)cellY / tglp->sheetHeight;
+        return Glyph(Tex3DS_SubTexture{glyph.width, tglp->cellHeight, left,
+                         bottom + (float)tglp->cellHeight / tglp->sheetHeight,
+                         left + (float)glyph.width / tglp->sheetWidth, bottom},
+            &glyphSheets[font][glyph.glyph / perSheet], font, line, xPos, glyph.width);
+    }
+
+    void TextBuf::clearGlyphTable()
+    {
+        for (auto& block : bmpGlyphs)
+        {
+            block = nullptr;
+        }
+        otherGlyphs.clear();
     }
 
     std::pair<std::vector<Glyph>, std::vector<float>> TextBuf::parseWord(
@@ -308,36 +416,21 @@ namespace TextParse
             {
                 break;
             }
-            C2D_Font font = fontForCodepoint(chr);
-            fontGlyphPos_s glyphPos;
-            C2D_FontCalcGlyphPos(
-                font, &glyphPos, C2D_FontGlyphIndexFromCodePoint(font, chr), 0, 1.0f, 1.0f);
-            if (glyphPos.width > 0.0f)
+            const CodepointGlyph& found = glyphForCodepoint(chr);
+            if (found.width == 0)
             {
-                if (maxWidth == 0.0f || lineWidths.back() + glyphPos.xAdvance <= maxWidth)
-                {
-                    ret.emplace_back(Tex3DS_SubTexture{static_cast<u16>(ceilf(glyphPos.width)),
-                                         (u16)C2D_FontGetInfo(font)->tglp->cellHeight,
-                                         glyphPos.texcoord.left, glyphPos.texcoord.top,
-                                         glyphPos.texcoord.right, glyphPos.texcoord.bottom},
-                        &glyphSheets[font][glyphPos.sheetIndex], font, lineWidths.size() - 1,
-                        lineWidths.back() + glyphPos.xOffset, glyphPos.width);
-                    lineWidths.back() += glyphPos.xAdvance;
-                }
-                else
-                {
-                    ret.emplace_back(Tex3DS_SubTexture{static_cast<u16>(ceilf(glyphPos.width)),
-                                         (u16)C2D_FontGetInfo(font)->tglp->cellHeight,
-                                         glyphPos.texcoord.left, glyphPos.texcoord.top,
-                                         glyphPos.texcoord.right, glyphPos.texcoord.bottom},
-                        &glyphSheets[font][glyphPos.sheetIndex], font, lineWidths.size(), 0,
-                        glyphPos.width);
-                    lineWidths.push_back(glyphPos.xAdvance);
-                }
+                break;
+            }
+            if (maxWidth == 0.0f || lineWidths.back() + found.xAdvance <= maxWidth)
+            {
+                ret.emplace_back(
+                    makeGlyph(found, lineWidths.size() - 1, lineWidths.back() + found.xOffset));
+                lineWidths.back() += found.xAdvance;
             }
             else
             {
-                break;
+                ret.emplace_back(makeGlyph(found, lineWidths.size(), 0.0f));
+                lineWidths.push_back(found.xAdvance);
             }
         }
         return {ret, lineWidths};
@@ -362,15 +455,12 @@ namespace TextParse
                 lines++;
                 continue;
             }
-            C2D_Font font = fontForCodepoint(chr);
-            fontGlyphPos_s glyphPos;
-            C2D_FontCalcGlyphPos(
-                font, &glyphPos, C2D_FontGlyphIndexFromCodePoint(font, chr), 0, 1.0f, 1.0f);
-            if (glyphPos.width <= 0.0f)
+            const CodepointGlyph& found = glyphForCodepoint(chr);
+            if (found.width == 0)
             {
                 if (lines == 0)
                 {
-                    width += glyphPos.xAdvance;
+                    width += found.xAdvance;
                 }
             }
             else
@@ -383,13 +473,17 @@ namespace TextParse
 
     std::shared_ptr<Text> TextBuf::parse(const std::string& str, float maxWidth)
     {
-        auto it = parsedText.find(str);
-        if (it != parsedText.end())
+        auto& texts = parsedText[maxWidth];
+        auto it     = texts.find(str);
+        if (it != texts.end())
         {
-            return it->second;
+            it->second.lastUsed = frame;
+            frameStats.hits++;
+            return it->second.text;
         }
         else
         {
+            u64 start                 = svcGetSystemTick();
             std::shared_ptr<Text> tmp = std::make_shared<Text>();
             tmp->lineWidths.push_back(0.0f);
             auto strIt = str.begin();
@@ -422,8 +516,12 @@ namespace TextParse
 
             tmp->maxLineWidth = *std::max_element(tmp->lineWidths.begin(), tmp->lineWidths.end());
 
-            auto ret = parsedText.emplace(str, std::move(tmp));
-            return ret.first->second;
+            currentGlyphs += tmp->glyphs.size();
+            frameStats.misses++;
+            frameStats.parseTime += svcGetSystemTick() - start;
+
+            auto ret = texts.emplace(str, CachedText{std::move(tmp), frame});
+            return ret.first->second.text;
         }
     }
 
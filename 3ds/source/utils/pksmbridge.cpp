@@ -24,6 +24,7 @@
  *         reasonable ways as different from the original version.
  */
 
+#include "BackupStore.hpp"
 #include "Configuration.hpp"
 #include "DateTime.hpp"
 #include "MainMenu.hpp"
@@ -199,8 +200,12 @@ void backupBridgeChanges()
     std::string path =
         fmt::format(FMT_STRING("/3ds/PKSM/backups/bridge/{0:d}-{1:d}-{2:d}_{3:d}-{4:d}-{5:d}.bak"),
             now.year(), now.month(), now.day(), now.hour(), now.minute(), now.second());
-    FILE* out = fopen(path.c_str(), "wb");
-    if (out)
+    if (Configuration::getInstance().incrementalBackups())
+    {
+        BackupStore::write(
+            path, TitleLoader::save->rawData().get(), TitleLoader::save->getLength());
+    }
+    else if (FILE* out = fopen(path.c_str(), "wb"))
     {
         fwrite(TitleLoader::save->rawData().get(), 1, TitleLoader::save->getLength(), out);
         fclose(out);
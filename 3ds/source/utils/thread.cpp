@@ -69,38 +69,6 @@ namespace
             }
         }
     }
-
-    struct Task
-    {
-        void (*entrypoint)(void*);
-        void* arg;
-    };
-    std::vector<Task> workerTasks;
-    LightLock workerTaskLock;
-    LightSemaphore moreTasks;
-    u8 numWorkers;
-
-    void taskWorkerThread(void* arg)
-    {
-        while (true)
-        {
-            LightSemaphore_Acquire(&moreTasks, 1);
-
-            LightLock_Lock(&workerTaskLock);
-
-            if (workerTasks.size() == 0)
-            {
-                return;
-            }
-
-            Task t = workerTasks[0];
-            workerTasks.erase(workerTasks.begin());
-
-            LightLock_Unlock(&workerTaskLock);
-
-            t.entrypoint(t.arg);
-        }
-    }
 }
 
 bool Threads::init(u8 workers)
@@ -117,17 +85,16 @@ bool Threads::init(u8 workers)
     if (!reaperThread)
         return false;
 
-    LightLock_Init(&workerTaskLock);
-    LightSemaphore_Init(&moreTasks, 0, workers);
-    for (int i = 0; i < workers; i++)
-    {
-        if (!Threads::create(taskWorkerThread, nullptr, 0x8000))
-            return false;
-    }
-    return true;
+    return startWorkers(workers);
 }
 
 bool Threads::create(void (*entrypoint)(void*), void* arg, std::optional<size_t> stackSize)
+{
+    return createOnCore(entrypoint, arg, -2, stackSize);
+}
+
+bool Threads::createOnCore(
+    void (*entrypoint)(void*), void* arg, int core, std::optional<size_t> stackSize)
 {
     if (currentThreads >= Threads::MAX_THREADS)
     {
@@ -136,7 +103,11 @@ bool Threads::create(void (*entrypoint)(void*), void* arg, std::optional<size_t>
     s32 prio = 0;
     svcGetThreadPriority(&prio, CUR_THREAD_HANDLE);
     Thread thread =
-        threadCreate(entrypoint, arg, stackSize.value_or(4 * 1024), prio - 1, -2, false);
+        threadCreate(entrypoint, arg, stackSize.value_or(4 * 1024), prio - 1, core, false);
+    if (!thread && core != -2)
+    {
+        thread = threadCreate(entrypoint, arg, stackSize.value_or(4 * 1024), prio - 1, -2, false);
+    }
 
     if (thread)
     {
@@ -150,17 +121,22 @@ bool Threads::create(void (*entrypoint)(void*), void* arg, std::optional<size_t>
     return false;
 }
 
-void Threads::executeTask(void (*task)(void*), void* arg)
+std::vector<int> Threads::workerCores(void)
 {
-    LightLock_Lock(&workerTaskLock);
-    workerTasks.emplace_back(task, arg);
-    LightSemaphore_Release(&moreTasks, 1);
-    LightLock_Unlock(&workerTaskLock);
+    // Core 1 belongs to the system unless the app CPU time limit is raised, so only the main core
+    // and the New 3DS's third core are used
+    bool isNew3DS = false;
+    APT_CheckNew3DS(&isNew3DS);
+    if (isNew3DS)
+    {
+        return {-2, 2};
+    }
+    return {-2};
 }
 
 void Threads::exit(void)
 {
-    LightSemaphore_Release(&moreTasks, numWorkers);
+    stopWorkers();
     svcSignalEvent(reaperThreadHandles[0]);
     threadJoin(reaperThread, U64_MAX);
     threadFree(reaperThread);
@@ -31,6 +31,10 @@
 #include "nlohmann/json_fwd.hpp"
 #include "pkx/PKX.hpp"
 #include "utils/crypto.hpp"
+#include <bitset>
+#include <unordered_map>
+
+class File;
 
 class Bank
 {
@@ -51,6 +55,9 @@ public:
     int boxes() const;
     const std::string& name() const;
     bool setName(const std::string& name);
+    // Changes whenever the stored Pokemon change. Unique across all banks, so it can be used to
+    // validate caches even when Banks::bank is replaced
+    u32 revision() const { return currentRevision; }
 
 private:
     static constexpr int BANK_VERSION            = 3;
@@ -72,13 +79,77 @@ private:
         u8 padding[4]; // Pad to 8 bytes
     };
     static_assert(sizeof(BankEntry) == 0x150);
+    // Partial saves first write the changed entries to a journal next to the bank, then patch the
+    // bank in place. The journal header is written last, so a journal is only replayed if it was
+    // completely written
+    static constexpr std::string_view JOURNAL_MAGIC = "PKSMJRNL";
+    struct JournalHeader
+    {
+        char MAGIC[8];
+        u32 count;
+        u32 boxes;
+        std::array<u8, 32> hash;
+    };
+    static_assert(sizeof(JournalHeader) == 48);
+    struct JournalRecord
+    {
+        u32 index;
+        u32 padding;
+        BankEntry entry;
+    };
+    static_assert(sizeof(JournalRecord) == 0x158);
+    struct DirtyBox
+    {
+        std::array<u8, 32> hash;
+        std::bitset<30> slots;
+    };
+    std::array<u8, 32> boxHash(int box) const;
+    void markDirty(int box, int slot);
+    std::vector<JournalRecord> dirtyRecords() const;
+    bool saveDirtyEntries(const std::string& path) const;
+    bool writeJournal(const std::string& path, const std::vector<JournalRecord>& records) const;
+    static bool writeRecords(File& out, const std::vector<JournalRecord>& records);
+    void replayJournal(const std::string& path) const;
+    // Partial saves append their journal to <bank>.bnk.bak.log instead of backing up the whole
+    // bank. Replaying the log onto <bank>.bnk.bak in order gives the bank as of any save since
+    // that backup was taken. Past the limit, taking a new backup is cheaper than keeping the log
+    static constexpr size_t BACKUP_LOG_LIMIT = 0x100000;
+    bool logBackup() const;
+    // Boxes are read from the bank file a page at a time on first access. Pages that can't be
+    // read back from the file (unsaved changes, or no valid file yet) stay resident; the rest are
+    // evicted least recently used first when the configured memory budget is exceeded
+    static constexpr int PAGE_BOXES   = 16;
+    static constexpr size_t PAGE_SIZE = sizeof(BankEntry) * 30 * PAGE_BOXES;
+    struct Page
+    {
+        std::unique_ptr<BankEntry[]> entries;
+        u32 lastUse = 0;
+        bool onDisk = true;
+    };
+    int pageCount() const;
+    int pageBoxes(int page) const;
+    void initPages(bool onDisk);
+    BankEntry& entry(int index) const;
+    BankEntry* pageEntries(int page) const;
+    void loadAllPages() const;
+    void evictPages(int needed = 0) const;
     std::unique_ptr<nlohmann::json> boxNames;
-    mutable std::array<u8, 32> prevHash;
-    mutable std::array<u8, 32> prevNameHash;
+    // Boxes written since the last save, mapped to the hash of their contents at that save and
+    // the slots that were written. Boxes that turn out to be unchanged are dropped by hasChanged()
+    mutable std::unordered_map<int, DirtyBox> dirtyBoxes;
+    // Same thing for box names, mapped to the name at the last save
+    mutable std::unordered_map<int, std::string> dirtyNames;
     std::string bankName;
     BankHeader header;
-    BankEntry* entries      = nullptr;
-    mutable bool needsCheck = false;
+    mutable std::vector<Page> pages;
+    mutable u32 pageUseCounter = 0;
+    u32 currentRevision        = 0;
+    mutable u32 savedBoxes     = 0;
+    // Set when the file on disk can't be patched in place (new, converted, or unreadable bank)
+    mutable bool fullSave = true;
+    // Set while the backup and its log add up to the bank on disk, so the next partial save can
+    // extend the log
+    mutable bool backupMatches = false;
 };
 
 #endif
@@ -27,6 +27,7 @@
 #ifndef CLOUDACCESS_HPP
 #define CLOUDACCESS_HPP
 
+#include "CloudPageCache.hpp"
 #include "enums/Generation.hpp"
 #include "nlohmann/json_fwd.hpp"
 #include "pkx/PKX.hpp"
@@ -44,6 +45,8 @@ public:
     };
     CloudAccess();
     std::unique_ptr<pksm::PKX> pkm(size_t slot) const;
+    // Doesn't copy, so it's what drawing code should use. Only valid until the page changes
+    const pksm::PKX& viewPkm(size_t slot) const;
     bool isLegal(size_t slot) const;
     // Gets the Pokémon and increments the server-side download counter
     std::unique_ptr<pksm::PKX> fetchPkm(size_t slot) const;
@@ -85,21 +88,18 @@ public:
     int currentPageError() const { return current->siteJsonErrorCode; }
     static std::pair<std::string, std::string> makeURL(int page, SortType type, bool ascend,
         bool legal, pksm::Generation low, pksm::Generation high, bool LGPE);
-    nlohmann::json grabPage(int page);
 
 private:
-    struct Page
-    {
-        ~Page();
-        std::unique_ptr<nlohmann::json> data;
-        std::atomic<bool> available        = false;
-        std::atomic<int> siteJsonErrorCode = 0;
-    };
+    using Page = CloudPageCache::Page;
     void refreshPages();
+    std::optional<int> turnPage(int number);
+    CloudPageCache::Query query() const;
     static void downloadCloudPage(std::shared_ptr<Page> page, int number, SortType type,
         bool ascend, bool legal, pksm::Generation low, pksm::Generation high, bool LGPE);
+    static void decodePage(void* job);
     static bool pageIsGood(const nlohmann::json& json);
-    std::shared_ptr<Page> current, next, prev;
+    CloudPageCache cache;
+    std::shared_ptr<Page> current;
     int pageNumber;
     SortType sort            = LATEST;
     bool isGood              = false;
@@ -0,0 +1,113 @@
+/*
+ *   This file is part of PKSM
+ *   Copyright (C) 2016-2021 Bernardo Giordano, Admiral Fish, piepie62
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *   Additional Terms 7.b and 7.c of GPLv3 apply to this file:
+ *       * Requiring preservation of specified reasonable legal notices or
+ *         author attributions in that material or in the Appropriate Legal
+ *         Notices displayed by works containing it.
+ *       * Prohibiting misrepresentation of the origin of that material,
+ *         or requiring that modified versions of such material be marked in
+ *         reasonable ways as different from the original version.
+ */
+
+#ifndef CLOUDPAGECACHE_HPP
+#define CLOUDPAGECACHE_HPP
+
+#include "enums/Generation.hpp"
+#include "nlohmann/json_fwd.hpp"
+#include "pkx/PKX.hpp"
+#include "types.h"
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <vector>
+
+// Keeps recently viewed pages of cloud search results around so that paging back and forth or
+// toggling a filter off and on again doesn't download them again. Pages are keyed by their number
+// and every search parameter that affects the server's answer.
+class CloudPageCache
+{
+public:
+    struct Page
+    {
+        ~Page();
+        std::unique_ptr<nlohmann::json> data;
+        std::atomic<bool> available        = false;
+        std::atomic<int> siteJsonErrorCode = 0;
+        // Size of the response the page was parsed from, which stands in for its memory use
+        std::atomic<size_t> size = 0;
+        // Decoded once, off the UI thread, before available is set so that drawing never has to
+        // touch base64 or JSON
+        std::vector<std::unique_ptr<pksm::PKX>> pkm;
+        std::vector<bool> legal;
+        // Where each group's Pokémon start in pkm, for pages of groups
+        std::vector<size_t> groupStart;
+    };
+
+    struct Query
+    {
+        int sort;
+        bool ascend;
+        bool legal;
+        pksm::Generation low;
+        pksm::Generation high;
+        bool LGPE;
+
+        bool operator==(const Query& other) const
+        {
+            return sort == other.sort && ascend == other.ascend && legal == other.legal &&
+                   low == other.low && high == other.high && LGPE == other.LGPE;
+        }
+    };
+
+    // Starts an asynchronous download that fills in the page and sets available once done. data
+    // must be left null if the page couldn't be retrieved
+    using Downloader =
+        std::function<void(std::shared_ptr<Page> page, int number, const Query& query)>;
+
+    CloudPageCache(Downloader downloader);
+
+    // Returns the cached page, starting a download if it isn't cached or failed last time
+    std::shared_ptr<Page> page(int number, const Query& query);
+    // Makes sure the pages within radius of number are cached or on their way, then trims the
+    // cache to its memory budget without touching them. Pages wrap around like the screens do
+    void prefetch(int number, int pages, int radius, const Query& query);
+    // Forgets every page of query except number, for when the result count shifted under them
+    void dropOthers(int number, const Query& query);
+    void clear();
+
+    static void wait(const Page& page);
+    // Stands in for slots that are out of range or couldn't be decoded
+    static const pksm::PKX& emptyPkm();
+
+private:
+    struct Entry
+    {
+        int number;
+        Query query;
+        std::shared_ptr<Page> page;
+        u32 lastUse;
+    };
+
+    void evict(size_t keep);
+
+    Downloader downloader;
+    std::vector<Entry> entries;
+    u32 useCounter = 0;
+};
+
+#endif
@@ -37,7 +37,7 @@
 class Configuration
 {
 public:
-    static constexpr int CURRENT_VERSION = 11;
+    static constexpr int CURRENT_VERSION = 16;
 
     static Configuration& getInstance(void)
     {
@@ -102,6 +102,21 @@ public:
 
     bool autoUpdate(void) const;
 
+    // Memory budget for resident bank pages, in KiB
+    int bankMemory(void) const;
+
+    // How many pages on either side of the current one the cloud screens download ahead of time
+    int cloudPrefetch(void) const;
+
+    // Memory budget for cached cloud pages, in KiB
+    int cloudCacheMemory(void) const;
+
+    // How many blocks of decoded music are kept ready ahead of playback
+    int musicLookahead(void) const;
+
+    // Whether save backups are written as manifests into the shared chunk store
+    bool incrementalBackups(void) const;
+
     void language(pksm::Language lang);
 
     void autoBackup(bool backup);
@@ -141,6 +156,16 @@ public:
 
     void autoUpdate(bool value);
 
+    void bankMemory(int value);
+
+    void cloudPrefetch(int value);
+
+    void cloudCacheMemory(int value);
+
+    void musicLookahead(int value);
+
+    void incrementalBackups(bool value);
+
     void save(void);
 
 private:
@@ -27,6 +27,7 @@
 #ifndef GROUPCLOUDACCESS_HPP
 #define GROUPCLOUDACCESS_HPP
 
+#include "CloudPageCache.hpp"
 #include "enums/Generation.hpp"
 #include "nlohmann/json_fwd.hpp"
 #include "pkx/PKX.hpp"
@@ -43,6 +44,8 @@ public:
     std::vector<std::unique_ptr<pksm::PKX>> fetchGroup(size_t groupIndex) const;
     long group(std::vector<std::unique_ptr<pksm::PKX>> pokemon);
     std::unique_ptr<pksm::PKX> pkm(size_t groupIndex, size_t pkm) const;
+    // Doesn't copy, so it's what drawing code should use. Only valid until the page changes
+    const pksm::PKX& viewPkm(size_t groupIndex, size_t pkm) const;
     std::unique_ptr<pksm::PKX> fetchPkm(size_t groupIndex, size_t pkm) const;
     bool isLegal(size_t groupIndex, size_t pkm) const;
 
@@ -63,23 +66,20 @@ public:
 
     bool good() const { return isGood; }
     int currentPageError() const { return current->siteJsonErrorCode; }
-    nlohmann::json grabPage(int page);
     static std::pair<std::string, std::string> makeURL(
         int page, bool legal, pksm::Generation low, pksm::Generation high, bool LGPE);
 
 private:
-    struct Page
-    {
-        ~Page();
-        std::unique_ptr<nlohmann::json> data;
-        std::atomic<bool> available        = false;
-        std::atomic<int> siteJsonErrorCode = 0;
-    };
+    using Page = CloudPageCache::Page;
     void refreshPages();
+    std::optional<int> turnPage(int number);
+    CloudPageCache::Query query() const;
     static void downloadGroupPage(std::shared_ptr<Page> page, int number, bool legal,
         pksm::Generation low, pksm::Generation high, bool LGPE);
+    static void decodePage(void* job);
     static bool pageIsGood(const nlohmann::json& page);
-    std::shared_ptr<Page> current, next, prev;
+    CloudPageCache cache;
+    std::shared_ptr<Page> current;
     int pageNumber;
     bool isGood = false;
     bool legal  = false;
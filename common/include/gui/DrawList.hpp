@@ -0,0 +1,86 @@
+/*
+ *   This file is part of PKSM
+ *   Copyright (C) 2016-2021 Bernardo Giordano, Admiral Fish, piepie62
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *   Additional Terms 7.b and 7.c of GPLv3 apply to this file:
+ *       * Requiring preservation of specified reasonable legal notices or
+ *         author attributions in that material or in the Appropriate Legal
+ *         Notices displayed by works containing it.
+ *       * Prohibiting misrepresentation of the origin of that material,
+ *         or requiring that modified versions of such material be marked in
+ *         reasonable ways as different from the original version.
+ */
+
+#ifndef DRAWLIST_HPP
+#define DRAWLIST_HPP
+
+#include "coretypes.h"
+#include <vector>
+
+// Works out an order to submit draws in that needs fewer texture switches without changing what
+// ends up on screen. Draws are only ever moved ahead of draws they don't overlap, so it doesn't
+// matter whether anything is blended. Knows nothing about what's actually being drawn: the caller
+// keeps its own commands and draws them in the order given by batches()
+class DrawList
+{
+public:
+    struct Stats
+    {
+        u32 draws           = 0;
+        u32 batches         = 0;
+        u32 textureSwitches = 0;
+    };
+
+    struct Batch
+    {
+        const void* texture;
+        std::vector<u32> draws;
+    };
+
+    // texture is nullptr for draws that don't use one, which can go in any batch. Returns the index
+    // of the draw, which is just the number added before it
+    u32 add(const void* texture, float left, float top, float right, float bottom);
+    const std::vector<Batch>& batches() const { return mBatches; }
+    bool empty() const { return mBounds.empty(); }
+    // Counts what was recorded towards the stats and empties the list
+    void clear();
+
+    // Accumulated since the last call to resetStats
+    const Stats& stats() const { return mStats; }
+    void resetStats() { mStats = Stats{}; }
+
+private:
+    struct Bounds
+    {
+        float left, top, right, bottom;
+        bool overlaps(const Bounds& other) const
+        {
+            return left < other.right && other.left < right && top < other.bottom &&
+                   other.top < bottom;
+        }
+    };
+    // How many batches back a draw may be moved. Keeps recording linear in the number of draws
+    static constexpr size_t MAX_LOOKBACK = 8;
+    bool overlaps(const Batch& batch, const Bounds& bounds) const;
+
+    std::vector<Bounds> mBounds;
+    // Union of each batch's bounds, to skip checking every draw in most batches
+    std::vector<Bounds> mBatchBounds;
+    std::vector<Batch> mBatches;
+    Stats mStats;
+};
+
+#endif
@@ -45,6 +45,7 @@
 #include "wcx/WC8.hpp"
 #include <memory>
 #include <string>
+#include <string_view>
 #include <vector>
 
 template <typename T>
@@ -137,6 +138,12 @@ struct QRModeTraits<std::string>
 
 namespace QR_Internal
 {
+    // Payloads from other tools that are too large for a single code may be split into parts,
+    // each starting with "PKSMQR:<id>:<index>/<total>:", where id is four hex digits shared by all
+    // parts of one payload. scan() collects parts from every code it sees, over as many frames as
+    // it takes, and returns the joined payload, so callers never see the headers
+    inline constexpr std::string_view MULTIPART_MAGIC = "PKSMQR:";
+
     // Empty == cancelled
     std::vector<u8> scan();
 }
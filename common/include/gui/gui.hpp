@@ -27,6 +27,7 @@
 #ifndef GUI_HPP
 #define GUI_HPP
 
+#include "DrawList.hpp"
 #include "PKX.hpp"
 #include "RunnableScreen.hpp"
 #include "Screen.hpp"
@@ -50,13 +51,18 @@ namespace Gui
     void mainLoop(void);
     void exit(void);
     void frameClean(void);
+    u32 inputRevision(void);
     template <typename T>
     T runScreen(RunnableScreen<T>& s);
 
 #if defined(_3DS)
     void target(gfxScreen_t t);
     void clearScreen(gfxScreen_t t);
+    // Draws pending text on top of everything recorded before it. Other draws are only recorded
+    // until text, a change of target, or the end of the frame needs them on screen
     void flushText();
+    // Draw calls and texture switches over the last full frame
+    const DrawList::Stats& drawStats(void);
 #elif defined(__SWITCH__)
     // Dunno what specific things might be necessary
 #endif
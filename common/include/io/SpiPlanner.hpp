@@ -0,0 +1,153 @@
+/*
+ *   This file is part of PKSM
+ *   Copyright (C) 2016-2021 Bernardo Giordano, Admiral Fish, piepie62
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *   Additional Terms 7.b and 7.c of GPLv3 apply to this file:
+ *       * Requiring preservation of specified reasonable legal notices or
+ *         author attributions in that material or in the Appropriate Legal
+ *         Notices displayed by works containing it.
+ *       * Prohibiting misrepresentation of the origin of that material,
+ *         or requiring that modified versions of such material be marked in
+ *         reasonable ways as different from the original version.
+ */
+
+/*
+ *  This file is part of TWLSaveTool.
+ *  Copyright (C) 2015-2016 TuxSH
+ *
+ *  TWLSaveTool is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>
+ */
+
+
+#ifndef SPIPLANNER_HPP
+#define SPIPLANNER_HPP
+
+#include "coretypes.h"
+#include <memory>
+
+#define SPI_CMD_RDSR 5
+#define SPI_CMD_WREN 6
+
+#define SPI_512B_EEPROM_CMD_WRLO 2
+#define SPI_512B_EEPROM_CMD_WRHI 10
+#define SPI_512B_EEPROM_CMD_RDLO 3
+#define SPI_512B_EEPROM_CMD_RDHI 11
+
+#define SPI_EEPROM_CMD_WRITE 2
+
+#define SPI_CMD_READ 3
+
+#define SPI_CMD_PP 2
+#define SPI_FLASH_CMD_PW 10
+#define SPI_FLASH_CMD_RDID 0x9f
+#define SPI_FLASH_CMD_SE 0xd8
+
+#define SPI_FLG_WIP 1
+#define SPI_FLG_WEL 2
+
+typedef enum
+{
+    NO_CHIP = -1,
+
+    EEPROM_512B = 0,
+
+    EEPROM_8KB       = 1,
+    EEPROM_64KB      = 2,
+    EEPROM_128KB     = 3,
+    EEPROM_STD_DUMMY = 1,
+
+    FLASH_256KB_1   = 4,
+    FLASH_256KB_2   = 5,
+    FLASH_512KB_1   = 6,
+    FLASH_512KB_2   = 7,
+    FLASH_1MB       = 8,
+    FLASH_8MB       = 9, // <- can't restore savegames, and maybe not read them atm
+    FLASH_STD_DUMMY = 4,
+
+    FLASH_512KB_INFRARED = 10,
+    FLASH_256KB_INFRARED =
+        11, // AFAIK, only "Active Health with Carol Vorderman" has such a flash save memory
+    FLASH_INFRARED_DUMMY = 9,
+
+    CHIP_LAST = 11,
+} CardType;
+
+// Moves bytes to and from a DS cartridge's save chip. Each call is one transaction with the chip
+// selected throughout: cmd is sent, then answerSize bytes are read into answer, then dataSize bytes
+// from data are sent
+class SpiTransport
+{
+public:
+    virtual ~SpiTransport() = default;
+    virtual Result transfer(CardType type, const void* cmd, u32 cmdSize, void* answer,
+        u32 answerSize, const void* data, u32 dataSize) = 0;
+    // The largest answer a single transaction can carry
+    virtual u32 maxTransfer() const = 0;
+};
+
+// Turns save chip operations into as few transactions as it can. Reads are issued as runs as long
+// as the transport allows, and the status register is only polled when a write may still be in
+// progress instead of before every operation. Knows nothing about the hardware beyond the
+// transport, so it can be run against a simulated chip
+class SpiPlanner
+{
+public:
+    explicit SpiPlanner(SpiTransport& transport) : mTransport(transport) {}
+
+    static u32 pageSize(CardType type);
+    static u32 capacity(CardType type);
+
+    Result waitWriteEnd(CardType type);
+    Result enableWriting(CardType type);
+    Result readJEDECIDAndStatusReg(CardType type, u32* id, u8* statusReg);
+    // If header is given, it's hashed along with the chip's JEDEC ID and status register to
+    // identify the card. A card identical to the last one detected gets the same type without
+    // probing it again, which for EEPROMs would mean writing to it
+    Result getCardType(
+        CardType* type, int infrared, const u8* header = nullptr, u32 headerSize = 0);
+    Result read(CardType type, u32 offset, void* data, u32 size);
+    Result write(CardType type, u32 offset, const void* data, u32 size);
+    Result eraseSector(CardType type, u32 offset);
+
+    // Identifies the card getCardType was last given a header for. 0 if there isn't one
+    u64 identity() const { return mIdentity; }
+
+private:
+    Result detectCardType(CardType* type, int infrared, CardType t, u32 jedec, u8 sr);
+    Result isDataMirrored(CardType type, u32 size, bool* mirrored);
+    Result read512B(u32 pos, void* data, u32 size);
+
+    SpiTransport& mTransport;
+    // Reads never start a write, so once the chip has been seen idle it stays idle until the next
+    // write or erase
+    bool mMayBeBusy        = true;
+    u64 mIdentity          = 0;
+    CardType mIdentityType = NO_CHIP;
+    std::unique_ptr<u8[]> mFill;
+};
+
+#endif
@@ -27,7 +27,7 @@
 #ifndef DECODER_HPP
 #define DECODER_HPP
 
-#include "types.h"
+#include "coretypes.h"
 #include <memory>
 #include <string>
 
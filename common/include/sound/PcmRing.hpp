@@ -0,0 +1,97 @@
+/*
+ *   This file is part of PKSM
+ *   Copyright (C) 2016-2021 Bernardo Giordano, Admiral Fish, piepie62
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *   Additional Terms 7.b and 7.c of GPLv3 apply to this file:
+ *       * Requiring preservation of specified reasonable legal notices or
+ *         author attributions in that material or in the Appropriate Legal
+ *         Notices displayed by works containing it.
+ *       * Prohibiting misrepresentation of the origin of that material,
+ *         or requiring that modified versions of such material be marked in
+ *         reasonable ways as different from the original version.
+ */
+
+#ifndef PCMRING_HPP
+#define PCMRING_HPP
+
+#include "coretypes.h"
+#include <atomic>
+#include <cstdlib>
+#include <vector>
+
+// Fixed number of blocks of decoded audio passed from exactly one producer thread to exactly one
+// consumer thread. Neither side ever blocks or takes a lock; each only waits for the other if it
+// chooses to
+class PcmRing
+{
+public:
+    struct Block
+    {
+        s16* data;
+        // In samples, like Decoder::decode
+        u32 samples;
+        u32 sampleRate;
+        // Which track this was decoded for. Blocks from a track that has been skipped are dropped
+        u32 track;
+        bool stereo;
+        // Whether this is the first block of a song, so the channel has to be set up for it
+        bool first;
+    };
+
+    // Block memory comes from alloc and goes back through release, for platforms whose audio
+    // hardware can only read some memory. blockSize is in bytes
+    using Alloc   = void* (*)(size_t);
+    using Release = void (*)(void*);
+    PcmRing(size_t blocks, size_t blockSize, Alloc alloc = std::malloc,
+        Release release = std::free);
+    ~PcmRing();
+    PcmRing(const PcmRing&)            = delete;
+    PcmRing& operator=(const PcmRing&) = delete;
+
+    // False if the block memory couldn't be allocated
+    bool good() const { return mMemory != nullptr; }
+    size_t blockSize() const { return mBlockSize; }
+    size_t capacity() const { return mBlocks.size(); }
+    // Position of a block in the ring, which stays the same for its whole lifetime
+    size_t index(const Block* block) const { return block - mBlocks.data(); }
+
+    // Producer side. back returns nullptr if the ring is full; push publishes what back returned
+    Block* back();
+    void push();
+
+    // Consumer side. front returns nullptr if nothing has been decoded yet; pop frees the block.
+    // peek returns the block n places after front without taking it, so that the consumer can keep
+    // reading from blocks it hasn't freed yet, or nullptr if it hasn't been decoded
+    Block* front() { return peek(0); }
+    Block* peek(size_t n);
+    void pop();
+
+    // Counted by the consumer whenever playback ran dry while waiting on the producer
+    void underrun() { mUnderruns++; }
+    u32 underruns() const { return mUnderruns; }
+
+private:
+    std::vector<Block> mBlocks;
+    s16* mMemory;
+    Release mRelease;
+    size_t mBlockSize;
+    // Only ever increase. Written by one side each and read by the other
+    std::atomic<size_t> mHead   = 0;
+    std::atomic<size_t> mTail   = 0;
+    std::atomic<u32> mUnderruns = 0;
+};
+
+#endif
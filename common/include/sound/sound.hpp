@@ -40,6 +40,9 @@ namespace Sound
     void stop(void);
 
     void playEffect(const std::string& effectName);
+
+    // How many times background music has run dry waiting on decoding since it was started
+    u32 underruns(void);
 }
 
 #endif
@@ -42,6 +42,11 @@ namespace BZ2
     int compress(FILE* file, const u8* data, std::size_t size);
     int decompress(const u8* buffer, std::size_t size, std::vector<u8>& out);
     int compress(std::vector<u8>& out, const u8* data, std::size_t size);
+
+    // Decompress into a caller-provided buffer. outSize is the capacity of out going in and the
+    // number of bytes written coming out. Returns BZ_OUTBUFF_FULL if the data doesn't fit
+    int decompress(FILE* file, u8* out, std::size_t& outSize);
+    int decompress(const u8* buffer, std::size_t size, u8* out, std::size_t& outSize);
 };
 
 #endif
@@ -0,0 +1,72 @@
+/*
+ *   This file is part of PKSM
+ *   Copyright (C) 2016-2021 Bernardo Giordano, Admiral Fish, piepie62
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *   Additional Terms 7.b and 7.c of GPLv3 apply to this file:
+ *       * Requiring preservation of specified reasonable legal notices or
+ *         author attributions in that material or in the Appropriate Legal
+ *         Notices displayed by works containing it.
+ *       * Prohibiting misrepresentation of the origin of that material,
+ *         or requiring that modified versions of such material be marked in
+ *         reasonable ways as different from the original version.
+ */
+
+#ifndef BACKUPSTORE_HPP
+#define BACKUPSTORE_HPP
+
+#include "types.h"
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+// Backups written as a small manifest that lists the data's fixed size chunks by SHA-256. The
+// chunks themselves are kept once each in a shared folder, so backing up a save that has barely
+// changed only stores the chunks that did change
+namespace BackupStore
+{
+    // Saves are laid out in fixed blocks, so fixed chunks line up with what changes between
+    // backups about as well as content defined ones would
+    static constexpr size_t CHUNK_SIZE = 0x4000;
+    static constexpr size_t MAX_SIZE   = 0x4000000;
+
+    struct Stats
+    {
+        size_t chunks  = 0;
+        size_t written = 0;
+    };
+
+    // Stores any chunks of data not already in the store and writes the manifest to path
+    bool write(const std::string& path, const u8* data, size_t size, Stats* stats = nullptr);
+    // Same as above for data that isn't in memory. next is called for each chunk in order with
+    // where to put it and how large it is, and returns false if it couldn't be read
+    bool write(const std::string& path, size_t size, const std::function<bool(u8*, size_t)>& next,
+        Stats* stats = nullptr);
+    bool isManifest(const u8* data, size_t size);
+    // Rebuilds what a manifest describes. Returns nullptr if a chunk is missing or damaged, or if
+    // the data would be larger than maxSize
+    std::shared_ptr<u8[]> read(
+        const u8* manifest, size_t manifestSize, size_t& size, size_t maxSize = MAX_SIZE);
+    // Deletes every chunk that isn't listed by a manifest found in paths, which may be files or
+    // folders to search recursively. Nothing is deleted if any manifest can't be read. Returns the
+    // number of chunks deleted
+    size_t collect(const std::vector<std::string>& paths);
+    // Replaces every manifest found in paths with a plain copy of the data it describes, so that
+    // other tools can read them. Returns false if any of them couldn't be converted
+    bool expand(const std::vector<std::string>& paths);
+}
+
+#endif
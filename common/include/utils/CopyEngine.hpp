@@ -0,0 +1,166 @@
+/*
+ *   This file is part of PKSM
+ *   Copyright (C) 2016-2021 Bernardo Giordano, Admiral Fish, piepie62
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *   Additional Terms 7.b and 7.c of GPLv3 apply to this file:
+ *       * Requiring preservation of specified reasonable legal notices or
+ *         author attributions in that material or in the Appropriate Legal
+ *         Notices displayed by works containing it.
+ *       * Prohibiting misrepresentation of the origin of that material,
+ *         or requiring that modified versions of such material be marked in
+ *         reasonable ways as different from the original version.
+ */
+
+#ifndef COPYENGINE_HPP
+#define COPYENGINE_HPP
+
+#include "coretypes.h"
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+
+// Copies data a large chunk at a time with two buffers, so that the next chunk is read on a
+// separate thread while the current one is being written. One engine can be used for any number of
+// copies in a row; the thread and buffers are kept around until it's destroyed. Where the data
+// comes from and goes to is up to the Reader and Writer given to it, so the same engine works for
+// any file API
+class CopyEngine
+{
+public:
+    class Reader
+    {
+    public:
+        virtual ~Reader() = default;
+        virtual u32 read(u8* buf, u32 size) = 0;
+        virtual Result result() const       = 0;
+    };
+
+    class Writer
+    {
+    public:
+        virtual ~Writer() = default;
+        virtual u32 write(const u8* buf, u32 size) = 0;
+        virtual Result result() const              = 0;
+    };
+
+    // Standard C stream backend. Failures are reported as a negated errno
+    class StdioReader : public Reader
+    {
+    public:
+        explicit StdioReader(std::FILE* file) : mFile(file) {}
+        u32 read(u8* buf, u32 size) override;
+        Result result() const override { return mResult; }
+
+    private:
+        std::FILE* mFile;
+        Result mResult = 0;
+    };
+
+    class StdioWriter : public Writer
+    {
+    public:
+        explicit StdioWriter(std::FILE* file) : mFile(file) {}
+        u32 write(const u8* buf, u32 size) override;
+        Result result() const override { return mResult; }
+
+    private:
+        std::FILE* mFile;
+        Result mResult = 0;
+    };
+
+    struct Stats
+    {
+        u64 bytes = 0;
+        u32 files = 0;
+        // All in microseconds. stallTime is how long writing had to wait for a read to finish
+        u64 readTime  = 0;
+        u64 writeTime = 0;
+        u64 stallTime = 0;
+        u64 totalTime = 0;
+
+        // Bytes per second
+        u64 throughput() const { return totalTime ? bytes * 1000000 / totalTime : 0; }
+        Stats& operator+=(const Stats& other);
+    };
+
+    // Called with the KiB copied so far and the KiB expected in total, so that
+    // Gui::showRestoreProgress can be passed as is
+    using Progress = std::function<void(u32, u32)>;
+
+    static constexpr u32 CHUNK_SIZE = 0x20000;
+    // Returned when a read or write moves less than asked for without reporting an error
+    static constexpr Result INCOMPLETE = -1;
+
+    // total is the number of bytes all the copies done with this engine will add up to, if known.
+    // Progress is reported at most every PROGRESS_INTERVAL, so quick copies never report any
+    explicit CopyEngine(Progress progress = nullptr, u64 total = 0);
+    ~CopyEngine();
+    CopyEngine(const CopyEngine&) = delete;
+    CopyEngine& operator=(const CopyEngine&) = delete;
+
+    // Copies size bytes from in to out
+    Result copy(Reader& in, Writer& out, u64 size);
+    // Copies a file using the stdio backend. dest is replaced if it exists
+    Result copy(const std::string& src, const std::string& dest);
+
+    const Stats& stats() const { return mStats; }
+    // Everything copied by engines that have been destroyed
+    static Stats totals();
+
+private:
+    struct Request
+    {
+        Reader* in;
+        u8* buf;
+        u32 size;
+        u32 got;
+        Result result;
+    };
+
+    static constexpr auto PROGRESS_INTERVAL = std::chrono::milliseconds(100);
+
+    static void readerThread(void* arg);
+    void startReader();
+    void read(Request& request);
+    // Queues a read on the reader thread, or does it right away if there is no reader thread
+    void post(Reader& in, u8* buf, u32 size);
+    Request wait();
+    void report();
+
+    std::unique_ptr<u8[]> mBuffers[2];
+    Progress mProgress;
+    u64 mTotal;
+    u64 mDone = 0;
+    std::chrono::steady_clock::time_point mLastReport;
+    bool mReported = false;
+    Stats mStats;
+
+    std::mutex mLock;
+    std::condition_variable mWake;
+    Request mRequest;
+    bool mPending  = false;
+    bool mFinished = false;
+    bool mRunning  = false;
+    bool mStopping = false;
+    // Set if the thread couldn't be made, after which every read is done inline
+    bool mNoThread = false;
+};
+
+#endif
@@ -0,0 +1,49 @@
+/*
+ *   This file is part of PKSM
+ *   Copyright (C) 2016-2021 Bernardo Giordano, Admiral Fish, piepie62
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *   Additional Terms 7.b and 7.c of GPLv3 apply to this file:
+ *       * Requiring preservation of specified reasonable legal notices or
+ *         author attributions in that material or in the Appropriate Legal
+ *         Notices displayed by works containing it.
+ *       * Prohibiting misrepresentation of the origin of that material,
+ *         or requiring that modified versions of such material be marked in
+ *         reasonable ways as different from the original version.
+ */
+
+#ifndef FILEHASH_HPP
+#define FILEHASH_HPP
+
+#include "types.h"
+#include <array>
+#include <optional>
+#include <string>
+
+namespace FileHash
+{
+    static constexpr std::size_t READ_SIZE = 0x8000;
+
+    // Hashes the file a fixed size block at a time. Returns nullopt if it can't be opened
+    std::optional<std::array<u8, 32>> sha256(const std::string& path);
+    // Returns 0 if the modification time can't be read
+    u64 modificationTime(const std::string& path);
+    // Same as sha256, but skips reading the file if its size and modification time match the
+    // last time it was hashed. Files without a readable modification time are always read.
+    // Digests are kept in a small JSON file on the SD card
+    std::optional<std::array<u8, 32>> cachedSha256(const std::string& path);
+};
+
+#endif
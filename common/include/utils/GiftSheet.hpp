@@ -0,0 +1,105 @@
+/*
+ *   This file is part of PKSM
+ *   Copyright (C) 2016-2021 Bernardo Giordano, Admiral Fish, piepie62
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *   Additional Terms 7.b and 7.c of GPLv3 apply to this file:
+ *       * Requiring preservation of specified reasonable legal notices or
+ *         author attributions in that material or in the Appropriate Legal
+ *         Notices displayed by works containing it.
+ *       * Prohibiting misrepresentation of the origin of that material,
+ *         or requiring that modified versions of such material be marked in
+ *         reasonable ways as different from the original version.
+ */
+
+#ifndef GIFTSHEET_HPP
+#define GIFTSHEET_HPP
+
+#include "coretypes.h"
+#include "nlohmann/json.hpp"
+#include <array>
+#include <memory>
+#include <string_view>
+
+// The Mystery Gift sheet as a flat binary index, so that card lookups don't go through JSON. Laid
+// out as the header, then the per-card arrays (largest element type first, so that everything
+// stays aligned), then the string table, then the "matches" JSON. A loaded sheet points its arrays
+// straight into the buffer it was read into
+class GiftSheet
+{
+public:
+    static constexpr std::string_view MAGIC = "PKSMMGS2";
+    struct Header
+    {
+        char MAGIC[8];
+        // SHA-256 of the .json.bz2 the index was made from. sdmc doesn't keep modification times,
+        // and an updated sheet can easily be the same size as the old one
+        std::array<u8, 32> sourceHash;
+        u32 gen;
+        u32 count;
+        u32 stringsSize;
+        u32 matchesSize;
+    };
+    static_assert(sizeof(Header) == 56);
+
+    enum Gen : u32
+    {
+        GEN_BAD,
+        GEN_4,
+        GEN_5,
+        GEN_6,
+        GEN_7,
+        GEN_LGPE,
+        GEN_8
+    };
+
+    enum CardType : u8
+    {
+        CARD_DEFAULT,
+        CARD_WC4,
+        CARD_PGT,
+        CARD_FULL
+    };
+
+    // Size of the whole sheet described by header
+    static size_t size(const Header& header);
+    // Turns the JSON sheet into a complete binary one. Anything that doesn't look like a sheet
+    // gives an empty sheet with gen GEN_BAD
+    static std::unique_ptr<u8[]> build(
+        const nlohmann::json& json, const std::array<u8, 32>& sourceHash);
+
+    // Takes over buffer, which must hold a complete sheet
+    void use(std::unique_ptr<u8[]> buffer);
+
+    Gen gen   = GEN_BAD;
+    u32 count = 0;
+    // Indexed by card. names and games are offsets into strings
+    const u32* offsets  = nullptr;
+    const u32* names    = nullptr;
+    const u32* games    = nullptr;
+    const s16* species  = nullptr;
+    const s16* forms    = nullptr;
+    const u8* genders   = nullptr;
+    const u8* released  = nullptr;
+    const u8* types     = nullptr;
+    const char* strings = nullptr;
+    // Each element maps language strings to the index of that language's card
+    nlohmann::json matches = nlohmann::json::array();
+
+private:
+    std::unique_ptr<u8[]> buffer;
+};
+
+#endif
@@ -0,0 +1,59 @@
+/*
+ *   This file is part of PKSM
+ *   Copyright (C) 2016-2021 Bernardo Giordano, Admiral Fish, piepie62
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *   Additional Terms 7.b and 7.c of GPLv3 apply to this file:
+ *       * Requiring preservation of specified reasonable legal notices or
+ *         author attributions in that material or in the Appropriate Legal
+ *         Notices displayed by works containing it.
+ *       * Prohibiting misrepresentation of the origin of that material,
+ *         or requiring that modified versions of such material be marked in
+ *         reasonable ways as different from the original version.
+ */
+
+#ifndef SAVEINDEX_HPP
+#define SAVEINDEX_HPP
+
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// An index of save backups laid out as root/<title folder>/<backup folder>/<save file>, which is
+// how both Checkpoint and PKSM store them. Each root is listed once no matter how many titles are
+// looked up in it, and each backup costs one stat
+class SaveIndex
+{
+public:
+    // A title's folders are the ones whose names start with prefix, and its saves are all named
+    // saveName
+    struct Title
+    {
+        std::string prefix;
+        std::string saveName;
+    };
+
+    // Finds the saves of every title in root
+    void scan(const std::string& root, const std::vector<Title>& titles);
+    // Every root/<title folder>/<backup folder>/<save file> found for prefix when root was scanned
+    std::vector<std::string> find(const std::string& root, const std::string& prefix) const;
+
+private:
+    // Saves found in each root, by title prefix
+    std::unordered_map<std::string, std::unordered_map<std::string, std::vector<std::string>>>
+        roots;
+};
+
+#endif
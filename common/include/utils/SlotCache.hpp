@@ -0,0 +1,76 @@
+/*
+ *   This file is part of PKSM
+ *   Copyright (C) 2016-2021 Bernardo Giordano, Admiral Fish, piepie62
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *   Additional Terms 7.b and 7.c of GPLv3 apply to this file:
+ *       * Requiring preservation of specified reasonable legal notices or
+ *         author attributions in that material or in the Appropriate Legal
+ *         Notices displayed by works containing it.
+ *       * Prohibiting misrepresentation of the origin of that material,
+ *         or requiring that modified versions of such material be marked in
+ *         reasonable ways as different from the original version.
+ */
+
+#ifndef SLOTCACHE_HPP
+#define SLOTCACHE_HPP
+
+#include "pkx/PKFilter.hpp"
+#include "pkx/PKX.hpp"
+#include "types.h"
+#include <array>
+#include <bitset>
+#include <functional>
+#include <memory>
+#include <vector>
+
+// Keeps the decoded contents of recently drawn boxes so that screens don't have to construct 30
+// PKX objects per box every frame. Each cached box is tagged with the revision of its source; a
+// lookup with a different revision decodes the box again.
+class SlotCache
+{
+public:
+    static constexpr int SLOTS_PER_BOX = 30;
+    using Loader = std::function<std::unique_ptr<pksm::PKX>(int box, int slot)>;
+
+    SlotCache(Loader loader, size_t maxBoxes = 2);
+
+    const pksm::PKX& pkm(int box, int slot, u32 revision);
+    // The filter result is cached separately, as the filter can change without the box changing
+    bool matchesFilter(
+        int box, int slot, u32 revision, const pksm::PKFilter& filter, u32 filterRevision);
+    void clear();
+
+private:
+    struct CachedBox
+    {
+        std::array<std::unique_ptr<pksm::PKX>, SLOTS_PER_BOX> pkm;
+        std::bitset<SLOTS_PER_BOX> filterMatch;
+        std::bitset<SLOTS_PER_BOX> filterChecked;
+        int box            = -1;
+        u32 revision       = 0;
+        u32 filterRevision = 0;
+        u32 lastUse        = 0;
+    };
+
+    CachedBox& fetch(int box, u32 revision);
+
+    Loader loader;
+    std::vector<CachedBox> boxes;
+    size_t maxBoxes;
+    u32 useCounter = 0;
+};
+
+#endif
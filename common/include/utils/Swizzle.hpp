@@ -0,0 +1,58 @@
+/*
+ *   This file is part of PKSM
+ *   Copyright (C) 2016-2021 Bernardo Giordano, Admiral Fish, piepie62
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *   Additional Terms 7.b and 7.c of GPLv3 apply to this file:
+ *       * Requiring preservation of specified reasonable legal notices or
+ *         author attributions in that material or in the Appropriate Legal
+ *         Notices displayed by works containing it.
+ *       * Prohibiting misrepresentation of the origin of that material,
+ *         or requiring that modified versions of such material be marked in
+ *         reasonable ways as different from the original version.
+ */
+
+#ifndef SWIZZLE_HPP
+#define SWIZZLE_HPP
+
+#include "coretypes.h"
+
+// The 3DS GPU stores textures as 8x8 tiles, left to right and then top to bottom, with the texels
+// of each tile in Morton order. These work on 16 bit texels in that layout and don't touch the GPU,
+// so they can be run anywhere
+namespace Swizzle
+{
+    // Index of the texel at x, y in a tiled image width texels wide
+    constexpr u32 offset(u32 x, u32 y, u32 width)
+    {
+        return (((y >> 3) * (width >> 3) + (x >> 3)) << 6) +
+               ((x & 1) | ((y & 1) << 1) | ((x & 2) << 1) | ((y & 2) << 2) | ((x & 4) << 2) |
+                   ((y & 4) << 3));
+    }
+
+    // Copies a tiled width x height image into a tiled image dstWidth texels wide with its top left
+    // corner at x, y. Everything has to be a multiple of 8, which makes this a copy per tile
+    void blit(const u16* src, u32 width, u32 height, u16* dst, u32 dstWidth, u32 x, u32 y);
+
+    // Copies a width x height image stored row by row into the top left corner of a tiled image
+    // dstWidth texels wide. width and height have to be multiples of 8
+    void fromLinear(const u16* src, u32 width, u32 height, u16* dst, u32 dstWidth);
+
+    // Decodes a DS banner icon (32x32 4bpp palette indices in 8x8 tiles, BGR555 palette) to a tiled
+    // 32x32 RGB565 image. Palette index 0 is transparent and becomes white
+    void dsIcon(const u8* data, const u16* palette, u16* out);
+}
+
+#endif
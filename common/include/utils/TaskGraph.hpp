@@ -0,0 +1,86 @@
+/*
+ *   This file is part of PKSM
+ *   Copyright (C) 2016-2021 Bernardo Giordano, Admiral Fish, piepie62
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *   Additional Terms 7.b and 7.c of GPLv3 apply to this file:
+ *       * Requiring preservation of specified reasonable legal notices or
+ *         author attributions in that material or in the Appropriate Legal
+ *         Notices displayed by works containing it.
+ *       * Prohibiting misrepresentation of the origin of that material,
+ *         or requiring that modified versions of such material be marked in
+ *         reasonable ways as different from the original version.
+ */
+
+#ifndef TASKGRAPH_HPP
+#define TASKGRAPH_HPP
+
+#include "coretypes.h"
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// Runs a set of stages in dependency order, overlapping whatever doesn't depend on each other, and
+// records when each one started and finished
+class TaskGraph
+{
+public:
+    using Stage = std::function<Result(void)>;
+
+    // Returns the stage's ID, for use as a dependency of stages added later
+    size_t add(const std::string& name, Stage stage, bool onWorker = false,
+        std::vector<size_t> dependencies = {});
+    // Worker stages are handed to Threads::executeTask as soon as their dependencies are done.
+    // Main thread stages run on the calling thread, in the order they were added. Once a stage
+    // fails or cancel is called nothing new is started, but this still waits for anything that's
+    // already running. Returns the result of the failed stage, if any
+    Result run(void);
+    void cancel(void);
+    // Name of the stage that stopped the graph by failing, or empty
+    std::string failedStage(void) const;
+    // Per stage timings relative to the start of run, followed by the critical path
+    std::string report(void) const;
+
+private:
+    struct Node
+    {
+        std::string name;
+        Stage stage;
+        bool onWorker;
+        std::vector<size_t> dependencies;
+        bool started  = false;
+        bool done     = false;
+        Result result = 0;
+        double start  = 0;
+        double end    = 0;
+    };
+
+    bool ready(const Node& node) const;
+    Result runStage(size_t index);
+    void complete(size_t index, Result result);
+
+    std::vector<Node> nodes;
+    std::chrono::steady_clock::time_point begin;
+    std::mutex lock;
+    std::condition_variable finished;
+    size_t running = 0;
+    bool stopped   = false;
+    size_t failed  = SIZE_MAX;
+};
+
+#endif
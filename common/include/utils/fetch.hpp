@@ -27,10 +27,7 @@
 #ifndef FETCH_HPP
 #define FETCH_HPP
 
-extern "C" {
-#include <sys/lock.h>
-}
-#include "types.h"
+#include "coretypes.h"
 #include <atomic>
 #include <curl/curl.h>
 #include <functional>
@@ -28,20 +28,43 @@
 #define THREAD_HPP
 
 #include "coretypes.h"
+#include <functional>
+#include <future>
 #include <optional>
+#include <vector>
 
 namespace Threads
 {
     static constexpr int MAX_THREADS = 32;
 
+    // Tasks of a higher priority are always started before any of a lower one
+    enum class Priority : u8
+    {
+        HIGH,
+        NORMAL,
+        LOW
+    };
+
     bool init(u8 workers);
     // stackSize will be ignored on systems that don't provide explicit setting of it. KEEP THIS IN
     // MIND IF YOU ARE PORTING
     bool create(void (*entrypoint)(void*), void* arg = nullptr,
         std::optional<size_t> stackSize = std::nullopt);
+    // Same as create, but asks for the thread to run on a specific core. Falls back to the default
+    // core if that one can't be used
+    bool createOnCore(void (*entrypoint)(void*), void* arg, int core,
+        std::optional<size_t> stackSize = std::nullopt);
+    // The cores workers are spread across, in the order they should be filled
+    std::vector<int> workerCores(void);
     // Executes task on a worker thread with stack size of 0x8000 (if settable).
-    void executeTask(void (*task)(void*), void* arg);
+    void executeTask(void (*task)(void*), void* arg, Priority priority = Priority::NORMAL);
+    std::future<void> executeTask(
+        std::function<void()> task, Priority priority = Priority::NORMAL);
     void exit(void);
+
+    // The task scheduler itself is portable; these are called by each platform's init and exit
+    bool startWorkers(u8 workers);
+    void stopWorkers(void);
 }
 
 #endif
@@ -40,6 +40,12 @@
 
 namespace
 {
+    struct DecodeJob
+    {
+        std::shared_ptr<CloudPageCache::Page> page;
+        std::unique_ptr<std::string> retData;
+    };
+
     std::string sortTypeToString(CloudAccess::SortType type)
     {
         switch (type)
@@ -53,8 +59,6 @@ namespace
     }
 }
 
-CloudAccess::Page::~Page() {}
-
 void CloudAccess::downloadCloudPage(std::shared_ptr<Page> page, int number, SortType type,
     bool ascend, bool legal, pksm::Generation low, pksm::Generation high, bool LGPE)
 {
@@ -70,6 +74,7 @@ void CloudAccess::downloadCloudPage(std::shared_ptr<Page> page, int number, Sort
     Fetch::performAsync(fetch,
         [page, retData, headers](CURLcode code, std::shared_ptr<Fetch> fetch)
         {
+            bool decoding = false;
             if (code == CURLE_OK)
             {
                 long status_code;
@@ -77,12 +82,11 @@ void CloudAccess::downloadCloudPage(std::shared_ptr<Page> page, int number, Sort
                 switch (status_code)
                 {
                     case 200:
-                        page->data = std::make_unique<nlohmann::json>(
-                            nlohmann::json::parse(*retData, nullptr, false));
-                        if (!page->data || !pageIsGood(*page->data))
-                        {
-                            page->data = nullptr;
-                        }
+                        // Parsing and decoding happen on a worker so they don't hold up transfers
+                        Threads::executeTask(decodePage,
+                            new DecodeJob{page, std::unique_ptr<std::string>(retData)},
+                            Threads::Priority::HIGH);
+                        decoding = true;
                         break;
                     case 401:
                     {
@@ -97,109 +101,83 @@ void CloudAccess::downloadCloudPage(std::shared_ptr<Page> page, int number, Sort
                         break;
                 }
             }
-            delete retData;
-            page->available = true;
             curl_slist_free_all(headers);
+            if (!decoding)
+            {
+                delete retData;
+                page->available = true;
+            }
         });
 }
 
-CloudAccess::CloudAccess() : pageNumber(1)
+void CloudAccess::decodePage(void* arg)
 {
-    refreshPages();
-}
+    std::unique_ptr<DecodeJob> job(static_cast<DecodeJob*>(arg));
+    auto& page = job->page;
 
-void CloudAccess::refreshPages()
-{
-    current            = std::make_shared<Page>();
-    current->data      = std::make_unique<nlohmann::json>(grabPage(pageNumber));
-    current->available = true;
-    if (current->data)
+    page->data = std::make_unique<nlohmann::json>(
+        nlohmann::json::parse(*job->retData, nullptr, false));
+    page->size = job->retData->size();
+    if (pageIsGood(*page->data))
     {
-        if (pageIsGood(*current->data))
+        for (const auto& mon : (*page->data)["pokemon"])
         {
-            isGood = true;
-        }
-        else
-        {
-            isGood = false;
-            if (current->data->contains("code") && (*current->data)["code"].is_number_integer())
-            {
-                current->siteJsonErrorCode = (*current->data)["code"].get<int>();
-                current->data              = nullptr;
-            }
-        }
-    }
-    if (isGood && pageNumber >= pages())
-    {
-        pageNumber         = pages();
-        current->data      = std::make_unique<nlohmann::json>(grabPage(pages()));
-        current->available = true;
-        if (current->data)
-        {
-            if (pageIsGood(*current->data))
+            std::string b64Data = mon["base_64"].get<std::string>();
+            auto gen  = pksm::Generation::fromString(mon["generation"].get<std::string>());
+            auto data = base64_decode(b64Data.data(), b64Data.size());
+
+            auto pkm = pksm::PKX::getPKM(gen, data.data(), data.size());
+            if (!pkm)
             {
-                isGood = true;
-            }
-            else
-            {
-                isGood = false;
-                if (current->data->contains("code") && (*current->data)["code"].is_number_integer())
-                {
-                    current->siteJsonErrorCode = (*current->data)["code"].get<int>();
-                    current->data              = nullptr;
-                }
+                pkm = pksm::PKX::getPKM<pksm::Generation::SEVEN>(nullptr);
             }
+            page->pkm.emplace_back(std::move(pkm));
+            page->legal.emplace_back(mon["legal"].get<bool>());
         }
     }
-    if (isGood)
+    else
     {
-        if (pages() > 1)
-        {
-            int page = (pageNumber % pages()) + 1;
-            next     = std::make_shared<Page>();
-            downloadCloudPage(next, page, sort, ascend, legal, lowGen, highGen, showLGPE);
-            if (pages() > 2)
-            {
-                page = pageNumber - 1 == 0 ? pages() : pageNumber - 1;
-                prev = std::make_shared<Page>();
-                downloadCloudPage(prev, page, sort, ascend, legal, lowGen, highGen, showLGPE);
-            }
-            else
-            {
-                prev = next;
-            }
-        }
-        else
+        if (page->data->contains("code") && (*page->data)["code"].is_number_integer())
         {
-            next = prev = current;
+            page->siteJsonErrorCode = (*page->data)["code"].get<int>();
         }
+        page->data = nullptr;
     }
+
+    page->available = true;
 }
 
-nlohmann::json CloudAccess::grabPage(int num)
+CloudAccess::CloudAccess()
+    : cache([](std::shared_ptr<Page> page, int number, const CloudPageCache::Query& query)
+          {
+              downloadCloudPage(page, number, SortType(query.sort), query.ascend, query.legal,
+                  query.low, query.high, query.LGPE);
+          }),
+      pageNumber(1)
 {
-    std::string retData;
-    const auto [url, postData] = makeURL(num, sort, ascend, legal, lowGen, highGen, showLGPE);
-
-    struct curl_slist* headers = NULL;
-    headers = curl_slist_append(headers, "Content-Type: application/json;charset=UTF-8");
-    headers = curl_slist_append(headers, "pksm-mode: yes");
+    refreshPages();
+}
 
-    auto fetch = Fetch::init(url, true, &retData, headers, postData);
-    auto res   = Fetch::perform(fetch);
-    curl_slist_free_all(headers);
+CloudPageCache::Query CloudAccess::query() const
+{
+    return {sort, ascend, legal, lowGen, highGen, showLGPE};
+}
 
-    if (res.index() == 0)
-    {
-        return {};
-    }
-    else if (std::get<1>(res) == CURLE_OK)
+void CloudAccess::refreshPages()
+{
+    current = cache.page(pageNumber, query());
+    CloudPageCache::wait(*current);
+    isGood = current->data != nullptr;
+    if (isGood && pageNumber > pages())
     {
-        return nlohmann::json::parse(retData, nullptr, false);
+        pageNumber = pages();
+        current    = cache.page(pageNumber, query());
+        CloudPageCache::wait(*current);
+        isGood = current->data != nullptr;
     }
-    else
+    if (isGood)
     {
-        return {};
+        cache.prefetch(pageNumber, pages(), Configuration::getInstance().cloudPrefetch(), query());
     }
 }
 
@@ -248,28 +226,23 @@ std::pair<std::string, std::string> CloudAccess::makeURL(int num, SortType type,
 
 std::unique_ptr<pksm::PKX> CloudAccess::pkm(size_t slot) const
 {
-    if (slot < (*current->data)["pokemon"].size())
+    return viewPkm(slot).clone();
+}
+
+const pksm::PKX& CloudAccess::viewPkm(size_t slot) const
+{
+    if (slot < current->pkm.size())
     {
-        std::string b64Data  = (*current->data)["pokemon"][slot]["base_64"].get<std::string>();
-        pksm::Generation gen = pksm::Generation::fromString(
-            (*current->data)["pokemon"][slot]["generation"].get<std::string>());
-        // Legal info: needs thought
-        auto retData = base64_decode(b64Data.data(), b64Data.size());
-
-        auto ret = pksm::PKX::getPKM(gen, retData.data(), retData.size());
-        if (ret)
-        {
-            return ret;
-        }
+        return *current->pkm[slot];
     }
-    return pksm::PKX::getPKM<pksm::Generation::SEVEN>(nullptr);
+    return CloudPageCache::emptyPkm();
 }
 
 bool CloudAccess::isLegal(size_t slot) const
 {
-    if (slot < (*current->data)["pokemon"].size())
+    if (slot < current->legal.size())
     {
-        return (*current->data)["pokemon"][slot]["legal"].get<bool>();
+        return current->legal[slot];
     }
     return false;
 }
@@ -295,65 +268,36 @@ std::unique_ptr<pksm::PKX> CloudAccess::fetchPkm(size_t slot) const
 
 std::optional<int> CloudAccess::nextPage()
 {
-    while (!next->available)
-    {
-        constexpr timespec sleepTime = {0, 100000};
-        nanosleep(&sleepTime, nullptr);
-    }
-    if (!next->data || next->data->is_discarded())
-    {
-        isGood = false;
-        return next->siteJsonErrorCode;
-    }
-    // Update data
-    pageNumber = (pageNumber % pages()) + 1;
-    prev       = current;
-    current    = next;
-    next       = std::make_shared<Page>();
-
-    // Download next page in the background
-    int nextPage = (pageNumber % pages()) + 1;
-    downloadCloudPage(next, nextPage, sort, ascend, legal, lowGen, highGen, showLGPE);
-
-    // If there's a mon number desync, also download the previous page again
-    if ((*current->data)["total"] != (*prev->data)["total"])
-    {
-        int prevPage = pageNumber - 1 == 0 ? pages() : pageNumber - 1;
-        downloadCloudPage(prev, prevPage, sort, ascend, legal, lowGen, highGen, showLGPE);
-    }
-
-    return std::nullopt;
+    return turnPage((pageNumber % pages()) + 1);
 }
 
 std::optional<int> CloudAccess::prevPage()
 {
-    while (!prev->available)
-    {
-        constexpr timespec sleepTime = {0, 100000};
-        nanosleep(&sleepTime, nullptr);
-    }
-    if (!prev->data || prev->data->is_discarded())
+    return turnPage(pageNumber - 1 == 0 ? pages() : pageNumber - 1);
+}
+
+std::optional<int> CloudAccess::turnPage(int number)
+{
+    auto page = cache.page(number, query());
+    CloudPageCache::wait(*page);
+    if (!page->data || page->data->is_discarded())
     {
         isGood = false;
-        return prev->siteJsonErrorCode;
+        return page->siteJsonErrorCode;
     }
-    // Update data
-    pageNumber = pageNumber - 1 == 0 ? pages() : pageNumber - 1;
-    next       = current;
-    current    = prev;
-    prev       = std::make_shared<Page>();
-
-    // Download the next page in the background
-    int prevPage = pageNumber - 1 == 0 ? pages() : pageNumber - 1;
-    downloadCloudPage(prev, prevPage, sort, ascend, legal, lowGen, highGen, showLGPE);
-
-    // If there's a mon number desync, also download the next page again
-    if ((*current->data)["total"] != (*next->data)["total"])
+
+    // If there's a mon number desync, the other cached pages no longer line up with this one
+    if ((*page->data)["total"] != (*current->data)["total"])
     {
-        int nextPage = (pageNumber % pages()) + 1;
-        downloadCloudPage(next, nextPage, sort, ascend, legal, lowGen, highGen, showLGPE);
+        cache.dropOthers(number, query());
     }
 
+    pageNumber = number;
+    current    = page;
+
+    // Download the surrounding pages in the background
+    cache.prefetch(pageNumber, pages(), Configuration::getInstance().cloudPrefetch(), query());
+
     return std::nullopt;
 }
 
@@ -393,6 +337,7 @@ long CloudAccess::pkm(std::unique_ptr<pksm::PKX> mon)
         if (res.index() == 1 && std::get<1>(res) == CURLE_OK)
         {
             fetch->getinfo(CURLINFO_RESPONSE_CODE, &ret);
+            cache.clear();
             refreshPages();
         }
     }
@@ -0,0 +1,133 @@
+/*
+ *   This file is part of PKSM
+ *   Copyright (C) 2016-2021 Bernardo Giordano, Admiral Fish, piepie62
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *   Additional Terms 7.b and 7.c of GPLv3 apply to this file:
+ *       * Requiring preservation of specified reasonable legal notices or
+ *         author attributions in that material or in the Appropriate Legal
+ *         Notices displayed by works containing it.
+ *       * Prohibiting misrepresentation of the origin of that material,
+ *         or requiring that modified versions of such material be marked in
+ *         reasonable ways as different from the original version.
+ */
+
+#include "CloudPageCache.hpp"
+#include "Configuration.hpp"
+#include "nlohmann/json.hpp"
+#include "pkx/PK7.hpp"
+#include <algorithm>
+#include <time.h>
+
+CloudPageCache::Page::~Page() {}
+
+CloudPageCache::CloudPageCache(Downloader downloader) : downloader(downloader) {}
+
+std::shared_ptr<CloudPageCache::Page> CloudPageCache::page(int number, const Query& query)
+{
+    auto it = std::find_if(entries.begin(), entries.end(), [&](const Entry& entry)
+        { return entry.number == number && entry.query == query; });
+    if (it == entries.end())
+    {
+        entries.push_back({number, query, nullptr, 0});
+        it = entries.end() - 1;
+    }
+    else if (it->page->available && !it->page->data)
+    {
+        // Errors aren't worth remembering; try again
+        it->page = nullptr;
+    }
+
+    if (!it->page)
+    {
+        it->page = std::make_shared<Page>();
+        downloader(it->page, number, query);
+    }
+    it->lastUse = ++useCounter;
+    return it->page;
+}
+
+void CloudPageCache::prefetch(int number, int pages, int radius, const Query& query)
+{
+    std::vector<int> window = {number};
+    for (int i = 1; i <= radius && pages > 0; i++)
+    {
+        for (int neighbor : {(number + i - 1) % pages + 1, (number - i - 1 + pages) % pages + 1})
+        {
+            if (std::find(window.begin(), window.end(), neighbor) == window.end())
+            {
+                window.emplace_back(neighbor);
+            }
+        }
+    }
+
+    // Touch the current page last so that it's the most recently used
+    for (auto it = window.rbegin(); it != window.rend(); ++it)
+    {
+        page(*it, query);
+    }
+
+    evict(window.size());
+}
+
+void CloudPageCache::dropOthers(int number, const Query& query)
+{
+    entries.erase(std::remove_if(entries.begin(), entries.end(),
+                      [&](const Entry& entry)
+                      { return entry.number != number && entry.query == query; }),
+        entries.end());
+}
+
+void CloudPageCache::clear()
+{
+    entries.clear();
+}
+
+void CloudPageCache::wait(const Page& page)
+{
+    while (!page.available)
+    {
+        constexpr timespec sleepTime = {0, 100000};
+        nanosleep(&sleepTime, nullptr);
+    }
+}
+
+const pksm::PKX& CloudPageCache::emptyPkm()
+{
+    static const auto empty = pksm::PKX::getPKM<pksm::Generation::SEVEN>(nullptr);
+    return *empty;
+}
+
+void CloudPageCache::evict(size_t keep)
+{
+    const size_t budget =
+        size_t(std::max(0, Configuration::getInstance().cloudCacheMemory())) * 1024;
+    size_t used = 0;
+    for (const auto& entry : entries)
+    {
+        used += entry.page->size;
+    }
+
+    // The most recently used entries are the window that was just prefetched, so they're never the
+    // oldest while there's something else left to drop
+    while (used > budget && entries.size() > keep)
+    {
+        auto oldest = std::min_element(entries.begin(), entries.end(),
+            [](const Entry& a, const Entry& b) { return a.lastUse < b.lastUse; });
+        // A download may have finished since the sum was taken
+        used -= std::min(used, size_t(oldest->page->size));
+        entries.erase(oldest);
+    }
+}
@@ -38,10 +38,18 @@
 #include "pkx/PK7.hpp"
 #include "pkx/PK8.hpp"
 #include "revision.h"
+#include "thread.hpp"
 #include "website.h"
 #include <unistd.h>
 
-GroupCloudAccess::Page::~Page() {}
+namespace
+{
+    struct DecodeJob
+    {
+        std::shared_ptr<CloudPageCache::Page> page;
+        std::unique_ptr<std::string> retData;
+    };
+}
 
 void GroupCloudAccess::downloadGroupPage(std::shared_ptr<Page> page, int number, bool legal,
     pksm::Generation low, pksm::Generation high, bool LGPE)
@@ -56,6 +64,7 @@ void GroupCloudAccess::downloadGroupPage(std::shared_ptr<Page> page, int number,
     Fetch::performAsync(fetch,
         [page, retData, headers](CURLcode code, std::shared_ptr<Fetch> fetch)
         {
+            bool decoding = false;
             if (code == CURLE_OK)
             {
                 long status_code;
@@ -63,14 +72,11 @@ void GroupCloudAccess::downloadGroupPage(std::shared_ptr<Page> page, int number,
                 switch (status_code)
                 {
                     case 200:
-                        page->data = std::make_unique<nlohmann::json>(
-                            nlohmann::json::parse(*retData, nullptr, false));
-                        // clang-format off
-                    if (!page->data || !pageIsGood(*page->data))
-                        // clang-format on
-                        {
-                            page->data = nullptr;
-                        }
+                        // Parsing and decoding happen on a worker so they don't hold up transfers
+                        Threads::executeTask(decodePage,
+                            new DecodeJob{page, std::unique_ptr<std::string>(retData)},
+                            Threads::Priority::HIGH);
+                        decoding = true;
                         break;
                     case 401:
                     {
@@ -86,111 +92,97 @@ void GroupCloudAccess::downloadGroupPage(std::shared_ptr<Page> page, int number,
                         break;
                 }
             }
-            delete retData;
-            page->available = true;
             curl_slist_free_all(headers);
+            if (!decoding)
+            {
+                delete retData;
+                page->available = true;
+            }
         });
 }
 
-GroupCloudAccess::GroupCloudAccess() : pageNumber(1)
+void GroupCloudAccess::decodePage(void* arg)
 {
-    refreshPages();
-}
+    std::unique_ptr<DecodeJob> job(static_cast<DecodeJob*>(arg));
+    auto& page = job->page;
 
-void GroupCloudAccess::refreshPages()
-{
-    current            = std::make_shared<Page>();
-    current->data      = std::make_unique<nlohmann::json>(grabPage(pageNumber));
-    current->available = true;
-    if (current->data)
-    {
-        if (pageIsGood(*current->data))
-        {
-            isGood = true;
-        }
-        else
-        {
-            isGood = false;
-            if (current->data->contains("error_code") &&
-                (*current->data)["error_code"].is_number_integer())
-            {
-                current->siteJsonErrorCode = (*current->data)["error_code"].get<int>();
-                current->data              = nullptr;
-            }
-        }
-    }
-    if (isGood && pageNumber >= pages())
+    page->data = std::make_unique<nlohmann::json>(
+        nlohmann::json::parse(*job->retData, nullptr, false));
+    page->size = job->retData->size();
+    if (pageIsGood(*page->data))
     {
-        pageNumber         = pages();
-        current->data      = std::make_unique<nlohmann::json>(grabPage(pages()));
-        current->available = true;
-        if (current->data)
+        for (const auto& group : (*page->data)["bundles"])
         {
-            if (pageIsGood(*current->data))
-            {
-                isGood = true;
-            }
-            else
+            page->groupStart.emplace_back(page->pkm.size());
+            const auto& mons = group["pokemons"];
+            size_t count     = std::min(group["count"].get<size_t>(), mons.size());
+            for (size_t i = 0; i < count; i++)
             {
-                isGood = false;
-                if (current->data->contains("error_code") &&
-                    (*current->data)["error_code"].is_number_integer())
+                std::unique_ptr<pksm::PKX> pkm;
+                // clang-format off
+                if (mons[i].is_object() &&
+                    mons[i].contains("base_64") && mons[i]["base_64"].is_string() &&
+                    mons[i].contains("generation") && mons[i]["generation"].is_string())
+                // clang-format on
+                {
+                    std::vector<u8> data = base64_decode(mons[i]["base_64"].get<std::string>());
+                    pkm                  = pksm::PKX::getPKM(
+                        pksm::Generation::fromString(mons[i]["generation"].get<std::string>()),
+                        data.data(), data.size());
+                }
+                if (!pkm)
                 {
-                    current->siteJsonErrorCode = (*current->data)["error_code"].get<int>();
-                    current->data              = nullptr;
+                    pkm = pksm::PKX::getPKM<pksm::Generation::SEVEN>(nullptr);
                 }
+                page->pkm.emplace_back(std::move(pkm));
+                page->legal.emplace_back(mons[i].contains("legality") &&
+                                         mons[i]["legality"].is_boolean() &&
+                                         mons[i]["legality"].get<bool>());
             }
         }
     }
-    if (isGood)
+    else
     {
-        if (pages() > 1)
-        {
-            int page = (pageNumber % pages()) + 1;
-            next     = std::make_shared<Page>();
-            downloadGroupPage(next, page, legal, low, high, LGPE);
-            if (pages() > 2)
-            {
-                page = pageNumber - 1 == 0 ? pages() : pageNumber - 1;
-                prev = std::make_shared<Page>();
-                downloadGroupPage(prev, page, legal, low, high, LGPE);
-            }
-            else
-            {
-                prev = next;
-            }
-        }
-        else
+        if (page->data->contains("error_code") && (*page->data)["error_code"].is_number_integer())
         {
-            next = prev = current;
+            page->siteJsonErrorCode = (*page->data)["error_code"].get<int>();
         }
+        page->data = nullptr;
     }
+
+    page->available = true;
 }
 
-nlohmann::json GroupCloudAccess::grabPage(int num)
+GroupCloudAccess::GroupCloudAccess()
+    : cache([](std::shared_ptr<Page> page, int number, const CloudPageCache::Query& query)
+          {
+              downloadGroupPage(page, number, query.legal, query.low, query.high, query.LGPE);
+          }),
+      pageNumber(1)
 {
-    std::string retData;
-
-    struct curl_slist* headers = NULL;
-    headers = curl_slist_append(headers, "Content-Type: application/json;charset=UTF-8");
-    headers = curl_slist_append(headers, "pksm-mode: yes");
+    refreshPages();
+}
 
-    const auto [url, postData] = GroupCloudAccess::makeURL(num, legal, low, high, LGPE);
-    auto fetch                 = Fetch::init(url, true, &retData, headers, postData);
-    auto res                   = Fetch::perform(fetch);
-    curl_slist_free_all(headers);
+CloudPageCache::Query GroupCloudAccess::query() const
+{
+    return {0, false, legal, low, high, LGPE};
+}
 
-    if (res.index() == 0)
-    {
-        return {};
-    }
-    else if (std::get<1>(res) == CURLE_OK)
+void GroupCloudAccess::refreshPages()
+{
+    current = cache.page(pageNumber, query());
+    CloudPageCache::wait(*current);
+    isGood = current->data != nullptr;
+    if (isGood && pageNumber > pages())
     {
-        return nlohmann::json::parse(retData, nullptr, false);
+        pageNumber = pages();
+        current    = cache.page(pageNumber, query());
+        CloudPageCache::wait(*current);
+        isGood = current->data != nullptr;
     }
-    else
+    if (isGood)
     {
-        return {};
+        cache.prefetch(pageNumber, pages(), Configuration::getInstance().cloudPrefetch(), query());
     }
 }
 
@@ -239,65 +231,36 @@ std::pair<std::string, std::string> GroupCloudAccess::makeURL(
 
 std::optional<int> GroupCloudAccess::nextPage()
 {
-    while (!next->available)
-    {
-        constexpr timespec sleepTime = {0, 100000};
-        nanosleep(&sleepTime, nullptr);
-    }
-    if (!next->data || next->data->is_discarded())
-    {
-        isGood = false;
-        return next->siteJsonErrorCode;
-    }
-    // Update data
-    pageNumber = (pageNumber % pages()) + 1;
-    prev       = current;
-    current    = next;
-    next       = std::make_shared<Page>();
-
-    // Download next page in the background
-    int nextPage = (pageNumber % pages()) + 1;
-    downloadGroupPage(next, nextPage, legal, low, high, LGPE);
-
-    // If there's a mon number desync, also download the previous page again
-    if ((*current->data)["total"] != (*prev->data)["total"])
-    {
-        int prevPage = pageNumber - 1 == 0 ? pages() : pageNumber - 1;
-        downloadGroupPage(prev, prevPage, legal, low, high, LGPE);
-    }
-
-    return std::nullopt;
+    return turnPage((pageNumber % pages()) + 1);
 }
 
 std::optional<int> GroupCloudAccess::prevPage()
 {
-    while (!prev->available)
-    {
-        constexpr timespec sleepTime = {0, 100000};
-        nanosleep(&sleepTime, nullptr);
-    }
-    if (!prev->data || prev->data->is_discarded())
+    return turnPage(pageNumber - 1 == 0 ? pages() : pageNumber - 1);
+}
+
+std::optional<int> GroupCloudAccess::turnPage(int number)
+{
+    auto page = cache.page(number, query());
+    CloudPageCache::wait(*page);
+    if (!page->data || page->data->is_discarded())
     {
         isGood = false;
-        return prev->siteJsonErrorCode;
+        return page->siteJsonErrorCode;
     }
-    // Update data
-    pageNumber = pageNumber - 1 == 0 ? pages() : pageNumber - 1;
-    next       = current;
-    current    = prev;
-    prev       = std::make_shared<Page>();
-
-    // Download the next page in the background
-    int prevPage = pageNumber - 1 == 0 ? pages() : pageNumber - 1;
-    downloadGroupPage(prev, prevPage, legal, low, high, LGPE);
-
-    // If there's a mon number desync, also download the next page again
-    if ((*current->data)["total"] != (*next->data)["total"])
+
+    // If there's a mon number desync, the other cached pages no longer line up with this one
+    if ((*page->data)["total"] != (*current->data)["total"])
     {
-        int nextPage = (pageNumber % pages()) + 1;
-        downloadGroupPage(next, nextPage, legal, low, high, LGPE);
+        cache.dropOthers(number, query());
     }
 
+    pageNumber = number;
+    current    = page;
+
+    // Download the surrounding pages in the background
+    cache.prefetch(pageNumber, pages(), Configuration::getInstance().cloudPrefetch(), query());
+
     return std::nullopt;
 }
 
@@ -308,34 +271,36 @@ int GroupCloudAccess::pages() const
 
 std::unique_ptr<pksm::PKX> GroupCloudAccess::pkm(size_t groupIndex, size_t pokeIndex) const
 {
-    if (groupIndex < (*current->data)["bundles"].size())
+    return viewPkm(groupIndex, pokeIndex).clone();
+}
+
+const pksm::PKX& GroupCloudAccess::viewPkm(size_t groupIndex, size_t pokeIndex) const
+{
+    if (groupIndex < current->groupStart.size())
     {
-        auto& group = (*current->data)["bundles"][groupIndex];
-        if (pokeIndex < group["count"].get<size_t>())
+        size_t index = current->groupStart[groupIndex] + pokeIndex;
+        size_t end   = groupIndex + 1 < current->groupStart.size()
+                           ? current->groupStart[groupIndex + 1]
+                           : current->pkm.size();
+        if (index < end)
         {
-            std::vector<u8> data =
-                base64_decode(group["pokemons"][pokeIndex]["base_64"].get<std::string>());
-            pksm::Generation gen = pksm::Generation::fromString(
-                group["pokemons"][pokeIndex]["generation"].get<std::string>());
-
-            auto ret = pksm::PKX::getPKM(gen, data.data(), data.size());
-            if (ret)
-            {
-                return ret;
-            }
+            return *current->pkm[index];
         }
     }
-    return pksm::PKX::getPKM<pksm::Generation::SEVEN>(nullptr);
+    return CloudPageCache::emptyPkm();
 }
 
 bool GroupCloudAccess::isLegal(size_t groupIndex, size_t pokeIndex) const
 {
-    if (groupIndex < (*current->data)["bundles"].size())
+    if (groupIndex < current->groupStart.size())
     {
-        auto& group = (*current->data)["bundles"][groupIndex];
-        if (pokeIndex < group["count"].get<size_t>())
+        size_t index = current->groupStart[groupIndex] + pokeIndex;
+        size_t end   = groupIndex + 1 < current->groupStart.size()
+                           ? current->groupStart[groupIndex + 1]
+                           : current->pkm.size();
+        if (index < end)
         {
-            return group["pokemons"][pokeIndex]["legality"].get<bool>();
+            return current->legal[index];
         }
     }
     return false;
@@ -453,6 +418,7 @@ long GroupCloudAccess::group(std::vector<std::unique_ptr<pksm::PKX>> sendMe)
             nlohmann::json retJson = nlohmann::json::parse(writeData, nullptr, false);
             Gui::warn(
                 i18n::localize("SHARE_DOWNLOAD_CODE") + '\n' + retJson["code"].get<std::string>());
+            cache.clear();
             refreshPages();
         }
         else
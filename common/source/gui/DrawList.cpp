@@ -0,0 +1,106 @@
+/*
+ *   This file is part of PKSM
+ *   Copyright (C) 2016-2021 Bernardo Giordano, Admiral Fish, piepie62
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *   Additional Terms 7.b and 7.c of GPLv3 apply to this file:
+ *       * Requiring preservation of specified reasonable legal notices or
+ *         author attributions in that material or in the Appropriate Legal
+ *         Notices displayed by works containing it.
+ *       * Prohibiting misrepresentation of the origin of that material,
+ *         or requiring that modified versions of such material be marked in
+ *         reasonable ways as different from the original version.
+ */
+
+#include "DrawList.hpp"
+#include <algorithm>
+
+bool DrawList::overlaps(const Batch& batch, const Bounds& bounds) const
+{
+    return std::any_of(batch.draws.begin(), batch.draws.end(),
+        [&](u32 draw) { return mBounds[draw].overlaps(bounds); });
+}
+
+u32 DrawList::add(const void* texture, float left, float top, float right, float bottom)
+{
+    u32 index = mBounds.size();
+    // Flipped draws have their right or bottom before their left or top
+    Bounds bounds{std::min(left, right), std::min(top, bottom), std::max(left, right),
+        std::max(top, bottom)};
+    mBounds.emplace_back(bounds);
+
+    // Find the earliest batch this can be drawn with, which has to be after the last batch that
+    // it overlaps
+    size_t target = mBatches.size();
+    if (texture == nullptr)
+    {
+        target = mBatches.empty() ? 0 : mBatches.size() - 1;
+    }
+    else
+    {
+        size_t stop = mBatches.size() > MAX_LOOKBACK ? mBatches.size() - MAX_LOOKBACK : 0;
+        for (size_t i = mBatches.size(); i > stop; i--)
+        {
+            const Batch& batch = mBatches[i - 1];
+            if (batch.texture == texture || batch.texture == nullptr)
+            {
+                target = i - 1;
+                break;
+            }
+            if (mBatchBounds[i - 1].overlaps(bounds) && overlaps(batch, bounds))
+            {
+                break;
+            }
+        }
+    }
+
+    if (target == mBatches.size())
+    {
+        mBatches.emplace_back(Batch{texture, {}});
+        mBatchBounds.emplace_back(bounds);
+    }
+    Batch& batch = mBatches[target];
+    if (batch.texture == nullptr)
+    {
+        batch.texture = texture;
+    }
+    batch.draws.emplace_back(index);
+    Bounds& batchBounds = mBatchBounds[target];
+    batchBounds.left    = std::min(batchBounds.left, bounds.left);
+    batchBounds.top     = std::min(batchBounds.top, bounds.top);
+    batchBounds.right   = std::max(batchBounds.right, bounds.right);
+    batchBounds.bottom  = std::max(batchBounds.bottom, bounds.bottom);
+
+    return index;
+}
+
+void DrawList::clear()
+{
+    mStats.draws += mBounds.size();
+    mStats.batches += mBatches.size();
+    const void* lastTexture = nullptr;
+    for (const auto& batch : mBatches)
+    {
+        if (batch.texture && batch.texture != lastTexture)
+        {
+            mStats.textureSwitches++;
+            lastTexture = batch.texture;
+        }
+    }
+
+    mBounds.clear();
+    mBatchBounds.clear();
+    mBatches.clear();
+}
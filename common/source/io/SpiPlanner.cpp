@@ -0,0 +1,525 @@
+/*
+ *   This file is part of PKSM
+ *   Copyright (C) 2016-2021 Bernardo Giordano, Admiral Fish, piepie62
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *   Additional Terms 7.b and 7.c of GPLv3 apply to this file:
+ *       * Requiring preservation of specified reasonable legal notices or
+ *         author attributions in that material or in the Appropriate Legal
+ *         Notices displayed by works containing it.
+ *       * Prohibiting misrepresentation of the origin of that material,
+ *         or requiring that modified versions of such material be marked in
+ *         reasonable ways as different from the original version.
+ */
+
+/*
+ *  This file is part of TWLSaveTool.
+ *  Copyright (C) 2015-2016 TuxSH
+ *
+ *  TWLSaveTool is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>
+ */
+
+
+#include "SpiPlanner.hpp"
+#include <algorithm>
+#include <cstring>
+
+namespace
+{
+    constexpr Result UNSUPPORTED = 0xC8E13404;
+
+    u64 fnv1a(u64 hash, const u8* data, u32 size)
+    {
+        for (u32 i = 0; i < size; i++)
+        {
+            hash = (hash ^ data[i]) * 0x100000001B3;
+        }
+        return hash;
+    }
+
+    // Command for reading or writing at pos on every chip but the 512 byte EEPROM
+    u32 addressCommand(CardType type, u8 op, u32 pos, u8* cmd)
+    {
+        cmd[0] = op;
+        if (type == EEPROM_8KB || type == EEPROM_64KB)
+        {
+            cmd[1] = (u8)(pos >> 8);
+            cmd[2] = (u8)pos;
+            return 3;
+        }
+        cmd[1] = (u8)(pos >> 16);
+        cmd[2] = (u8)(pos >> 8);
+        cmd[3] = (u8)pos;
+        return 4;
+    }
+}
+
+u32 SpiPlanner::pageSize(CardType type)
+{
+    u32 EEPROMSizes[] = {16, 32, 128, 256};
+    if (type == NO_CHIP || type > CHIP_LAST)
+        return 0;
+    else if (type < FLASH_256KB_1)
+        return EEPROMSizes[(int)type];
+    else
+        return 256;
+}
+
+u32 SpiPlanner::capacity(CardType type)
+{
+    u32 sz[] = {9, 13, 16, 17, 18, 18, 19, 19, 20, 23, 19, 19};
+
+    if (type == NO_CHIP || type > CHIP_LAST)
+        return 0;
+    else
+        return 1 << sz[(int)type];
+}
+
+Result SpiPlanner::waitWriteEnd(CardType type)
+{
+    if (!mMayBeBusy)
+        return 0;
+
+    u8 cmd = SPI_CMD_RDSR, statusReg = 0;
+    Result res = 0;
+    int panic  = 0;
+    do
+    {
+        panic++;
+        res = mTransport.transfer(type, &cmd, 1, &statusReg, 1, NULL, 0);
+        if (res)
+            return res;
+    }
+    while (statusReg & SPI_FLG_WIP && panic < 1000);
+
+    if (panic >= 1000)
+        return -1;
+    mMayBeBusy = false;
+    return 0;
+}
+
+Result SpiPlanner::enableWriting(CardType type)
+{
+    u8 cmd = SPI_CMD_WREN, statusReg = 0;
+    Result res = mTransport.transfer(type, &cmd, 1, NULL, 0, NULL, 0);
+
+    if (res || type == EEPROM_512B)
+        return res; // Weird, but works (otherwise we're getting an infinite loop for that chip
+                    // type).
+    cmd = SPI_CMD_RDSR;
+
+    do
+    {
+        res = mTransport.transfer(type, &cmd, 1, &statusReg, 1, NULL, 0);
+        if (res)
+            return res;
+    }
+    while (statusReg & ~SPI_FLG_WEL);
+
+    return 0;
+}
+
+Result SpiPlanner::readJEDECIDAndStatusReg(CardType type, u32* id, u8* statusReg)
+{
+    u8 cmd      = SPI_FLASH_CMD_RDID;
+    u8 reg      = 0;
+    u8 idbuf[3] = {0};
+    u32 id_     = 0;
+    Result res  = waitWriteEnd(type);
+    if (res)
+        return res;
+
+    if ((res = mTransport.transfer(type, &cmd, 1, idbuf, 3, NULL, 0)))
+        return res;
+
+    id_ = (idbuf[0] << 16) | (idbuf[1] << 8) | idbuf[2];
+    cmd = SPI_CMD_RDSR;
+
+    if ((res = mTransport.transfer(type, &cmd, 1, &reg, 1, NULL, 0)))
+        return res;
+
+    if (id)
+        *id = id_;
+    if (statusReg)
+        *statusReg = reg;
+
+    return 0;
+}
+
+Result SpiPlanner::write(CardType type, u32 offset, const void* data, u32 size)
+{
+    u8 cmd[4]   = {0};
+    u32 cmdSize = 4;
+
+    u32 end = offset + size;
+    u32 pos = offset;
+    if (size == 0)
+        return 0;
+    u32 pageSize = SpiPlanner::pageSize(type);
+    if (pageSize == 0 || type == FLASH_8MB) // writing is unsupported (so is reading? need to test)
+        return UNSUPPORTED;
+
+    Result res = waitWriteEnd(type);
+    if (res)
+        return res;
+
+    while (pos < end)
+    {
+        if (type == EEPROM_512B)
+        {
+            cmdSize = 2;
+            cmd[0]  = (pos >= 0x100) ? SPI_512B_EEPROM_CMD_WRHI : SPI_512B_EEPROM_CMD_WRLO;
+            cmd[1]  = (u8)pos;
+        }
+        else
+        {
+            cmdSize = addressCommand(
+                type, type < FLASH_256KB_1 ? SPI_EEPROM_CMD_WRITE : SPI_FLASH_CMD_PW, pos, cmd);
+        }
+
+        u32 remaining = end - pos;
+        u32 nb        = pageSize - (pos % pageSize);
+
+        u32 dataSize = (remaining < nb) ? remaining : nb;
+
+        if ((res = enableWriting(type)))
+            return res;
+        mMayBeBusy = true;
+        if ((res = mTransport.transfer(
+                 type, cmd, cmdSize, NULL, 0, (const u8*)data - offset + pos, dataSize)))
+            return res;
+        // The next page can't be sent until this one is programmed
+        if ((res = waitWriteEnd(type)))
+            return res;
+
+        pos = ((pos / pageSize) + 1) * pageSize; // truncate
+    }
+
+    return 0;
+}
+
+Result SpiPlanner::read512B(u32 pos, void* data, u32 size)
+{
+    u8 cmd[2];
+    u32 end = pos + size;
+
+    // The high bit of the address is part of the command, so a read can't cross 0x100
+    if (pos < 0x100)
+    {
+        u32 len = std::min(end, 0x100u) - pos;
+        cmd[0]  = SPI_512B_EEPROM_CMD_RDLO;
+        cmd[1]  = (u8)pos;
+
+        Result res = mTransport.transfer(EEPROM_512B, cmd, 2, data, len, NULL, 0);
+        if (res)
+            return res;
+    }
+
+    if (end > 0x100)
+    {
+        u32 start = std::max(pos, 0x100u);
+        cmd[0]    = SPI_512B_EEPROM_CMD_RDHI;
+        cmd[1]    = (u8)start;
+
+        Result res = mTransport.transfer(
+            EEPROM_512B, cmd, 2, (u8*)data + (start - pos), end - start, NULL, 0);
+        if (res)
+            return res;
+    }
+
+    return 0;
+}
+
+Result SpiPlanner::read(CardType type, u32 offset, void* data, u32 size)
+{
+    if (size == 0)
+        return 0;
+    if (type == NO_CHIP || type > CHIP_LAST)
+        return UNSUPPORTED;
+
+    Result res = waitWriteEnd(type);
+    if (res)
+        return res;
+
+    size = (size <= capacity(type) - offset) ? size : capacity(type) - offset;
+    if (type == EEPROM_512B)
+        return read512B(offset, data, size);
+
+    // Reads carry on from one address to the next for as long as the chip is selected, so a whole
+    // range only needs splitting where the transport requires it
+    u8 cmd[4];
+    u32 pos = offset;
+    u32 end = offset + size;
+    while (pos < end)
+    {
+        u32 len     = std::min(end - pos, mTransport.maxTransfer());
+        u32 cmdSize = addressCommand(type, SPI_CMD_READ, pos, cmd);
+        if ((res = mTransport.transfer(
+                 type, cmd, cmdSize, (u8*)data + (pos - offset), len, NULL, 0)))
+            return res;
+        pos += len;
+    }
+
+    return 0;
+}
+
+Result SpiPlanner::eraseSector(CardType type, u32 offset)
+{
+    u8 cmd[4] = {SPI_FLASH_CMD_SE, (u8)(offset >> 16), (u8)(offset >> 8), (u8)offset};
+    if (type == NO_CHIP || type == FLASH_8MB)
+        return UNSUPPORTED;
+
+    Result res = waitWriteEnd(type);
+    if (res)
+        return res;
+
+    if (type >= FLASH_256KB_1)
+    {
+        if ((res = enableWriting(type)))
+            return res;
+        mMayBeBusy = true;
+        if ((res = mTransport.transfer(type, cmd, 4, NULL, 0, NULL, 0)))
+            return res;
+        if ((res = waitWriteEnd(type)))
+            return res;
+    }
+    // Simulate the same behavior on EEPROM chips.
+    else
+    {
+        if (!mFill)
+        {
+            mFill = std::unique_ptr<u8[]>(new u8[0x10000]);
+            std::memset(mFill.get(), 0xff, 0x10000);
+        }
+        u32 sz = capacity(type);
+        return write(type, 0, mFill.get(), (sz < 0x10000) ? sz : 0x10000);
+    }
+    return 0;
+}
+
+Result SpiPlanner::getCardType(CardType* type, int infrared, const u8* header, u32 headerSize)
+{
+    u8 sr      = 0;
+    u32 jedec  = 0;
+    CardType t = (infrared == 1) ? FLASH_INFRARED_DUMMY : FLASH_STD_DUMMY;
+
+    Result res = readJEDECIDAndStatusReg(t, &jedec, &sr); // dummy
+    if (res)
+        return res;
+
+    u64 identity = 0;
+    if (header)
+    {
+        u8 probe[5] = {(u8)(jedec >> 16), (u8)(jedec >> 8), (u8)jedec, sr, (u8)infrared};
+        identity    = fnv1a(fnv1a(0xCBF29CE484222325, probe, sizeof(probe)), header, headerSize);
+        if (identity == mIdentity)
+        {
+            *type = mIdentityType;
+            return 0;
+        }
+    }
+
+    mIdentity = 0;
+    if ((res = detectCardType(type, infrared, t, jedec, sr)))
+        return res;
+    if (identity != 0)
+    {
+        mIdentity     = identity;
+        mIdentityType = *type;
+    }
+    return 0;
+}
+
+// The following routine use code from savegame-manager:
+
+/*
+ * savegame_manager: a tool to backup and restore savegames from Nintendo
+ *  DS cartridges. Nintendo DS and all derivative names are trademarks
+ *  by Nintendo. EZFlash 3-in-1 is a trademark by EZFlash.
+ *
+ * auxspi.cpp: A thin reimplementation of the AUXSPI protocol
+ *   (high level functions)
+ *
+ * Copyright (C) Pokedoc (2010)
+ */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ */
+
+Result SpiPlanner::isDataMirrored(CardType type, u32 size, bool* mirrored)
+{
+    u32 offset0 = (size - 1);     //      n KB
+    u32 offset1 = (2 * size - 1); //     2n KB
+
+    u8 buf1; //      +0k data        read -> write
+    u8 buf2; //      +n k data        read -> read
+    u8 buf3; //      +0k ~data          write
+    u8 buf4; //      +n k data new    comp buf2
+
+    Result res;
+
+    if ((res = read(type, offset0, &buf1, 1)))
+        return res;
+    if ((res = read(type, offset1, &buf2, 1)))
+        return res;
+    buf3 = ~buf1;
+    if ((res = write(type, offset0, &buf3, 1)))
+        return res;
+    if ((res = read(type, offset1, &buf4, 1)))
+        return res;
+    if ((res = write(type, offset0, &buf1, 1)))
+        return res;
+
+    *mirrored = buf2 != buf4;
+    return 0;
+}
+
+Result SpiPlanner::detectCardType(CardType* type, int infrared, CardType t, u32 jedec, u8 sr)
+{
+    u32 tries = 0;
+    Result res;
+    u32 jedecOrderedList[] = {0x204012, 0x621600, 0x204013, 0x621100, 0x204014, 0x202017};
+
+    u32 maxTries = (infrared == -1) ? 2 : 1; // note: infrared = -1 fails 1/3 of the time
+    // The first probe has already been done by getCardType
+    while (true)
+    {
+        if ((sr & 0xfd) == 0x00 && (jedec != 0x00ffffff))
+        {
+            break;
+        }
+        if ((sr & 0xfd) == 0xF0 && (jedec == 0x00ffffff))
+        {
+            t = EEPROM_512B;
+            break;
+        }
+        if ((sr & 0xfd) == 0x00 && (jedec == 0x00ffffff))
+        {
+            t = EEPROM_STD_DUMMY;
+            break;
+        }
+
+        ++tries;
+        t = FLASH_INFRARED_DUMMY;
+        if (tries >= maxTries)
+        {
+            break;
+        }
+
+        res = readJEDECIDAndStatusReg(t, &jedec, &sr); // dummy
+        if (res)
+            return res;
+    }
+
+    // fprintf(stderr, "CardType (after the maxTries loop): %016lX\n", t);
+
+    if (t == EEPROM_512B)
+    {
+        // fprintf(stderr, "Type is EEPROM_512B: %d\n", t);
+        *type = t;
+        return 0;
+    }
+    else if (t == EEPROM_STD_DUMMY)
+    {
+        bool mirrored = false;
+        if ((res = isDataMirrored(t, 8192, &mirrored)))
+        {
+            return res;
+        }
+        if (mirrored)
+            t = EEPROM_8KB;
+        else
+        {
+            if ((res = isDataMirrored(t, 65536, &mirrored)))
+            {
+                return res;
+            }
+            if (mirrored)
+                t = EEPROM_64KB;
+            else
+                t = EEPROM_128KB;
+        }
+
+        *type = t;
+        // fprintf(stderr, "Type: %d\n", t);
+        return 0;
+    }
+    else if (t == FLASH_INFRARED_DUMMY)
+    {
+        if (infrared == 0)
+            *type = NO_CHIP; // did anything go wrong?
+        if (jedec == jedecOrderedList[0] || jedec == jedecOrderedList[1])
+            *type = FLASH_256KB_INFRARED;
+        else
+            *type = FLASH_512KB_INFRARED;
+        return 0;
+    }
+    else
+    {
+        if (infrared == 1)
+        {
+            *type = NO_CHIP; // did anything go wrong?
+            // fprintf(stderr, "infrared is 1, *type = NO_CHIP\n");
+        }
+        if (jedec == 0x204017)
+        {
+            *type = FLASH_8MB;
+            return 0;
+        } // 8MB. savegame-manager: which one? (more work is required to unlock this save chip!)
+        if (jedec == 0x208013)
+        {
+            *type = FLASH_512KB_1;
+            return 0;
+        }
+
+        for (int i = 0; i < 6; ++i)
+        {
+            if (jedec == jedecOrderedList[i])
+            {
+                *type = (CardType)((int)FLASH_256KB_1 + i);
+                // fprintf(stderr, "Found a jedec equal to one in the ordered list. Type: %016lX",
+                // *type);
+                return 0;
+            }
+        }
+
+        // fprintf(stderr, "*type = NO_CHIP\n");
+        *type = NO_CHIP;
+        return 0;
+    }
+}
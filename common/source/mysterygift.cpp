@@ -26,6 +26,8 @@
 
 #include "mysterygift.hpp"
 #include "BZ2.hpp"
+#include "FileHash.hpp"
+#include "GiftSheet.hpp"
 #include "io.hpp"
 #include "nlohmann/json.hpp"
 #include "utils.hpp"
@@ -37,131 +39,385 @@
 #include "wcx/WC6.hpp"
 #include "wcx/WC7.hpp"
 #include "wcx/WC8.hpp"
+#include <sys/stat.h>
 
 namespace
 {
-    nlohmann::json mysteryGiftSheet;
-    std::vector<u8> mysteryGiftData;
-}
+    // Decompressed gift data is cached on the SD card as independently compressed blocks, so that
+    // opening the gift list doesn't require inflating every card and reading a card only inflates
+    // the blocks it lives in
+    constexpr std::string_view BLOCK_MAGIC = "PKSMMGB2";
+    constexpr u32 BLOCK_SIZE               = 0x8000;
+    // Larger than any wondercard format
+    constexpr u32 MAX_CARD_SIZE = 0x400;
+    struct BlockHeader
+    {
+        char MAGIC[8];
+        // SHA-256 of the .bin.bz2 the blocks were made from. sdmc doesn't keep modification
+        // times, and an updated database can easily be the same size as the old one
+        std::array<u8, 32> sourceHash;
+        u32 dataSize;
+        u32 blockCount;
+    };
+    static_assert(sizeof(BlockHeader) == 48);
 
-void MysteryGift::init(pksm::Generation g)
-{
-    mysteryGiftData.clear();
+    // The sheet is likewise cached as a flat binary index, so that card lookups don't go through
+    // JSON
+    GiftSheet sheet;
 
-    std::string sheetPath = "/3ds/PKSM/mysterygift/sheet" + (std::string)g + ".json.bz2";
-    std::string dataPath  = "/3ds/PKSM/mysterygift/data" + (std::string)g + ".bin.bz2";
-    if (!io::exists(sheetPath) || !io::exists(dataPath))
+    bool readSheet(const std::string& path, const std::array<u8, 32>& source)
     {
-        sheetPath = "romfs:/mg/sheet" + (std::string)g + ".json.bz2";
-        dataPath  = "romfs:/mg/data" + (std::string)g + ".bin.bz2";
+        FILE* f = fopen(path.c_str(), "rb");
+        if (f == NULL)
+        {
+            return false;
+        }
+
+        GiftSheet::Header header;
+        bool ok = fread(&header, 1, sizeof(GiftSheet::Header), f) == sizeof(GiftSheet::Header) &&
+                  !memcmp(header.MAGIC, GiftSheet::MAGIC.data(), GiftSheet::MAGIC.size()) &&
+                  header.sourceHash == source;
+        if (ok)
+        {
+            fseek(f, 0, SEEK_END);
+            ok = (size_t)ftell(f) == GiftSheet::size(header);
+        }
+        if (ok)
+        {
+            std::unique_ptr<u8[]> buffer = std::unique_ptr<u8[]>(new u8[GiftSheet::size(header)]);
+            fseek(f, 0, SEEK_SET);
+            ok = fread(buffer.get(), 1, GiftSheet::size(header), f) == GiftSheet::size(header);
+            if (ok)
+            {
+                sheet.use(std::move(buffer));
+            }
+        }
+        fclose(f);
+        return ok;
     }
 
-    FILE* f = fopen(sheetPath.c_str(), "rb");
-    if (f != NULL)
+    void writeSheet(const std::string& path, const u8* data, size_t size)
     {
-        std::vector<u8> data;
-        int error = BZ2::decompress(f, data);
+        FILE* f = fopen(path.c_str(), "wb");
+        if (f != NULL)
+        {
+            bool ok = fwrite(data, 1, size, f) == size;
+            fclose(f);
+            if (!ok)
+            {
+                remove(path.c_str());
+            }
+        }
+    }
+
+    // Either all of the data or just the inflated blocks holding the last card read, starting at
+    // mysteryGiftDataStart
+    std::vector<u8> mysteryGiftData;
+    u32 mysteryGiftDataStart = 0;
+    u32 mysteryGiftDataSize  = 0;
+    std::string blockPath;
+    std::string dataSourcePath;
+    // File offsets of each block, plus the end of the last one
+    std::vector<u32> blockOffsets;
 
-        if (error == BZ_OK)
+    bool readBlockIndex(const std::array<u8, 32>& source)
+    {
+        FILE* f = fopen(blockPath.c_str(), "rb");
+        if (f == NULL)
         {
-            mysteryGiftSheet = nlohmann::json::parse(data.begin(), data.end(), nullptr, false);
+            return false;
         }
 
+        BlockHeader header;
+        bool ok = fread(&header, 1, sizeof(BlockHeader), f) == sizeof(BlockHeader) &&
+                  !memcmp(header.MAGIC, BLOCK_MAGIC.data(), BLOCK_MAGIC.size()) &&
+                  header.sourceHash == source &&
+                  header.blockCount == (header.dataSize + BLOCK_SIZE - 1) / BLOCK_SIZE;
+        if (ok)
+        {
+            blockOffsets.resize(header.blockCount + 1);
+            ok = fread(blockOffsets.data(), sizeof(u32), blockOffsets.size(), f) ==
+                 blockOffsets.size();
+            mysteryGiftDataSize = header.dataSize;
+        }
         fclose(f);
-    }
 
-    if (mysteryGiftSheet.is_discarded())
-    {
-        mysteryGiftSheet            = nlohmann::json::object();
-        mysteryGiftSheet["gen"]     = "BAD";
-        mysteryGiftSheet["matches"] = nlohmann::json::array();
+        if (!ok)
+        {
+            blockOffsets.clear();
+        }
+        return ok;
     }
 
-    f = fopen(dataPath.c_str(), "rb");
-    if (f != NULL)
+    void writeBlocks(const std::array<u8, 32>& source)
     {
-        int error = BZ2::decompress(f, mysteryGiftData);
+        BlockHeader header;
+        std::copy(BLOCK_MAGIC.begin(), BLOCK_MAGIC.end(), header.MAGIC);
+        header.sourceHash = source;
+        header.dataSize   = mysteryGiftData.size();
+        header.blockCount = (header.dataSize + BLOCK_SIZE - 1) / BLOCK_SIZE;
 
-        if (error != BZ_OK)
+        std::vector<u32> offsets(header.blockCount + 1);
+        offsets[0] = sizeof(BlockHeader) + sizeof(u32) * offsets.size();
+
+        FILE* f = fopen(blockPath.c_str(), "wb");
+        if (f == NULL)
+        {
+            return;
+        }
+        // The header is written last so that a partially written file is never considered valid
+        fseek(f, offsets[0], SEEK_SET);
+
+        std::vector<u8> compressed;
+        bool ok = true;
+        for (u32 block = 0; block < header.blockCount; block++)
         {
-            // TODO
+            u32 size = std::min(BLOCK_SIZE, header.dataSize - block * BLOCK_SIZE);
+            if (BZ2::compress(compressed, mysteryGiftData.data() + block * BLOCK_SIZE, size) !=
+                    BZ_OK ||
+                fwrite(compressed.data(), 1, compressed.size(), f) != compressed.size())
+            {
+                ok = false;
+                break;
+            }
+            offsets[block + 1] = offsets[block] + compressed.size();
         }
 
+        if (ok)
+        {
+            fseek(f, 0, SEEK_SET);
+            fwrite(&header, 1, sizeof(BlockHeader), f);
+            fwrite(offsets.data(), sizeof(u32), offsets.size(), f);
+        }
         fclose(f);
+
+        if (!ok)
+        {
+            remove(blockPath.c_str());
+        }
     }
-}
 
-std::unique_ptr<pksm::WCX> MysteryGift::wondercard(size_t index)
-{
-    std::string gen = mysteryGiftSheet["gen"];
+    // Inflates the whole .bin.bz2 into mysteryGiftData and rebuilds the block file from it
+    void inflateSource()
+    {
+        mysteryGiftData.clear();
+        blockOffsets.clear();
+        mysteryGiftDataStart = 0;
+        mysteryGiftDataSize  = 0;
+
+        struct stat source;
+        bool haveSource = stat(dataSourcePath.c_str(), &source) == 0;
+        FILE* f         = fopen(dataSourcePath.c_str(), "rb");
+        if (f == NULL)
+        {
+            return;
+        }
 
-    auto entry = mysteryGiftSheet["wondercards"][index];
+        // bzip2 doesn't record the inflated size, so start from a guess at the compression ratio
+        // and only go again with a bigger buffer if that wasn't enough
+        size_t capacity = haveSource ? std::max((size_t)source.st_size * 8, (size_t)BLOCK_SIZE)
+                                     : (size_t)BZ2::READ_SIZE;
+        int error;
+        size_t size;
+        do
+        {
+            mysteryGiftData.resize(capacity);
+            size = capacity;
+            fseek(f, 0, SEEK_SET);
+            error = BZ2::decompress(f, mysteryGiftData.data(), size);
+            capacity *= 2;
+        } while (error == BZ_OUTBUFF_FULL);
+        fclose(f);
 
-    u32 offset = entry["offset"];
+        if (error != BZ_OK)
+        {
+            mysteryGiftData.clear();
+            return;
+        }
+        mysteryGiftData.resize(size);
+        mysteryGiftData.shrink_to_fit();
+        mysteryGiftDataSize = size;
+        if (auto hash = FileHash::cachedSha256(dataSourcePath))
+        {
+            writeBlocks(*hash);
+        }
+    }
 
-    if (gen == "4")
+    const u8* cardData(u32 offset)
     {
-        std::unique_ptr<pksm::WCX> wc = nullptr;
-        if (entry["type"] == "wc4")
+        if (offset >= mysteryGiftDataSize)
+        {
+            return nullptr;
+        }
+        u32 end = std::min(offset + MAX_CARD_SIZE, mysteryGiftDataSize);
+        if (offset >= mysteryGiftDataStart && end <= mysteryGiftDataStart + mysteryGiftData.size())
+        {
+            return mysteryGiftData.data() + (offset - mysteryGiftDataStart);
+        }
+        if (blockOffsets.empty())
         {
-            wc = std::make_unique<pksm::WC4>(mysteryGiftData.data() + offset);
+            return nullptr;
         }
-        else if (entry["type"] == "pgt")
+
+        u32 firstBlock = offset / BLOCK_SIZE;
+        u32 lastBlock  = (end - 1) / BLOCK_SIZE;
+        mysteryGiftData.resize((lastBlock - firstBlock + 1) * BLOCK_SIZE);
+        mysteryGiftDataStart = firstBlock * BLOCK_SIZE;
+
+        FILE* f = fopen(blockPath.c_str(), "rb");
+        if (f == NULL)
         {
-            wc = std::make_unique<pksm::PGT>(mysteryGiftData.data() + offset);
+            mysteryGiftData.clear();
+            return nullptr;
         }
-        else
+        std::vector<u8> compressed;
+        size_t filled = 0;
+        for (u32 block = firstBlock; block <= lastBlock; block++)
         {
-            wc = std::make_unique<pksm::PCD>(mysteryGiftData.data() + offset);
+            compressed.resize(blockOffsets[block + 1] - blockOffsets[block]);
+            fseek(f, blockOffsets[block], SEEK_SET);
+            size_t size = BLOCK_SIZE;
+            if (fread(compressed.data(), 1, compressed.size(), f) != compressed.size() ||
+                BZ2::decompress(compressed.data(), compressed.size(),
+                    mysteryGiftData.data() + filled, size) != BZ_OK)
+            {
+                fclose(f);
+                mysteryGiftData.clear();
+                return nullptr;
+            }
+            filled += size;
         }
-        return wc;
+        fclose(f);
+        mysteryGiftData.resize(filled);
+
+        return end <= mysteryGiftDataStart + mysteryGiftData.size()
+                   ? mysteryGiftData.data() + (offset - mysteryGiftDataStart)
+                   : nullptr;
     }
-    else if (gen == "5")
+}
+
+void MysteryGift::init(pksm::Generation g)
+{
+    mysteryGiftData.clear();
+    blockOffsets.clear();
+    mysteryGiftDataStart = 0;
+    mysteryGiftDataSize  = 0;
+
+    std::string sheetPath = "/3ds/PKSM/mysterygift/sheet" + (std::string)g + ".json.bz2";
+    std::string dataPath  = "/3ds/PKSM/mysterygift/data" + (std::string)g + ".bin.bz2";
+    blockPath             = "/3ds/PKSM/mysterygift/data" + (std::string)g + ".bin.blk";
+    if (!io::exists(sheetPath) || !io::exists(dataPath))
     {
-        return std::make_unique<pksm::PGF>(mysteryGiftData.data() + offset);
+        sheetPath = "romfs:/mg/sheet" + (std::string)g + ".json.bz2";
+        dataPath  = "romfs:/mg/data" + (std::string)g + ".bin.bz2";
     }
-    else if (gen == "6")
+
+    std::string sheetCachePath = "/3ds/PKSM/mysterygift/sheet" + (std::string)g + ".bin";
+    auto sheetSource           = FileHash::cachedSha256(sheetPath);
+    if (!sheetSource || !readSheet(sheetCachePath, *sheetSource))
     {
-        return std::make_unique<pksm::WC6>(mysteryGiftData.data() + offset,
-            entry["type"].get<std::string>().find("full") != std::string::npos);
+        nlohmann::json json;
+        FILE* f = fopen(sheetPath.c_str(), "rb");
+        if (f != NULL)
+        {
+            std::vector<u8> data;
+            int error = BZ2::decompress(f, data);
+
+            if (error == BZ_OK)
+            {
+                json = nlohmann::json::parse(data.begin(), data.end(), nullptr, false);
+            }
+
+            fclose(f);
+        }
+
+        std::unique_ptr<u8[]> buffer =
+            GiftSheet::build(json, sheetSource.value_or(std::array<u8, 32>{}));
+        if (sheetSource && !json.is_discarded() && !json.is_null())
+        {
+            writeSheet(sheetCachePath, buffer.get(),
+                GiftSheet::size(*(GiftSheet::Header*)buffer.get()));
+        }
+        sheet.use(std::move(buffer));
     }
-    else if (gen == "7")
+
+    dataSourcePath = dataPath;
+    auto source    = FileHash::cachedSha256(dataPath);
+    if (source && readBlockIndex(*source))
     {
-        return std::make_unique<pksm::WC7>(mysteryGiftData.data() + offset,
-            entry["type"].get<std::string>().find("full") != std::string::npos);
+        return;
     }
-    else if (gen == "LGPE")
+
+    inflateSource();
+}
+
+std::unique_ptr<pksm::WCX> MysteryGift::wondercard(size_t index)
+{
+    if (index >= sheet.count)
     {
-        return std::make_unique<pksm::WB7>(mysteryGiftData.data() + offset,
-            entry["type"].get<std::string>().find("full") != std::string::npos);
+        return nullptr;
     }
-    else if (gen == "8")
+
+    const u8* data = cardData(sheet.offsets[index]);
+    if (!data && !blockOffsets.empty() && sheet.offsets[index] < mysteryGiftDataSize)
     {
-        return std::make_unique<pksm::WC8>(mysteryGiftData.data() + offset);
+        // The block file is damaged; throw it out and rebuild it from the source
+        remove(blockPath.c_str());
+        inflateSource();
+        data = cardData(sheet.offsets[index]);
     }
-    else
+    if (!data)
     {
         return nullptr;
     }
+
+    bool full = sheet.types[index] == GiftSheet::CARD_FULL;
+    switch (sheet.gen)
+    {
+        case GiftSheet::GEN_4:
+            if (sheet.types[index] == GiftSheet::CARD_WC4)
+            {
+                return std::make_unique<pksm::WC4>(data);
+            }
+            else if (sheet.types[index] == GiftSheet::CARD_PGT)
+            {
+                return std::make_unique<pksm::PGT>(data);
+            }
+            return std::make_unique<pksm::PCD>(data);
+        case GiftSheet::GEN_5:
+            return std::make_unique<pksm::PGF>(data);
+        case GiftSheet::GEN_6:
+            return std::make_unique<pksm::WC6>(data, full);
+        case GiftSheet::GEN_7:
+            return std::make_unique<pksm::WC7>(data, full);
+        case GiftSheet::GEN_LGPE:
+            return std::make_unique<pksm::WB7>(data, full);
+        case GiftSheet::GEN_8:
+            return std::make_unique<pksm::WC8>(data);
+        default:
+            return nullptr;
+    }
 }
 
 void MysteryGift::exit(void)
 {
     mysteryGiftData.clear();
-    mysteryGiftSheet.clear();
+    blockOffsets.clear();
+    sheet = GiftSheet{};
 }
 
 std::vector<nlohmann::json> MysteryGift::wondercards()
 {
-    return mysteryGiftSheet["matches"];
+    return sheet.matches;
 }
 
 MysteryGift::giftData MysteryGift::wondercardInfo(size_t index)
 {
-    nlohmann::json entry = mysteryGiftSheet["wondercards"][index];
-    giftData ret(entry["name"].get<std::string>(), entry["game"].get<std::string>(),
-        entry["species"].get<int>(), entry["form"].get<int>(),
-        pksm::Gender(entry["gender"].get<int>()),
-        entry.contains("released") ? entry["released"].get<bool>() : true);
-    return ret;
+    if (index >= sheet.count)
+    {
+        return giftData();
+    }
+    return giftData(sheet.strings + sheet.names[index], sheet.strings + sheet.games[index],
+        sheet.species[index], sheet.forms[index], pksm::Gender(sheet.genders[index]),
+        sheet.released[index]);
 }
@@ -0,0 +1,76 @@
+/*
+ *   This file is part of PKSM
+ *   Copyright (C) 2016-2021 Bernardo Giordano, Admiral Fish, piepie62
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *   Additional Terms 7.b and 7.c of GPLv3 apply to this file:
+ *       * Requiring preservation of specified reasonable legal notices or
+ *         author attributions in that material or in the Appropriate Legal
+ *         Notices displayed by works containing it.
+ *       * Prohibiting misrepresentation of the origin of that material,
+ *         or requiring that modified versions of such material be marked in
+ *         reasonable ways as different from the original version.
+ */
+
+#include "PcmRing.hpp"
+
+PcmRing::PcmRing(size_t blocks, size_t blockSize, Alloc alloc, Release release)
+    : mBlocks(blocks), mMemory((s16*)alloc(blocks * blockSize)), mRelease(release),
+      mBlockSize(blockSize)
+{
+    for (size_t i = 0; i < blocks && mMemory; i++)
+    {
+        mBlocks[i] = Block{mMemory + i * blockSize / sizeof(s16), 0, 0, 0, false, false};
+    }
+}
+
+PcmRing::~PcmRing()
+{
+    if (mMemory)
+    {
+        mRelease(mMemory);
+    }
+}
+
+PcmRing::Block* PcmRing::back()
+{
+    size_t head = mHead.load(std::memory_order_relaxed);
+    // Acquire so that the consumer is finished with the block before it gets overwritten
+    if (head - mTail.load(std::memory_order_acquire) == mBlocks.size())
+    {
+        return nullptr;
+    }
+    return &mBlocks[head % mBlocks.size()];
+}
+
+void PcmRing::push()
+{
+    mHead.store(mHead.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+}
+
+PcmRing::Block* PcmRing::peek(size_t n)
+{
+    size_t tail = mTail.load(std::memory_order_relaxed);
+    if (n >= mHead.load(std::memory_order_acquire) - tail)
+    {
+        return nullptr;
+    }
+    return &mBlocks[(tail + n) % mBlocks.size()];
+}
+
+void PcmRing::pop()
+{
+    mTail.store(mTail.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+}
@@ -64,6 +64,49 @@ int BZ2::decompress(FILE* rawfile, std::vector<u8>& out)
     return BZ_OK;
 }
 
+int BZ2::decompress(FILE* rawfile, u8* out, std::size_t& outSize)
+{
+    int bzerror;
+    BZFILE* file = BZ2_bzReadOpen(&bzerror, rawfile, 0, false, nullptr, 0);
+    if (bzerror != BZ_OK)
+    {
+        outSize = 0;
+        return bzerror;
+    }
+
+    std::size_t written = 0;
+    while (bzerror == BZ_OK && written < outSize)
+    {
+        written += BZ2_bzRead(&bzerror, file, out + written,
+            std::min(outSize - written, std::size_t(READ_SIZE)));
+    }
+
+    if (bzerror == BZ_OK)
+    {
+        // Buffer filled up; check whether the stream is actually done
+        u8 extra;
+        BZ2_bzRead(&bzerror, file, &extra, 1);
+        if (bzerror == BZ_OK)
+        {
+            bzerror = BZ_OUTBUFF_FULL;
+        }
+    }
+
+    int garbageError;
+    BZ2_bzReadClose(&garbageError, file);
+
+    outSize = written;
+    return bzerror == BZ_STREAM_END ? BZ_OK : bzerror;
+}
+
+int BZ2::decompress(const u8* data, std::size_t size, u8* out, std::size_t& outSize)
+{
+    unsigned int written = outSize;
+    int bzerror = BZ2_bzBuffToBuffDecompress((char*)out, &written, (char*)data, size, false, 0);
+    outSize = bzerror == BZ_OK ? written : 0;
+    return bzerror;
+}
+
 int BZ2::compress(FILE* rawfile, const u8* data, std::size_t size)
 {
     int bzerror;
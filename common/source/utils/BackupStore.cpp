@@ -0,0 +1,504 @@
+/*
+ *   This file is part of PKSM
+ *   Copyright (C) 2016-2021 Bernardo Giordano, Admiral Fish, piepie62
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *   Additional Terms 7.b and 7.c of GPLv3 apply to this file:
+ *       * Requiring preservation of specified reasonable legal notices or
+ *         author attributions in that material or in the Appropriate Legal
+ *         Notices displayed by works containing it.
+ *       * Prohibiting misrepresentation of the origin of that material,
+ *         or requiring that modified versions of such material be marked in
+ *         reasonable ways as different from the original version.
+ */
+
+#include "BackupStore.hpp"
+#include "utils/crypto.hpp"
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <dirent.h>
+#include <functional>
+#include <mutex>
+#include <set>
+#include <stdio.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#define CHUNK_PATH "/3ds/PKSM/backups/chunks"
+
+namespace
+{
+    // Manifest layout: magic, u32 version, u32 chunk size, u64 data size, then one SHA-256 per
+    // chunk. Everything is little endian
+    constexpr char MAGIC[8]      = {'P', 'K', 'S', 'M', 'C', 'H', 'N', 'K'};
+    constexpr u32 VERSION        = 1;
+    constexpr size_t HEADER_SIZE = 24;
+
+    using Hash = std::array<u8, 32>;
+
+    // Held while writing and while collecting, so that chunks stored for a manifest that hasn't
+    // been written yet are never collected
+    std::mutex storeMutex;
+
+    std::string chunkPath(const Hash& hash)
+    {
+        static constexpr char digits[] = "0123456789abcdef";
+        std::string ret                = CHUNK_PATH "/";
+        for (size_t i = 0; i < hash.size(); i++)
+        {
+            ret += digits[hash[i] >> 4];
+            ret += digits[hash[i] & 0xF];
+            if (i == 0)
+            {
+                ret += '/';
+            }
+        }
+        return ret;
+    }
+
+    Hash hashChunk(const u8* data, size_t size)
+    {
+        pksm::crypto::SHA256 context;
+        context.update(data, size);
+        return context.finish();
+    }
+
+    void putLE(u8* out, u64 value, size_t bytes)
+    {
+        for (size_t i = 0; i < bytes; i++)
+        {
+            out[i] = u8(value >> (i * 8));
+        }
+    }
+
+    u64 getLE(const u8* in, size_t bytes)
+    {
+        u64 ret = 0;
+        for (size_t i = 0; i < bytes; i++)
+        {
+            ret |= u64(in[i]) << (i * 8);
+        }
+        return ret;
+    }
+
+    bool storeChunk(const Hash& hash, const u8* data, size_t size, bool& written)
+    {
+        std::string path = chunkPath(hash);
+        struct stat info;
+        written = false;
+        // A chunk is only ever put in place once fully written, so the size is enough to trust it
+        if (stat(path.c_str(), &info) == 0 && (size_t)info.st_size == size)
+        {
+            return true;
+        }
+
+        mkdir(CHUNK_PATH, 777);
+        mkdir(path.substr(0, path.rfind('/')).c_str(), 777);
+        std::string temp = path + ".tmp";
+        FILE* out        = fopen(temp.c_str(), "wb");
+        if (!out)
+        {
+            return false;
+        }
+        bool good = fwrite(data, 1, size, out) == size;
+        good      = fclose(out) == 0 && good;
+        remove(path.c_str());
+        if (!good || rename(temp.c_str(), path.c_str()) != 0)
+        {
+            remove(temp.c_str());
+            return false;
+        }
+        written = true;
+        return true;
+    }
+
+    bool parseHash(const std::string& name, Hash& hash)
+    {
+        if (name.size() != hash.size() * 2)
+        {
+            return false;
+        }
+        for (size_t i = 0; i < name.size(); i++)
+        {
+            char c = name[i];
+            u8 value;
+            if (c >= '0' && c <= '9')
+            {
+                value = c - '0';
+            }
+            else if (c >= 'a' && c <= 'f')
+            {
+                value = c - 'a' + 10;
+            }
+            else
+            {
+                return false;
+            }
+            hash[i / 2] = (i % 2) ? (hash[i / 2] | value) : (value << 4);
+        }
+        return true;
+    }
+
+    bool isFolder(const std::string& path, const dirent* entry)
+    {
+        if (entry->d_type != DT_UNKNOWN)
+        {
+            return entry->d_type == DT_DIR;
+        }
+        struct stat info;
+        return stat(path.c_str(), &info) == 0 && S_ISDIR(info.st_mode);
+    }
+
+    // Adds the chunks listed by path to referenced if it's a manifest. Only fails if the file looks
+    // like a manifest but couldn't be read in full
+    bool addReferences(const std::string& path, std::set<Hash>& referenced)
+    {
+        FILE* in = fopen(path.c_str(), "rb");
+        if (!in)
+        {
+            return true;
+        }
+        u8 header[HEADER_SIZE];
+        if (fread(header, 1, HEADER_SIZE, in) != HEADER_SIZE ||
+            std::memcmp(header, MAGIC, sizeof(MAGIC)) != 0)
+        {
+            fclose(in);
+            return true;
+        }
+
+        fseek(in, 0, SEEK_END);
+        long size = ftell(in);
+        if (size < (long)HEADER_SIZE ||
+            (size_t)size > HEADER_SIZE + BackupStore::MAX_SIZE / BackupStore::CHUNK_SIZE * 32)
+        {
+            fclose(in);
+            return true;
+        }
+        std::unique_ptr<u8[]> manifest(new u8[size]);
+        fseek(in, 0, SEEK_SET);
+        bool good = fread(manifest.get(), 1, size, in) == (size_t)size;
+        fclose(in);
+        if (!good)
+        {
+            return false;
+        }
+        if (BackupStore::isManifest(manifest.get(), size))
+        {
+            for (size_t offset = HEADER_SIZE; offset < (size_t)size; offset += 32)
+            {
+                Hash hash;
+                std::memcpy(hash.data(), manifest.get() + offset, hash.size());
+                referenced.insert(hash);
+            }
+        }
+        return true;
+    }
+
+    // Calls visit with every file in path, or just path if it's a file. The chunks themselves are
+    // skipped. Stops as soon as visit returns false
+    bool walk(const std::string& path, const std::function<bool(const std::string&)>& visit)
+    {
+        struct stat info;
+        if (stat(path.c_str(), &info) != 0)
+        {
+            return true;
+        }
+        if (!S_ISDIR(info.st_mode))
+        {
+            return visit(path);
+        }
+
+        DIR* dir = opendir(path.c_str());
+        if (!dir)
+        {
+            return false;
+        }
+        // Visiting can replace files, which can make a folder that's still being listed skip
+        // entries
+        std::vector<std::pair<std::string, bool>> entries;
+        while (dirent* entry = readdir(dir))
+        {
+            std::string name = entry->d_name;
+            std::string full = path + '/' + name;
+            if (name != "." && name != ".." && full != CHUNK_PATH)
+            {
+                entries.emplace_back(full, isFolder(full, entry));
+            }
+        }
+        closedir(dir);
+        for (const auto& [full, folder] : entries)
+        {
+            if (!(folder ? walk(full, visit) : visit(full)))
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    // Writes the data described by the manifest at path to a temporary file and puts it in the
+    // manifest's place. Chunks are checked against their hashes on the way, and the manifest is
+    // left alone if anything is wrong with them
+    bool expandManifest(const std::string& path)
+    {
+        FILE* in = fopen(path.c_str(), "rb");
+        if (!in)
+        {
+            return false;
+        }
+        fseek(in, 0, SEEK_END);
+        long size = ftell(in);
+        if (size < (long)HEADER_SIZE ||
+            (size_t)size > HEADER_SIZE + BackupStore::MAX_SIZE / BackupStore::CHUNK_SIZE * 32)
+        {
+            fclose(in);
+            return true;
+        }
+        std::unique_ptr<u8[]> manifest(new u8[size]);
+        fseek(in, 0, SEEK_SET);
+        bool good = fread(manifest.get(), 1, size, in) == (size_t)size;
+        fclose(in);
+        if (!good)
+        {
+            return false;
+        }
+        if (!BackupStore::isManifest(manifest.get(), size))
+        {
+            return true;
+        }
+
+        const size_t chunkSize = getLE(manifest.get() + 12, 4);
+        const size_t dataSize  = getLE(manifest.get() + 16, 8);
+        std::string temp       = path + ".tmp";
+        FILE* out              = fopen(temp.c_str(), "wb");
+        if (!out)
+        {
+            return false;
+        }
+        std::unique_ptr<u8[]> chunk(new u8[chunkSize]);
+        for (size_t offset = 0; good && offset < dataSize; offset += chunkSize)
+        {
+            Hash hash;
+            std::memcpy(hash.data(), manifest.get() + HEADER_SIZE + offset / chunkSize * 32,
+                hash.size());
+            size_t length = std::min(chunkSize, dataSize - offset);
+            FILE* chunkIn = fopen(chunkPath(hash).c_str(), "rb");
+            good          = chunkIn && fread(chunk.get(), 1, length, chunkIn) == length &&
+                   hashChunk(chunk.get(), length) == hash &&
+                   fwrite(chunk.get(), 1, length, out) == length;
+            if (chunkIn)
+            {
+                fclose(chunkIn);
+            }
+        }
+        good = fclose(out) == 0 && good;
+        if (!good)
+        {
+            remove(temp.c_str());
+            return false;
+        }
+        // The chunks are collected later on, once nothing lists them anymore. If the rename fails
+        // the data is still in the temporary file
+        remove(path.c_str());
+        return rename(temp.c_str(), path.c_str()) == 0;
+    }
+}
+
+bool BackupStore::write(const std::string& path, const u8* data, size_t size, Stats* stats)
+{
+    size_t offset = 0;
+    return write(
+        path, size,
+        [&](u8* out, size_t length)
+        {
+            std::memcpy(out, data + offset, length);
+            offset += length;
+            return true;
+        },
+        stats);
+}
+
+bool BackupStore::write(const std::string& path, size_t size,
+    const std::function<bool(u8*, size_t)>& next, Stats* stats)
+{
+    std::lock_guard<std::mutex> lock(storeMutex);
+    const size_t chunks = (size + CHUNK_SIZE - 1) / CHUNK_SIZE;
+    std::unique_ptr<u8[]> manifest(new u8[HEADER_SIZE + chunks * 32]);
+    std::unique_ptr<u8[]> chunk(new u8[CHUNK_SIZE]);
+    std::memcpy(manifest.get(), MAGIC, sizeof(MAGIC));
+    putLE(manifest.get() + 8, VERSION, 4);
+    putLE(manifest.get() + 12, CHUNK_SIZE, 4);
+    putLE(manifest.get() + 16, size, 8);
+
+    for (size_t i = 0; i < chunks; i++)
+    {
+        size_t length = std::min(CHUNK_SIZE, size - i * CHUNK_SIZE);
+        if (!next(chunk.get(), length))
+        {
+            return false;
+        }
+        Hash hash = hashChunk(chunk.get(), length);
+        bool written;
+        if (!storeChunk(hash, chunk.get(), length, written))
+        {
+            return false;
+        }
+        std::memcpy(manifest.get() + HEADER_SIZE + i * 32, hash.data(), hash.size());
+        if (stats)
+        {
+            stats->chunks++;
+            stats->written += written ? 1 : 0;
+        }
+    }
+
+    FILE* out = fopen(path.c_str(), "wb");
+    if (!out)
+    {
+        return false;
+    }
+    const size_t manifestSize = HEADER_SIZE + chunks * 32;
+    bool good                 = fwrite(manifest.get(), 1, manifestSize, out) == manifestSize;
+    return fclose(out) == 0 && good;
+}
+
+bool BackupStore::isManifest(const u8* data, size_t size)
+{
+    if (size < HEADER_SIZE || std::memcmp(data, MAGIC, sizeof(MAGIC)) != 0 ||
+        getLE(data + 8, 4) != VERSION)
+    {
+        return false;
+    }
+    u64 chunkSize = getLE(data + 12, 4);
+    u64 dataSize  = getLE(data + 16, 8);
+    return chunkSize != 0 && dataSize <= BackupStore::MAX_SIZE &&
+           size == HEADER_SIZE + (dataSize + chunkSize - 1) / chunkSize * 32;
+}
+
+std::shared_ptr<u8[]> BackupStore::read(
+    const u8* manifest, size_t manifestSize, size_t& size, size_t maxSize)
+{
+    if (!isManifest(manifest, manifestSize) || getLE(manifest + 16, 8) > maxSize)
+    {
+        return nullptr;
+    }
+    const size_t chunkSize = getLE(manifest + 12, 4);
+    size                   = getLE(manifest + 16, 8);
+    const size_t chunks    = (manifestSize - HEADER_SIZE) / 32;
+
+    std::shared_ptr<u8[]> ret(new u8[size]);
+    for (size_t i = 0; i < chunks; i++)
+    {
+        Hash hash;
+        std::memcpy(hash.data(), manifest + HEADER_SIZE + i * 32, hash.size());
+        size_t offset = i * chunkSize;
+        size_t length = std::min(chunkSize, size - offset);
+
+        FILE* in = fopen(chunkPath(hash).c_str(), "rb");
+        if (!in)
+        {
+            return nullptr;
+        }
+        bool good = fread(ret.get() + offset, 1, length, in) == length;
+        fclose(in);
+        if (!good || hashChunk(ret.get() + offset, length) != hash)
+        {
+            return nullptr;
+        }
+    }
+    return ret;
+}
+
+size_t BackupStore::collect(const std::vector<std::string>& paths)
+{
+    std::lock_guard<std::mutex> lock(storeMutex);
+    DIR* chunks = opendir(CHUNK_PATH);
+    if (!chunks)
+    {
+        return 0;
+    }
+
+    std::set<Hash> referenced;
+    for (const auto& path : paths)
+    {
+        if (!walk(path, [&referenced](const std::string& file)
+                { return addReferences(file, referenced); }))
+        {
+            closedir(chunks);
+            return 0;
+        }
+    }
+
+    std::vector<std::string> prefixes;
+    while (dirent* prefix = readdir(chunks))
+    {
+        std::string prefixName = prefix->d_name;
+        if (prefixName.size() == 2 && isFolder(CHUNK_PATH "/" + prefixName, prefix))
+        {
+            prefixes.emplace_back(prefixName);
+        }
+    }
+    closedir(chunks);
+
+    size_t removed = 0;
+    for (const auto& prefixName : prefixes)
+    {
+        std::string prefixPath = CHUNK_PATH "/" + prefixName;
+        DIR* dir               = opendir(prefixPath.c_str());
+        if (!dir)
+        {
+            continue;
+        }
+        // Deleting while the folder is still being listed can make it skip entries
+        std::vector<std::pair<std::string, bool>> unused;
+        while (dirent* entry = readdir(dir))
+        {
+            std::string name = entry->d_name;
+            Hash hash;
+            bool temp = name.size() > 4 && name.substr(name.size() - 4) == ".tmp";
+            if (temp || (parseHash(prefixName + name, hash) && !referenced.count(hash)))
+            {
+                unused.emplace_back(prefixPath + '/' + name, temp);
+            }
+        }
+        closedir(dir);
+        for (const auto& [path, temp] : unused)
+        {
+            if (remove(path.c_str()) == 0 && !temp)
+            {
+                removed++;
+            }
+        }
+        // Only succeeds once the folder is empty
+        rmdir(prefixPath.c_str());
+    }
+    return removed;
+}
+
+bool BackupStore::expand(const std::vector<std::string>& paths)
+{
+    std::lock_guard<std::mutex> lock(storeMutex);
+    bool good = true;
+    for (const auto& path : paths)
+    {
+        // Carry on past failures, so that one bad backup doesn't keep the rest from converting
+        walk(path, [&good](const std::string& file)
+            {
+                good = expandManifest(file) && good;
+                return true;
+            });
+    }
+    return good;
+}
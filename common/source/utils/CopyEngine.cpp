@@ -0,0 +1,315 @@
+/*
+ *   This file is part of PKSM
+ *   Copyright (C) 2016-2021 Bernardo Giordano, Admiral Fish, piepie62
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *   Additional Terms 7.b and 7.c of GPLv3 apply to this file:
+ *       * Requiring preservation of specified reasonable legal notices or
+ *         author attributions in that material or in the Appropriate Legal
+ *         Notices displayed by works containing it.
+ *       * Prohibiting misrepresentation of the origin of that material,
+ *         or requiring that modified versions of such material be marked in
+ *         reasonable ways as different from the original version.
+ */
+
+#include "CopyEngine.hpp"
+#include "thread.hpp"
+#include <algorithm>
+#include <cerrno>
+
+namespace
+{
+    using Clock = std::chrono::steady_clock;
+
+    std::mutex totalsLock;
+    CopyEngine::Stats allStats;
+
+    u64 micros(Clock::duration duration)
+    {
+        return std::chrono::duration_cast<std::chrono::microseconds>(duration).count();
+    }
+}
+
+CopyEngine::Stats& CopyEngine::Stats::operator+=(const Stats& other)
+{
+    bytes += other.bytes;
+    files += other.files;
+    readTime += other.readTime;
+    writeTime += other.writeTime;
+    stallTime += other.stallTime;
+    totalTime += other.totalTime;
+    return *this;
+}
+
+u32 CopyEngine::StdioReader::read(u8* buf, u32 size)
+{
+    u32 ret = std::fread(buf, 1, size, mFile);
+    if (ret != size && std::ferror(mFile))
+    {
+        mResult = -errno;
+    }
+    return ret;
+}
+
+u32 CopyEngine::StdioWriter::write(const u8* buf, u32 size)
+{
+    u32 ret = std::fwrite(buf, 1, size, mFile);
+    if (ret != size)
+    {
+        mResult = -errno;
+    }
+    return ret;
+}
+
+CopyEngine::CopyEngine(Progress progress, u64 total)
+    : mProgress(std::move(progress)), mTotal(total), mLastReport(Clock::now())
+{
+}
+
+CopyEngine::~CopyEngine()
+{
+    {
+        std::unique_lock<std::mutex> lock(mLock);
+        mStopping = true;
+        mWake.notify_all();
+        mWake.wait(lock, [this] { return !mRunning; });
+    }
+
+    std::lock_guard<std::mutex> lock(totalsLock);
+    allStats += mStats;
+}
+
+CopyEngine::Stats CopyEngine::totals()
+{
+    std::lock_guard<std::mutex> lock(totalsLock);
+    return allStats;
+}
+
+void CopyEngine::readerThread(void* arg)
+{
+    CopyEngine* self = (CopyEngine*)arg;
+    std::unique_lock<std::mutex> lock(self->mLock);
+    while (true)
+    {
+        self->mWake.wait(lock, [self] { return self->mPending || self->mStopping; });
+        if (self->mPending)
+        {
+            lock.unlock();
+            self->read(self->mRequest);
+            lock.lock();
+            self->mPending  = false;
+            self->mFinished = true;
+            self->mWake.notify_all();
+        }
+        else
+        {
+            self->mRunning = false;
+            self->mWake.notify_all();
+            return;
+        }
+    }
+}
+
+void CopyEngine::startReader()
+{
+    if (!mRunning && !mNoThread)
+    {
+        mRunning = true;
+        if (!Threads::create(readerThread, this))
+        {
+            mRunning  = false;
+            mNoThread = true;
+        }
+    }
+}
+
+void CopyEngine::read(Request& request)
+{
+    auto start     = Clock::now();
+    request.got    = request.in->read(request.buf, request.size);
+    request.result = request.in->result();
+    // Only this thread touches readTime while a read is pending
+    mStats.readTime += micros(Clock::now() - start);
+}
+
+void CopyEngine::post(Reader& in, u8* buf, u32 size)
+{
+    std::lock_guard<std::mutex> lock(mLock);
+    mRequest = Request{&in, buf, size, 0, 0};
+    if (mRunning)
+    {
+        mPending = true;
+        mWake.notify_all();
+    }
+    else
+    {
+        read(mRequest);
+        mFinished = true;
+    }
+}
+
+CopyEngine::Request CopyEngine::wait()
+{
+    auto start = Clock::now();
+    std::unique_lock<std::mutex> lock(mLock);
+    mWake.wait(lock, [this] { return mFinished; });
+    mFinished = false;
+    mStats.stallTime += micros(Clock::now() - start);
+    return mRequest;
+}
+
+void CopyEngine::report()
+{
+    if (!mProgress)
+    {
+        return;
+    }
+    auto now = Clock::now();
+    // Once anything has been shown, make sure it ends on the finished total
+    if (now - mLastReport >= PROGRESS_INTERVAL || (mReported && mDone == mTotal))
+    {
+        mProgress(mDone / 1024, mTotal / 1024);
+        mLastReport = now;
+        mReported   = true;
+    }
+}
+
+Result CopyEngine::copy(Reader& in, Writer& out, u64 size)
+{
+    auto begin = Clock::now();
+    if (!mBuffers[0])
+    {
+        mBuffers[0] = std::unique_ptr<u8[]>(new u8[CHUNK_SIZE]);
+        mBuffers[1] = std::unique_ptr<u8[]>(new u8[CHUNK_SIZE]);
+    }
+    // A single chunk has nothing to overlap with, so don't bother with the thread for it
+    if (size > CHUNK_SIZE)
+    {
+        startReader();
+    }
+    mTotal = std::max(mTotal, mDone + size);
+
+    Result res       = 0;
+    u64 requested    = 0;
+    u64 written      = 0;
+    size_t current   = 0;
+    bool outstanding = false;
+    if (size > 0)
+    {
+        u32 chunk = std::min<u64>(CHUNK_SIZE, size);
+        post(in, mBuffers[current].get(), chunk);
+        requested += chunk;
+        outstanding = true;
+    }
+
+    while (outstanding)
+    {
+        Request done = wait();
+        outstanding  = false;
+        if (R_FAILED(res = done.result))
+        {
+            break;
+        }
+        if (done.got != done.size)
+        {
+            res = INCOMPLETE;
+            break;
+        }
+
+        // Start on the next chunk before writing this one
+        if (requested < size)
+        {
+            u32 chunk = std::min<u64>(CHUNK_SIZE, size - requested);
+            post(in, mBuffers[current ^ 1].get(), chunk);
+            requested += chunk;
+            outstanding = true;
+        }
+
+        auto start = Clock::now();
+        u32 wrote  = out.write(done.buf, done.got);
+        mStats.writeTime += micros(Clock::now() - start);
+        written += wrote;
+        mStats.bytes += wrote;
+        mDone += wrote;
+        if (R_FAILED(res = out.result()))
+        {
+            break;
+        }
+        if (wrote != done.got)
+        {
+            res = INCOMPLETE;
+            break;
+        }
+
+        current ^= 1;
+        report();
+    }
+
+    // The reader may still be filling the other buffer if the write failed
+    if (outstanding)
+    {
+        wait();
+    }
+
+    if (!R_FAILED(res))
+    {
+        mStats.files++;
+    }
+    else
+    {
+        // Whatever wasn't copied won't be any more
+        mTotal -= std::min(mTotal - mDone, size - written);
+    }
+    mStats.totalTime += micros(Clock::now() - begin);
+    return res;
+}
+
+Result CopyEngine::copy(const std::string& src, const std::string& dest)
+{
+    std::FILE* in = std::fopen(src.c_str(), "rb");
+    if (!in)
+    {
+        return -errno;
+    }
+    std::FILE* out = std::fopen(dest.c_str(), "wb");
+    if (!out)
+    {
+        Result res = -errno;
+        std::fclose(in);
+        return res;
+    }
+
+    Result res = 0;
+    u64 size   = 0;
+    if (std::fseek(in, 0, SEEK_END) == 0)
+    {
+        size = std::ftell(in);
+        std::fseek(in, 0, SEEK_SET);
+    }
+    StdioReader reader(in);
+    StdioWriter writer(out);
+    res = copy(reader, writer, size);
+
+    std::fclose(in);
+    if (std::fclose(out) != 0 && !R_FAILED(res))
+    {
+        res = -errno;
+    }
+    if (R_FAILED(res))
+    {
+        std::remove(dest.c_str());
+    }
+    return res;
+}
@@ -0,0 +1,155 @@
+/*
+ *   This file is part of PKSM
+ *   Copyright (C) 2016-2021 Bernardo Giordano, Admiral Fish, piepie62
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *   Additional Terms 7.b and 7.c of GPLv3 apply to this file:
+ *       * Requiring preservation of specified reasonable legal notices or
+ *         author attributions in that material or in the Appropriate Legal
+ *         Notices displayed by works containing it.
+ *       * Prohibiting misrepresentation of the origin of that material,
+ *         or requiring that modified versions of such material be marked in
+ *         reasonable ways as different from the original version.
+ */
+
+#include "FileHash.hpp"
+#include "nlohmann/json.hpp"
+#include "utils/crypto.hpp"
+#include <memory>
+#include <mutex>
+#include <stdio.h>
+#include <sys/stat.h>
+#ifdef _3DS
+#include <3ds.h>
+#endif
+
+#define HASH_CACHE_PATH "/3ds/PKSM/hashcache.json"
+
+namespace
+{
+    std::mutex cacheMutex;
+    std::unique_ptr<nlohmann::json> cache;
+
+    nlohmann::json& loadCache()
+    {
+        if (!cache)
+        {
+            cache = std::make_unique<nlohmann::json>(nlohmann::json::object());
+            if (FILE* in = fopen(HASH_CACHE_PATH, "rb"))
+            {
+                auto json = nlohmann::json::parse(in, nullptr, false);
+                if (json.is_object())
+                {
+                    *cache = std::move(json);
+                }
+                fclose(in);
+            }
+        }
+        return *cache;
+    }
+
+    void saveCache()
+    {
+        if (FILE* out = fopen(HASH_CACHE_PATH, "wb"))
+        {
+            std::string data = cache->dump();
+            fwrite(data.data(), 1, data.size(), out);
+            fclose(out);
+        }
+    }
+}
+
+std::optional<std::array<u8, 32>> FileHash::sha256(const std::string& path)
+{
+    FILE* in = fopen(path.c_str(), "rb");
+    if (!in)
+    {
+        return std::nullopt;
+    }
+
+    pksm::crypto::SHA256 context;
+    auto buffer = std::unique_ptr<u8[]>(new u8[READ_SIZE]);
+    size_t read;
+    while ((read = fread(buffer.get(), 1, READ_SIZE, in)) > 0)
+    {
+        context.update(buffer.get(), read);
+    }
+    fclose(in);
+
+    return context.finish();
+}
+
+u64 FileHash::modificationTime(const std::string& path)
+{
+#ifdef _3DS
+    // sdmc's stat doesn't fill in st_mtime
+    u64 mtime = 0;
+    if (R_FAILED(archive_getmtime(path.c_str(), &mtime)))
+    {
+        return 0;
+    }
+    return mtime;
+#else
+    struct stat info;
+    if (stat(path.c_str(), &info) != 0)
+    {
+        return 0;
+    }
+    return info.st_mtime;
+#endif
+}
+
+std::optional<std::array<u8, 32>> FileHash::cachedSha256(const std::string& path)
+{
+    struct stat source;
+    if (stat(path.c_str(), &source) != 0)
+    {
+        return std::nullopt;
+    }
+    // Without a modification time, a changed file of the same size would look unchanged
+    u64 mtime = modificationTime(path);
+    if (mtime == 0)
+    {
+        return sha256(path);
+    }
+
+    std::lock_guard<std::mutex> lock(cacheMutex);
+    nlohmann::json& entries = loadCache();
+    if (entries.contains(path))
+    {
+        const auto& entry = entries[path];
+        // clang-format off
+        if (entry.is_object() &&
+            entry.contains("size") && entry["size"].is_number_unsigned() &&
+            entry.contains("mtime") && entry["mtime"].is_number_unsigned() &&
+            entry.contains("sha256") && entry["sha256"].is_array() &&
+            entry["sha256"].size() == 32 &&
+            entry["size"].get<u64>() == (u64)source.st_size &&
+            entry["mtime"].get<u64>() == mtime)
+        // clang-format on
+        {
+            return entry["sha256"].get<std::array<u8, 32>>();
+        }
+    }
+
+    auto hash = sha256(path);
+    if (hash)
+    {
+        entries[path] = {{"size", (u64)source.st_size}, {"mtime", mtime},
+            {"sha256", *hash}};
+        saveCache();
+    }
+    return hash;
+}
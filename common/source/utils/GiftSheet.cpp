@@ -0,0 +1,152 @@
+/*
+ *   This file is part of PKSM
+ *   Copyright (C) 2016-2021 Bernardo Giordano, Admiral Fish, piepie62
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *   Additional Terms 7.b and 7.c of GPLv3 apply to this file:
+ *       * Requiring preservation of specified reasonable legal notices or
+ *         author attributions in that material or in the Appropriate Legal
+ *         Notices displayed by works containing it.
+ *       * Prohibiting misrepresentation of the origin of that material,
+ *         or requiring that modified versions of such material be marked in
+ *         reasonable ways as different from the original version.
+ */
+
+#include "GiftSheet.hpp"
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace
+{
+    constexpr size_t cardSize()
+    {
+        return sizeof(u32) * 3 + sizeof(s16) * 2 + sizeof(u8) * 4;
+    }
+}
+
+size_t GiftSheet::size(const Header& header)
+{
+    return sizeof(Header) + cardSize() * header.count + header.stringsSize + header.matchesSize;
+}
+
+void GiftSheet::use(std::unique_ptr<u8[]> buffer)
+{
+    const Header& header = *(const Header*)buffer.get();
+    const u8* data       = buffer.get() + sizeof(Header);
+    gen                  = Gen(header.gen);
+    count                = header.count;
+    offsets              = (const u32*)data;
+    names                = offsets + header.count;
+    games                = names + header.count;
+    species              = (const s16*)(games + header.count);
+    forms                = species + header.count;
+    genders              = (const u8*)(forms + header.count);
+    released             = genders + header.count;
+    types                = released + header.count;
+    strings              = (const char*)(types + header.count);
+
+    const char* matchesData = strings + header.stringsSize;
+    matches = nlohmann::json::parse(matchesData, matchesData + header.matchesSize, nullptr, false);
+    if (!matches.is_array())
+    {
+        matches = nlohmann::json::array();
+    }
+    this->buffer = std::move(buffer);
+}
+
+std::unique_ptr<u8[]> GiftSheet::build(
+    const nlohmann::json& json, const std::array<u8, 32>& sourceHash)
+{
+    Header header;
+    std::copy(MAGIC.begin(), MAGIC.end(), header.MAGIC);
+    header.sourceHash = sourceHash;
+    header.gen        = GEN_BAD;
+    header.count      = 0;
+
+    std::string matchesData = "[]";
+    std::string strings;
+    std::vector<u32> offsets, names, games;
+    std::vector<s16> species, forms;
+    std::vector<u8> genders, released, types;
+
+    if (json.is_object() && json.contains("gen") && json["gen"].is_string() &&
+        json.contains("wondercards") && json["wondercards"].is_array() &&
+        json.contains("matches") && json["matches"].is_array())
+    {
+        const std::string& gen = json["gen"].get_ref<const std::string&>();
+        header.gen             = gen == "4"      ? GEN_4
+                                 : gen == "5"    ? GEN_5
+                                 : gen == "6"    ? GEN_6
+                                 : gen == "7"    ? GEN_7
+                                 : gen == "LGPE" ? GEN_LGPE
+                                 : gen == "8"    ? GEN_8
+                                                 : GEN_BAD;
+        // Many cards share their game strings, so identical strings are stored once
+        std::unordered_map<std::string, u32> interned;
+        auto intern = [&](const std::string& str)
+        {
+            auto found = interned.find(str);
+            if (found != interned.end())
+            {
+                return found->second;
+            }
+            u32 offset = strings.size();
+            strings.append(str.c_str(), str.size() + 1);
+            interned.emplace(str, offset);
+            return offset;
+        };
+
+        for (const auto& entry : json["wondercards"])
+        {
+            std::string type = entry["type"].get<std::string>();
+            offsets.push_back(entry["offset"].get<u32>());
+            names.push_back(intern(entry["name"].get<std::string>()));
+            games.push_back(intern(entry["game"].get<std::string>()));
+            species.push_back(entry["species"].get<int>());
+            forms.push_back(entry["form"].get<int>());
+            genders.push_back(entry["gender"].get<int>());
+            released.push_back(entry.contains("released") ? entry["released"].get<bool>() : true);
+            types.push_back(type == "wc4"                            ? CARD_WC4
+                            : type == "pgt"                          ? CARD_PGT
+                            : type.find("full") != std::string::npos ? CARD_FULL
+                                                                     : CARD_DEFAULT);
+        }
+        header.count = offsets.size();
+        matchesData  = json["matches"].dump();
+    }
+    header.stringsSize = strings.size();
+    header.matchesSize = matchesData.size();
+
+    std::unique_ptr<u8[]> buffer = std::unique_ptr<u8[]>(new u8[size(header)]);
+    u8* out                      = buffer.get();
+    auto append                  = [&out](const void* data, size_t size)
+    {
+        std::copy((const u8*)data, (const u8*)data + size, out);
+        out += size;
+    };
+    append(&header, sizeof(Header));
+    append(offsets.data(), sizeof(u32) * header.count);
+    append(names.data(), sizeof(u32) * header.count);
+    append(games.data(), sizeof(u32) * header.count);
+    append(species.data(), sizeof(s16) * header.count);
+    append(forms.data(), sizeof(s16) * header.count);
+    append(genders.data(), header.count);
+    append(released.data(), header.count);
+    append(types.data(), header.count);
+    append(strings.data(), strings.size());
+    append(matchesData.data(), matchesData.size());
+    return buffer;
+}
@@ -0,0 +1,115 @@
+/*
+ *   This file is part of PKSM
+ *   Copyright (C) 2016-2021 Bernardo Giordano, Admiral Fish, piepie62
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *   Additional Terms 7.b and 7.c of GPLv3 apply to this file:
+ *       * Requiring preservation of specified reasonable legal notices or
+ *         author attributions in that material or in the Appropriate Legal
+ *         Notices displayed by works containing it.
+ *       * Prohibiting misrepresentation of the origin of that material,
+ *         or requiring that modified versions of such material be marked in
+ *         reasonable ways as different from the original version.
+ */
+
+#include "SaveIndex.hpp"
+#include <algorithm>
+#include <dirent.h>
+#include <sys/stat.h>
+
+namespace
+{
+    struct Entry
+    {
+        std::string name;
+        bool folder;
+    };
+
+    std::vector<Entry> listDirectory(const std::string& path)
+    {
+        std::vector<Entry> ret;
+        DIR* dir = opendir(path.c_str());
+        if (!dir)
+        {
+            return ret;
+        }
+        while (dirent* entry = readdir(dir))
+        {
+            std::string name = entry->d_name;
+            if (name == "." || name == "..")
+            {
+                continue;
+            }
+            bool folder = entry->d_type == DT_DIR;
+            if (entry->d_type == DT_UNKNOWN)
+            {
+                struct stat info;
+                folder = stat((path + "/" + name).c_str(), &info) == 0 && S_ISDIR(info.st_mode);
+            }
+            ret.emplace_back(Entry{std::move(name), folder});
+        }
+        closedir(dir);
+        return ret;
+    }
+}
+
+void SaveIndex::scan(const std::string& root, const std::vector<Title>& titles)
+{
+    auto& saves = roots[root];
+    saves.clear();
+
+    std::vector<Entry> folders = listDirectory(root);
+    std::erase_if(folders, [](const Entry& entry) { return !entry.folder; });
+    std::sort(folders.begin(), folders.end(),
+        [](const Entry& a, const Entry& b) { return a.name < b.name; });
+
+    for (const auto& title : titles)
+    {
+        auto& found = saves[title.prefix];
+        // Everything starting with the prefix is together
+        auto folder = std::lower_bound(folders.begin(), folders.end(), title.prefix,
+            [](const Entry& entry, const std::string& prefix) { return entry.name < prefix; });
+        for (; folder != folders.end() && folder->name.starts_with(title.prefix); ++folder)
+        {
+            std::string path = root + "/" + folder->name;
+            for (const auto& backup : listDirectory(path))
+            {
+                if (!backup.folder)
+                {
+                    continue;
+                }
+                // Backups only ever hold a few files, but asking for the one that matters is
+                // still cheaper than listing them
+                std::string save = path + "/" + backup.name + "/" + title.saveName;
+                struct stat info;
+                if (stat(save.c_str(), &info) == 0 && S_ISREG(info.st_mode))
+                {
+                    found.emplace_back(std::move(save));
+                }
+            }
+        }
+    }
+}
+
+std::vector<std::string> SaveIndex::find(const std::string& root, const std::string& prefix) const
+{
+    auto saves = roots.find(root);
+    if (saves == roots.end())
+    {
+        return {};
+    }
+    auto found = saves->second.find(prefix);
+    return found == saves->second.end() ? std::vector<std::string>{} : found->second;
+}
@@ -0,0 +1,101 @@
+/*
+ *   This file is part of PKSM
+ *   Copyright (C) 2016-2021 Bernardo Giordano, Admiral Fish, piepie62
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *   Additional Terms 7.b and 7.c of GPLv3 apply to this file:
+ *       * Requiring preservation of specified reasonable legal notices or
+ *         author attributions in that material or in the Appropriate Legal
+ *         Notices displayed by works containing it.
+ *       * Prohibiting misrepresentation of the origin of that material,
+ *         or requiring that modified versions of such material be marked in
+ *         reasonable ways as different from the original version.
+ */
+
+#include "SlotCache.hpp"
+#include <algorithm>
+
+SlotCache::SlotCache(Loader loader, size_t maxBoxes)
+    : loader(std::move(loader)), maxBoxes(std::max(maxBoxes, (size_t)1))
+{
+    boxes.reserve(this->maxBoxes);
+}
+
+SlotCache::CachedBox& SlotCache::fetch(int box, u32 revision)
+{
+    auto found = std::find_if(
+        boxes.begin(), boxes.end(), [box](const CachedBox& cached) { return cached.box == box; });
+    if (found == boxes.end())
+    {
+        if (boxes.size() < maxBoxes)
+        {
+            found = boxes.emplace(boxes.end());
+        }
+        else
+        {
+            found = std::min_element(boxes.begin(), boxes.end(),
+                [](const CachedBox& a, const CachedBox& b) { return a.lastUse < b.lastUse; });
+        }
+        found->box      = box;
+        found->revision = revision + 1;
+    }
+
+    if (found->revision != revision)
+    {
+        // Slots are decoded lazily; some (such as those past LGPE's max slot) are never needed
+        for (auto& pkm : found->pkm)
+        {
+            pkm = nullptr;
+        }
+        found->filterChecked.reset();
+        found->revision = revision;
+    }
+
+    found->lastUse = ++useCounter;
+    return *found;
+}
+
+const pksm::PKX& SlotCache::pkm(int box, int slot, u32 revision)
+{
+    CachedBox& cached = fetch(box, revision);
+    if (!cached.pkm[slot])
+    {
+        cached.pkm[slot] = loader(box, slot);
+    }
+    return *cached.pkm[slot];
+}
+
+bool SlotCache::matchesFilter(
+    int box, int slot, u32 revision, const pksm::PKFilter& filter, u32 filterRevision)
+{
+    const pksm::PKX& pokemon = pkm(box, slot, revision);
+    CachedBox& cached        = fetch(box, revision);
+    if (cached.filterRevision != filterRevision)
+    {
+        cached.filterChecked.reset();
+        cached.filterRevision = filterRevision;
+    }
+    if (!cached.filterChecked[slot])
+    {
+        cached.filterMatch[slot]   = pokemon == filter;
+        cached.filterChecked[slot] = true;
+    }
+    return cached.filterMatch[slot];
+}
+
+void SlotCache::clear()
+{
+    boxes.clear();
+}
@@ -0,0 +1,86 @@
+/*
+ *   This file is part of PKSM
+ *   Copyright (C) 2016-2021 Bernardo Giordano, Admiral Fish, piepie62
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *   Additional Terms 7.b and 7.c of GPLv3 apply to this file:
+ *       * Requiring preservation of specified reasonable legal notices or
+ *         author attributions in that material or in the Appropriate Legal
+ *         Notices displayed by works containing it.
+ *       * Prohibiting misrepresentation of the origin of that material,
+ *         or requiring that modified versions of such material be marked in
+ *         reasonable ways as different from the original version.
+ */
+
+#include "Swizzle.hpp"
+#include <algorithm>
+
+void Swizzle::blit(const u16* src, u32 width, u32 height, u16* dst, u32 dstWidth, u32 x, u32 y)
+{
+    for (u32 tileY = 0; tileY < height; tileY += 8)
+    {
+        for (u32 tileX = 0; tileX < width; tileX += 8)
+        {
+            const u16* tile = src + offset(tileX, tileY, width);
+            std::copy(tile, tile + 64, dst + offset(x + tileX, y + tileY, dstWidth));
+        }
+    }
+}
+
+void Swizzle::fromLinear(const u16* src, u32 width, u32 height, u16* dst, u32 dstWidth)
+{
+    // One 8x8 tile at a time, so that the writes stay within the tile and the reads within eight
+    // neighbouring rows of the source
+    for (u32 tileY = 0; tileY < height; tileY += 8)
+    {
+        for (u32 tileX = 0; tileX < width; tileX += 8)
+        {
+            u16* tile = dst + offset(tileX, tileY, dstWidth);
+            for (u32 y = 0; y < 8; y++)
+            {
+                const u16* row = src + (tileY + y) * width + tileX;
+                for (u32 x = 0; x < 8; x++)
+                {
+                    tile[offset(x, y, 8)] = row[x];
+                }
+            }
+        }
+    }
+}
+
+void Swizzle::dsIcon(const u8* data, const u16* palette, u16* out)
+{
+    for (u32 x = 0; x < 32; x++)
+    {
+        for (u32 y = 0; y < 32; y++)
+        {
+            u32 srcOff   = (((y >> 3) * 4 + (x >> 3)) * 8 + (y & 7)) * 4 + ((x & 7) >> 1);
+            u32 srcShift = (x & 1) * 4;
+
+            u16 pIndex = (data[srcOff] >> srcShift) & 0xF;
+            u16 color  = 0xFFFF;
+            if (pIndex != 0)
+            {
+                u16 r = palette[pIndex] & 0x1F;
+                u16 g = (palette[pIndex] >> 5) & 0x1F;
+                u16 b = (palette[pIndex] >> 10) & 0x1F;
+                // Green gets 6 bits, so its top bit is repeated into the bottom one
+                color = (r << 11) | (g << 6) | ((g >> 4) << 5) | (b);
+            }
+
+            out[offset(x, y, 32)] = color;
+        }
+    }
+}
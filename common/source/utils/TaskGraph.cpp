@@ -0,0 +1,186 @@
+/*
+ *   This file is part of PKSM
+ *   Copyright (C) 2016-2021 Bernardo Giordano, Admiral Fish, piepie62
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *   Additional Terms 7.b and 7.c of GPLv3 apply to this file:
+ *       * Requiring preservation of specified reasonable legal notices or
+ *         author attributions in that material or in the Appropriate Legal
+ *         Notices displayed by works containing it.
+ *       * Prohibiting misrepresentation of the origin of that material,
+ *         or requiring that modified versions of such material be marked in
+ *         reasonable ways as different from the original version.
+ */
+
+#include "TaskGraph.hpp"
+#include "format.h"
+#include "thread.hpp"
+#include <algorithm>
+
+size_t TaskGraph::add(
+    const std::string& name, Stage stage, bool onWorker, std::vector<size_t> dependencies)
+{
+    nodes.push_back({name, std::move(stage), onWorker, std::move(dependencies)});
+    return nodes.size() - 1;
+}
+
+bool TaskGraph::ready(const Node& node) const
+{
+    return std::all_of(node.dependencies.begin(), node.dependencies.end(),
+        [this](size_t dependency) { return nodes[dependency].done; });
+}
+
+Result TaskGraph::runStage(size_t index)
+{
+    using ms = std::chrono::duration<double, std::milli>;
+
+    Node& node = nodes[index];
+    node.start = ms(std::chrono::steady_clock::now() - begin).count();
+    Result res = node.stage();
+    node.end   = ms(std::chrono::steady_clock::now() - begin).count();
+    return res;
+}
+
+void TaskGraph::complete(size_t index, Result result)
+{
+    nodes[index].done   = true;
+    nodes[index].result = result;
+    if (R_FAILED(result) && failed == SIZE_MAX)
+    {
+        failed  = index;
+        stopped = true;
+    }
+}
+
+Result TaskGraph::run(void)
+{
+    begin = std::chrono::steady_clock::now();
+    std::unique_lock<std::mutex> guard(lock);
+    while (true)
+    {
+        bool startedAny = false;
+        // Everything that can go to a worker is started first so that it overlaps with the next
+        // main thread stage
+        for (size_t i = 0; i < nodes.size() && !stopped; i++)
+        {
+            if (nodes[i].onWorker && !nodes[i].started && ready(nodes[i]))
+            {
+                nodes[i].started = true;
+                startedAny       = true;
+                running++;
+                Threads::executeTask(
+                    [this, i]
+                    {
+                        Result res = runStage(i);
+                        {
+                            std::lock_guard<std::mutex> guard(lock);
+                            complete(i, res);
+                            running--;
+                        }
+                        finished.notify_one();
+                    },
+                    Threads::Priority::HIGH);
+            }
+        }
+        for (size_t i = 0; i < nodes.size() && !stopped; i++)
+        {
+            if (!nodes[i].onWorker && !nodes[i].started && ready(nodes[i]))
+            {
+                nodes[i].started = true;
+                startedAny       = true;
+                guard.unlock();
+                Result res = runStage(i);
+                guard.lock();
+                complete(i, res);
+                break;
+            }
+        }
+
+        if (!startedAny)
+        {
+            if (running == 0)
+            {
+                break;
+            }
+            finished.wait(guard);
+        }
+    }
+
+    return failed == SIZE_MAX ? 0 : nodes[failed].result;
+}
+
+void TaskGraph::cancel(void)
+{
+    std::lock_guard<std::mutex> guard(lock);
+    stopped = true;
+}
+
+std::string TaskGraph::failedStage(void) const
+{
+    return failed == SIZE_MAX ? "" : nodes[failed].name;
+}
+
+std::string TaskGraph::report(void) const
+{
+    std::string ret;
+    double total = 0;
+    for (const auto& node : nodes)
+    {
+        if (node.done)
+        {
+            ret += fmt::format(FMT_STRING("{:<12s} {:>9.1f} {:>9.1f} {:>9.1f} ms  {:s}\n"),
+                node.name, node.start, node.end, node.end - node.start,
+                node.onWorker ? "worker" : "main");
+            total = std::max(total, node.end);
+        }
+        else
+        {
+            ret += fmt::format(FMT_STRING("{:<12s} skipped\n"), node.name);
+        }
+    }
+    ret += fmt::format(FMT_STRING("Total: {:.1f} ms\n"), total);
+
+    // Walk back from whatever finished last through whichever dependency held it up the longest
+    std::vector<size_t> path;
+    size_t current = SIZE_MAX;
+    for (size_t i = 0; i < nodes.size(); i++)
+    {
+        if (nodes[i].done && (current == SIZE_MAX || nodes[i].end > nodes[current].end))
+        {
+            current = i;
+        }
+    }
+    while (current != SIZE_MAX)
+    {
+        path.emplace_back(current);
+        size_t next = SIZE_MAX;
+        for (size_t dependency : nodes[current].dependencies)
+        {
+            if (next == SIZE_MAX || nodes[dependency].end > nodes[next].end)
+            {
+                next = dependency;
+            }
+        }
+        current = next;
+    }
+
+    ret += "Critical path:";
+    for (auto i = path.rbegin(); i != path.rend(); ++i)
+    {
+        ret += (i == path.rbegin() ? " " : " -> ") + nodes[*i].name;
+    }
+    ret += '\n';
+    return ret;
+}
@@ -26,35 +26,147 @@
 
 #include "fetch.hpp"
 #include "thread.hpp"
+#include <algorithm>
+#include <condition_variable>
 #include <errno.h>
+#include <mutex>
 #include <stdarg.h>
 #include <stdio.h>
-#include <time.h>
 #include <unistd.h>
+#include <unordered_map>
 
 namespace
 {
     struct MultiFetchRecord
     {
         MultiFetchRecord(std::shared_ptr<Fetch> fetch                      = nullptr,
+            CURL* handle                                                    = nullptr,
             std::function<void(CURLcode, std::shared_ptr<Fetch>)> onFinish = nullptr,
             std::function<void(std::shared_ptr<Fetch>)> onCancel           = nullptr)
-            : fetch(fetch), onFinish(onFinish), onCancel(onCancel)
+            : fetch(fetch), handle(handle), onFinish(onFinish), onCancel(onCancel)
         {
         }
         std::shared_ptr<Fetch> fetch;
+        CURL* handle;
         std::function<void(CURLcode, std::shared_ptr<Fetch>)> onFinish;
         std::function<void(std::shared_ptr<Fetch>)> onCancel;
     };
 
     constexpr int MAX_FILE_BUFFER_SIZE = 0x10000;
+    // Upper bound on how long the multi thread sleeps when curl has nothing scheduled. If the
+    // multi handle can't be woken up (no socketpair support), this is also the worst-case latency
+    // for picking up a new transfer, so it's much shorter in that case
+    constexpr int IDLE_POLL_MS     = 1000;
+    constexpr int FALLBACK_POLL_MS = 10;
 
     std::atomic<bool> multiThreadInfo = false;
-    std::vector<MultiFetchRecord> fetches;
-    _LOCK_T fetchesMutex;
-    CURLM* multiHandle = nullptr;
-    _LOCK_T multiHandleMutex;
-    bool multiInitialized = false;
+    // Transfers currently attached to multiHandle. Only touched by the multi thread once it's
+    // running
+    std::unordered_map<CURL*, MultiFetchRecord> fetches;
+    CURLM* multiHandle                 = nullptr;
+    std::atomic<bool> multiInitialized = false;
+    bool multiWakeup                   = false;
+    thread_local bool onMultiThread    = false;
+
+    // Requests from other threads, applied by the multi thread the next time it wakes up. curl
+    // multi handles may not be touched from two threads at once, so nothing else adds or removes
+    // handles directly
+    std::vector<MultiFetchRecord> pendingAdds;
+    std::vector<CURL*> pendingCancels;
+    std::mutex pendingMutex;
+    std::condition_variable pendingDone;
+    bool multiThreadDone = false;
+
+    // Connections, DNS lookups, and TLS sessions are shared between every handle, so paging through
+    // the cloud doesn't pay for a fresh TCP and TLS handshake on each request
+    CURLSH* shareHandle = nullptr;
+    std::mutex shareMutexes[CURL_LOCK_DATA_LAST];
+
+    void shareLock(CURL*, curl_lock_data data, curl_lock_access, void*)
+    {
+        shareMutexes[data].lock();
+    }
+
+    void shareUnlock(CURL*, curl_lock_data data, void*)
+    {
+        shareMutexes[data].unlock();
+    }
+
+    void wakeMultiThread()
+    {
+        if (multiWakeup)
+        {
+            curl_multi_wakeup(multiHandle);
+        }
+    }
+
+    void finishTransfer(CURL* handle, CURLcode result)
+    {
+        auto it = fetches.find(handle);
+        if (it != fetches.end())
+        {
+            MultiFetchRecord record = std::move(it->second);
+            fetches.erase(it);
+            curl_multi_remove_handle(multiHandle, handle);
+            if (record.onFinish)
+            {
+                record.onFinish(result, record.fetch);
+            }
+        }
+    }
+
+    void cancelTransfer(CURL* handle)
+    {
+        auto it = fetches.find(handle);
+        if (it != fetches.end())
+        {
+            MultiFetchRecord record = std::move(it->second);
+            fetches.erase(it);
+            curl_multi_remove_handle(multiHandle, handle);
+            if (record.onCancel)
+            {
+                record.onCancel(record.fetch);
+            }
+        }
+    }
+
+    void applyPending()
+    {
+        std::vector<MultiFetchRecord> adds;
+        std::vector<CURL*> cancels;
+        {
+            std::lock_guard<std::mutex> lock(pendingMutex);
+            adds.swap(pendingAdds);
+            cancels = pendingCancels;
+        }
+
+        for (auto& record : adds)
+        {
+            if (curl_multi_add_handle(multiHandle, record.handle) == CURLM_OK)
+            {
+                fetches.emplace(record.handle, std::move(record));
+            }
+            else if (record.onFinish)
+            {
+                record.onFinish(CURLE_FAILED_INIT, record.fetch);
+            }
+        }
+
+        if (!cancels.empty())
+        {
+            for (CURL* handle : cancels)
+            {
+                cancelTransfer(handle);
+            }
+            // Cancellations are only ever appended, so the ones just handled are still at the front
+            {
+                std::lock_guard<std::mutex> lock(pendingMutex);
+                pendingCancels.erase(
+                    pendingCancels.begin(), pendingCancels.begin() + cancels.size());
+            }
+            pendingDone.notify_all();
+        }
+    }
 
     size_t string_write_callback(char* ptr, size_t size, size_t nmemb, void* userdata)
     {
@@ -93,6 +205,14 @@ std::shared_ptr<Fetch> Fetch::init(const std::string& url, bool ssl, std::string
         fetch->setopt(CURLOPT_FOLLOWLOCATION, 1L);
         fetch->setopt(CURLOPT_LOW_SPEED_LIMIT, 300L);
         fetch->setopt(CURLOPT_LOW_SPEED_TIME, 10L);
+        fetch->setopt(CURLOPT_TCP_KEEPALIVE, 1L);
+        // Only takes effect if libcurl was built with HTTP/2 support; falls back to 1.1 otherwise
+        fetch->setopt(CURLOPT_HTTP_VERSION, (long)CURL_HTTP_VERSION_2TLS);
+        fetch->setopt(CURLOPT_PIPEWAIT, 1L);
+        if (shareHandle)
+        {
+            fetch->setopt(CURLOPT_SHARE, shareHandle);
+        }
     }
     else
     {
@@ -158,64 +278,52 @@ std::unique_ptr<curl_mime, decltype(curl_mime_free)*> Fetch::mimeInit()
 
 void Fetch::multiMainThread(void*)
 {
-    int trash;
+    onMultiThread = true;
+    int running   = 0;
     while (multiThreadInfo)
     {
-        CURLMcode mc;
+        applyPending();
 
-        __lock_acquire(multiHandleMutex);
-        mc = curl_multi_perform(multiHandle, &trash);
-        __lock_release(multiHandleMutex);
-        if (mc == CURLM_OK)
+        if (curl_multi_perform(multiHandle, &running) == CURLM_OK)
         {
-            int numFDs;
-            __lock_acquire(multiHandleMutex);
-            mc = curl_multi_wait(multiHandle, nullptr, 0, 1, &numFDs);
-            __lock_release(multiHandleMutex);
-            if (numFDs == 0)
+            int msgsLeft;
+            while (CURLMsg* msg = curl_multi_info_read(multiHandle, &msgsLeft))
             {
-                constexpr timespec sleepTime = {0, 1000000};
-                nanosleep(&sleepTime, nullptr);
-            }
-        }
-
-        __lock_acquire(multiHandleMutex);
-        auto msg = curl_multi_info_read(multiHandle, &trash);
-        while (msg != nullptr)
-        {
-            // Find the done handle
-            __lock_acquire(fetchesMutex);
-            auto it = std::find_if(fetches.begin(), fetches.end(),
-                [&msg](const MultiFetchRecord& record)
-                { return record.fetch->curl.get() == msg->easy_handle; });
-            // And delete it
-            if (it != fetches.end())
-            {
-                if (it->onFinish)
+                if (msg->msg == CURLMSG_DONE)
                 {
-                    it->onFinish(msg->data.result, it->fetch);
+                    finishTransfer(msg->easy_handle, msg->data.result);
                 }
-                curl_multi_remove_handle(multiHandle, it->fetch->curl.get());
-                fetches.erase(it);
             }
-            __lock_release(fetchesMutex);
-
-            msg = curl_multi_info_read(multiHandle, &trash);
         }
-        __lock_release(multiHandleMutex);
 
-        // Terrible things have happened, but I don't know what to do
+        // Sleeps until a socket is ready, curl's own timeout expires, or another thread wakes it
+        curl_multi_poll(
+            multiHandle, nullptr, 0, multiWakeup ? IDLE_POLL_MS : FALLBACK_POLL_MS, nullptr);
     }
 
-    multiThreadInfo = true;
+    {
+        std::lock_guard<std::mutex> lock(pendingMutex);
+        multiThreadDone = true;
+    }
+    pendingDone.notify_all();
 }
 
 Result Fetch::initMulti()
 {
-    __lock_init(fetchesMutex);
-    __lock_init(multiHandleMutex);
-    multiHandle     = curl_multi_init();
+    multiHandle = curl_multi_init();
+    curl_multi_setopt(multiHandle, CURLMOPT_PIPELINING, CURLPIPE_MULTIPLEX);
+    if ((shareHandle = curl_share_init()))
+    {
+        curl_share_setopt(shareHandle, CURLSHOPT_LOCKFUNC, shareLock);
+        curl_share_setopt(shareHandle, CURLSHOPT_UNLOCKFUNC, shareUnlock);
+        curl_share_setopt(shareHandle, CURLSHOPT_SHARE, CURL_LOCK_DATA_CONNECT);
+        curl_share_setopt(shareHandle, CURLSHOPT_SHARE, CURL_LOCK_DATA_DNS);
+        curl_share_setopt(shareHandle, CURLSHOPT_SHARE, CURL_LOCK_DATA_SSL_SESSION);
+    }
+    multiThreadDone = false;
     multiThreadInfo = true;
+    // Leaves one wakeup pending, which only makes the first poll return immediately
+    multiWakeup = curl_multi_wakeup(multiHandle) == CURLM_OK;
     if (!Threads::create(Fetch::multiMainThread, nullptr, 8 * 1024))
     {
         multiInitialized = false;
@@ -230,24 +338,37 @@ void Fetch::exitMulti()
     multiThreadInfo = false; // Stop multi thread
     if (multiInitialized)
     {
-        while (!multiThreadInfo) // Wait for it to be done
+        wakeMultiThread();
+        std::vector<MultiFetchRecord> adds;
         {
-            constexpr timespec sleepTime = {0, 100000};
-            nanosleep(&sleepTime, nullptr);
+            std::unique_lock<std::mutex> lock(pendingMutex);
+            pendingDone.wait(lock, [] { return multiThreadDone; }); // Wait for it to be done
+            adds.swap(pendingAdds);
+            pendingCancels.clear();
         }
-        // And finally clean up
-        __lock_acquire(fetchesMutex);
-        __lock_acquire(multiHandleMutex);
-        for (const auto& i : fetches)
+        pendingDone.notify_all();
+
+        // And finally clean up, letting anyone still waiting on a transfer know it won't finish
+        while (!fetches.empty())
         {
-            curl_multi_remove_handle(multiHandle, i.fetch->curl.get());
+            cancelTransfer(fetches.begin()->first);
+        }
+        for (const auto& record : adds)
+        {
+            if (record.onCancel)
+            {
+                record.onCancel(record.fetch);
+            }
         }
-        fetches.clear();
-        __lock_release(fetchesMutex);
-        __lock_close(fetchesMutex);
         curl_multi_cleanup(multiHandle);
-        __lock_release(multiHandleMutex);
-        __lock_close(multiHandleMutex);
+        multiHandle = nullptr;
+        // Fails if some Fetch is still alive and attached to it, in which case it's left to die
+        // with the process instead of pulling the cache out from under that handle
+        if (shareHandle && curl_share_cleanup(shareHandle) == CURLSHE_OK)
+        {
+            shareHandle = nullptr;
+        }
+        multiInitialized = false;
     }
 }
 
@@ -257,16 +378,19 @@ CURLMcode Fetch::performAsync(std::shared_ptr<Fetch> fetch,
 {
     if (multiInitialized)
     {
-        __lock_acquire(multiHandleMutex);
-        CURLMcode res = curl_multi_add_handle(multiHandle, fetch->curl.get());
-        __lock_release(multiHandleMutex);
-        if (res == CURLM_OK)
         {
-            __lock_acquire(fetchesMutex);
-            fetches.emplace_back(fetch, std::move(onComplete), std::move(onCancel));
-            __lock_release(fetchesMutex);
+            std::lock_guard<std::mutex> lock(pendingMutex);
+            // exitMulti has already taken (or is about to take) the last of pendingAdds, so
+            // nothing would ever pick this one up
+            if (multiThreadDone)
+            {
+                return CURLM_LAST;
+            }
+            pendingAdds.emplace_back(
+                fetch, fetch->curl.get(), std::move(onComplete), std::move(onCancel));
         }
-        return res;
+        wakeMultiThread();
+        return CURLM_OK;
     }
     else
     {
@@ -278,23 +402,40 @@ void Fetch::cancelAsync(std::shared_ptr<Fetch> fetch)
 {
     if (multiInitialized)
     {
-        __lock_acquire(multiHandleMutex);
-        CURLMcode res = curl_multi_remove_handle(multiHandle, fetch->curl.get());
-        __lock_release(multiHandleMutex);
-        __lock_acquire(fetchesMutex);
-        for (auto i = fetches.begin(); i != fetches.end(); ++i)
+        CURL* handle = fetch->curl.get();
+        std::unique_lock<std::mutex> lock(pendingMutex);
+
+        // Not handed to curl yet, so it can be dropped right here
+        auto pending = std::find_if(pendingAdds.begin(), pendingAdds.end(),
+            [&fetch](const MultiFetchRecord& record) { return record.fetch == fetch; });
+        if (pending != pendingAdds.end())
         {
-            if (i->fetch == fetch)
+            MultiFetchRecord record = std::move(*pending);
+            pendingAdds.erase(pending);
+            lock.unlock();
+            if (record.onCancel)
             {
-                if (i->onCancel)
-                {
-                    i->onCancel(i->fetch);
-                }
-                fetches.erase(i);
-                break;
+                record.onCancel(record.fetch);
             }
         }
-        __lock_release(fetchesMutex);
+        else if (onMultiThread)
+        {
+            lock.unlock();
+            cancelTransfer(handle);
+        }
+        else if (!multiThreadDone)
+        {
+            // Callers expect onCancel to have run by the time this returns
+            pendingCancels.emplace_back(handle);
+            wakeMultiThread();
+            pendingDone.wait(lock,
+                [handle]
+                {
+                    return multiThreadDone ||
+                           std::find(pendingCancels.begin(), pendingCancels.end(), handle) ==
+                               pendingCancels.end();
+                });
+        }
     }
 }
 
@@ -302,25 +443,30 @@ std::variant<CURLMcode, CURLcode> Fetch::perform(std::shared_ptr<Fetch> fetch)
 {
     if (multiInitialized)
     {
-        CURLcode cres;
-        std::atomic_flag wait;
-        wait.test_and_set();
-        CURLMcode mRes = performAsync(fetch,
-            [&cres, &wait](CURLcode code, std::shared_ptr<Fetch>)
+        CURLcode cres = CURLE_OK;
+        bool done     = false;
+        std::mutex doneMutex;
+        std::condition_variable doneCondition;
+        auto finish = [&](CURLcode code)
+        {
             {
+                std::lock_guard<std::mutex> lock(doneMutex);
                 cres = code;
-                wait.clear();
-            });
+                done = true;
+            }
+            doneCondition.notify_one();
+        };
+
+        CURLMcode mRes = performAsync(
+            fetch, [&finish](CURLcode code, std::shared_ptr<Fetch>) { finish(code); },
+            [&finish](std::shared_ptr<Fetch>) { finish(CURLE_ABORTED_BY_CALLBACK); });
         if (mRes != CURLM_OK)
         {
             return mRes;
         }
 
-        while (wait.test_and_set())
-        {
-            constexpr timespec sleepTime = {0, 100000};
-            nanosleep(&sleepTime, nullptr);
-        }
+        std::unique_lock<std::mutex> lock(doneMutex);
+        doneCondition.wait(lock, [&done] { return done; });
 
         return cres;
     }
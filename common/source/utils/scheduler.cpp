@@ -0,0 +1,184 @@
+/*
+ *   This file is part of PKSM
+ *   Copyright (C) 2016-2021 Bernardo Giordano, Admiral Fish, piepie62
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *   Additional Terms 7.b and 7.c of GPLv3 apply to this file:
+ *       * Requiring preservation of specified reasonable legal notices or
+ *         author attributions in that material or in the Appropriate Legal
+ *         Notices displayed by works containing it.
+ *       * Prohibiting misrepresentation of the origin of that material,
+ *         or requiring that modified versions of such material be marked in
+ *         reasonable ways as different from the original version.
+ */
+
+#include "thread.hpp"
+#include <array>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+
+namespace
+{
+    constexpr size_t PRIORITIES = 3;
+
+    // Every worker owns a deque per priority. It takes work from the front of its own, and when
+    // those run dry it steals from the back of everyone else's, so a worker stuck on a long task
+    // doesn't hold up what was queued behind it
+    struct Worker
+    {
+        std::mutex lock;
+        std::array<std::deque<std::function<void()>>, PRIORITIES> lanes;
+    };
+
+    std::vector<std::unique_ptr<Worker>> workers;
+    thread_local int currentWorker = -1;
+    std::atomic<size_t> nextWorker = 0;
+
+    // Queued is only raised with sleepLock held so that no worker can miss the wakeup
+    std::atomic<size_t> queued = 0;
+    std::mutex sleepLock;
+    std::condition_variable wake;
+    bool stopping = false;
+
+    void push(std::function<void()> task, Threads::Priority priority)
+    {
+        // Tasks queued by a worker stay with it; everything else is dealt out round robin
+        size_t index = currentWorker >= 0 ? currentWorker : nextWorker++ % workers.size();
+        {
+            std::lock_guard<std::mutex> lock(sleepLock);
+            queued++;
+        }
+        {
+            std::lock_guard<std::mutex> lock(workers[index]->lock);
+            workers[index]->lanes[size_t(priority)].emplace_back(std::move(task));
+        }
+        wake.notify_one();
+    }
+
+    bool pop(size_t self, std::function<void()>& out)
+    {
+        for (size_t lane = 0; lane < PRIORITIES; lane++)
+        {
+            {
+                Worker& worker = *workers[self];
+                std::lock_guard<std::mutex> lock(worker.lock);
+                if (!worker.lanes[lane].empty())
+                {
+                    out = std::move(worker.lanes[lane].front());
+                    worker.lanes[lane].pop_front();
+                    return true;
+                }
+            }
+            for (size_t i = 1; i < workers.size(); i++)
+            {
+                Worker& victim = *workers[(self + i) % workers.size()];
+                std::lock_guard<std::mutex> lock(victim.lock);
+                if (!victim.lanes[lane].empty())
+                {
+                    out = std::move(victim.lanes[lane].back());
+                    victim.lanes[lane].pop_back();
+                    return true;
+                }
+            }
+        }
+        return false;
+    }
+
+    void workerThread(void* arg)
+    {
+        const size_t self = (size_t)arg;
+        currentWorker     = self;
+        std::function<void()> task;
+        while (true)
+        {
+            if (pop(self, task))
+            {
+                queued--;
+                task();
+                task = nullptr;
+                continue;
+            }
+
+            std::unique_lock<std::mutex> lock(sleepLock);
+            // Queued can be ahead of the deques for a moment while a push is in progress, in which
+            // case this just goes around again
+            wake.wait(lock, [] { return stopping || queued > 0; });
+            if (stopping && queued == 0)
+            {
+                return;
+            }
+        }
+    }
+}
+
+bool Threads::startWorkers(u8 count)
+{
+    stopping = false;
+    workers.clear();
+    for (u8 i = 0; i < count; i++)
+    {
+        workers.emplace_back(std::make_unique<Worker>());
+    }
+
+    const std::vector<int> cores = workerCores();
+    for (size_t i = 0; i < workers.size(); i++)
+    {
+        if (!createOnCore(workerThread, (void*)i, cores[i % cores.size()], 0x8000))
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+void Threads::stopWorkers(void)
+{
+    {
+        std::lock_guard<std::mutex> lock(sleepLock);
+        stopping = true;
+    }
+    wake.notify_all();
+}
+
+void Threads::executeTask(void (*task)(void*), void* arg, Priority priority)
+{
+    executeTask(std::function<void()>([task, arg] { task(arg); }), priority);
+}
+
+std::future<void> Threads::executeTask(std::function<void()> task, Priority priority)
+{
+    auto promise           = std::make_shared<std::promise<void>>();
+    std::future<void> done = promise->get_future();
+    if (workers.empty())
+    {
+        // No workers to hand it to, so at least make sure it happens
+        task();
+        promise->set_value();
+    }
+    else
+    {
+        push(
+            [task = std::move(task), promise]
+            {
+                task();
+                promise->set_value();
+            },
+            priority);
+    }
+    return done;
+}
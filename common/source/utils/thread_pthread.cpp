@@ -0,0 +1,148 @@
+/*
+ *   This file is part of PKSM
+ *   Copyright (C) 2016-2021 Bernardo Giordano, Admiral Fish, piepie62
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *   Additional Terms 7.b and 7.c of GPLv3 apply to this file:
+ *       * Requiring preservation of specified reasonable legal notices or
+ *         author attributions in that material or in the Appropriate Legal
+ *         Notices displayed by works containing it.
+ *       * Prohibiting misrepresentation of the origin of that material,
+ *         or requiring that modified versions of such material be marked in
+ *         reasonable ways as different from the original version.
+ */
+
+// pthread backend for Threads, for anything that isn't the 3DS. The 3DS one lives with the rest of
+// the 3DS code in 3ds/source/utils/thread.cpp
+#ifndef _3DS
+
+#include "thread.hpp"
+#include <algorithm>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <pthread.h>
+#include <thread>
+
+namespace
+{
+    struct ThreadStart
+    {
+        void (*entrypoint)(void*);
+        void* arg;
+    };
+
+    // Threads are detached, so these are how exit knows when they've all finished
+    std::mutex runningLock;
+    std::condition_variable runningDone;
+    int runningThreads = 0;
+
+    void* runThread(void* arg)
+    {
+        std::unique_ptr<ThreadStart> start((ThreadStart*)arg);
+        start->entrypoint(start->arg);
+        // Notified with the lock held, since exit may return and take runningDone with it as soon
+        // as the lock is let go
+        std::lock_guard<std::mutex> lock(runningLock);
+        runningThreads--;
+        runningDone.notify_all();
+        return nullptr;
+    }
+
+    bool startThread(ThreadStart* start, int core, std::optional<size_t> stackSize)
+    {
+        pthread_attr_t attr;
+        if (pthread_attr_init(&attr) != 0)
+        {
+            return false;
+        }
+        pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
+        if (stackSize)
+        {
+            // Fails if it's below the system's minimum, in which case the default is fine
+            pthread_attr_setstacksize(&attr, *stackSize);
+        }
+#ifdef __linux__
+        if (core >= 0)
+        {
+            cpu_set_t cpus;
+            CPU_ZERO(&cpus);
+            CPU_SET(core, &cpus);
+            pthread_attr_setaffinity_np(&attr, sizeof(cpu_set_t), &cpus);
+        }
+#else
+        (void)core;
+#endif
+        pthread_t thread;
+        bool ret = pthread_create(&thread, &attr, runThread, start) == 0;
+        pthread_attr_destroy(&attr);
+        return ret;
+    }
+}
+
+bool Threads::init(u8 workers)
+{
+    return startWorkers(workers);
+}
+
+bool Threads::create(void (*entrypoint)(void*), void* arg, std::optional<size_t> stackSize)
+{
+    return createOnCore(entrypoint, arg, -1, stackSize);
+}
+
+bool Threads::createOnCore(
+    void (*entrypoint)(void*), void* arg, int core, std::optional<size_t> stackSize)
+{
+    {
+        std::lock_guard<std::mutex> lock(runningLock);
+        if (runningThreads >= Threads::MAX_THREADS)
+        {
+            return false;
+        }
+        runningThreads++;
+    }
+
+    ThreadStart* start = new ThreadStart{entrypoint, arg};
+    if (startThread(start, core, stackSize) || (core >= 0 && startThread(start, -1, stackSize)))
+    {
+        return true;
+    }
+
+    delete start;
+    std::lock_guard<std::mutex> lock(runningLock);
+    runningThreads--;
+    runningDone.notify_all();
+    return false;
+}
+
+std::vector<int> Threads::workerCores(void)
+{
+    std::vector<int> ret;
+    for (unsigned core = 0; core < std::max(1u, std::thread::hardware_concurrency()); core++)
+    {
+        ret.emplace_back(core);
+    }
+    return ret;
+}
+
+void Threads::exit(void)
+{
+    stopWorkers();
+    // Like the 3DS backend, this waits for every thread, not just the workers
+    std::unique_lock<std::mutex> lock(runningLock);
+    runningDone.wait(lock, [] { return runningThreads == 0; });
+}
+
+#endif
@@ -0,0 +1,196 @@
+/*
+ *   This file is part of PKSM
+ *   Copyright (C) 2016-2021 Bernardo Giordano, Admiral Fish, piepie62
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *   Additional Terms 7.b and 7.c of GPLv3 apply to this file:
+ *       * Requiring preservation of specified reasonable legal notices or
+ *         author attributions in that material or in the Appropriate Legal
+ *         Notices displayed by works containing it.
+ *       * Prohibiting misrepresentation of the origin of that material,
+ *         or requiring that modified versions of such material be marked in
+ *         reasonable ways as different from the original version.
+ */
+
+#include "nlohmann/json.hpp"
+#include "test.hpp"
+#include "utils/crypto.hpp"
+#include <algorithm>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Bank itself needs libctru, so this repeats just the parts of it that decide whether there are
+// unsaved changes: the old check, which hashed the whole bank and its box names every time, and
+// the current one, which only rehashes the boxes written since the last save
+namespace
+{
+    constexpr int BOXES         = 500;
+    constexpr size_t ENTRY_SIZE = 0x150;
+    constexpr size_t BOX_SIZE   = ENTRY_SIZE * 30;
+    using Hash                  = std::array<u8, 32>;
+
+    struct BankModel
+    {
+        std::vector<u8> entries = std::vector<u8>(BOXES * BOX_SIZE, 0xFF);
+        nlohmann::json boxNames = nlohmann::json::array();
+
+        // Old
+        Hash prevHash, prevNameHash;
+        bool needsCheck = false;
+
+        // Current
+        std::unordered_map<int, Hash> dirtyBoxes;
+        std::unordered_map<int, std::string> dirtyNames;
+
+        BankModel()
+        {
+            for (int i = 0; i < BOXES; i++)
+            {
+                boxNames[i] = "Storage " + std::to_string(i + 1);
+            }
+            saved();
+        }
+
+        Hash boxHash(int box) const
+        {
+            return pksm::crypto::sha256(entries.data() + box * BOX_SIZE, BOX_SIZE);
+        }
+
+        void saved()
+        {
+            prevHash             = pksm::crypto::sha256(entries.data(), entries.size());
+            std::string jsonData = boxNames.dump(2);
+            prevNameHash = pksm::crypto::sha256((const u8*)jsonData.data(), jsonData.size());
+            needsCheck   = false;
+            dirtyBoxes.clear();
+            dirtyNames.clear();
+        }
+
+        void write(int box, int slot, u8 value)
+        {
+            needsCheck = true;
+            if (!dirtyBoxes.count(box))
+            {
+                dirtyBoxes.emplace(box, boxHash(box));
+            }
+            std::fill_n(entries.data() + box * BOX_SIZE + slot * ENTRY_SIZE, ENTRY_SIZE, value);
+        }
+
+        void rename(int box, const std::string& name)
+        {
+            needsCheck = true;
+            if (!dirtyNames.count(box))
+            {
+                dirtyNames.emplace(box, boxNames[box].get<std::string>());
+            }
+            boxNames[box] = name;
+        }
+
+        bool oldHasChanged()
+        {
+            if (!needsCheck)
+            {
+                return false;
+            }
+            if (pksm::crypto::sha256(entries.data(), entries.size()) != prevHash)
+            {
+                return true;
+            }
+            std::string jsonData = boxNames.dump(2);
+            if (pksm::crypto::sha256((const u8*)jsonData.data(), jsonData.size()) != prevNameHash)
+            {
+                return true;
+            }
+            needsCheck = false;
+            return false;
+        }
+
+        bool newHasChanged()
+        {
+            for (auto i = dirtyBoxes.begin(); i != dirtyBoxes.end();)
+            {
+                if (boxHash(i->first) != i->second)
+                {
+                    return true;
+                }
+                i = dirtyBoxes.erase(i);
+            }
+            for (auto i = dirtyNames.begin(); i != dirtyNames.end();)
+            {
+                if (boxNames[i->first].get<std::string>() != i->second)
+                {
+                    return true;
+                }
+                i = dirtyNames.erase(i);
+            }
+            return false;
+        }
+
+        bool bothHaveChanged()
+        {
+            bool oldResult = oldHasChanged();
+            CHECK(oldResult == newHasChanged());
+            return oldResult;
+        }
+    };
+}
+
+int main()
+{
+    BankModel bank;
+    std::printf("%d boxes, %zu bytes\n", BOXES, bank.entries.size());
+
+    // Both have to agree before the timings mean anything
+    CHECK(!bank.bothHaveChanged());
+    bank.write(3, 7, 0x12);
+    CHECK(bank.bothHaveChanged());
+    bank.write(3, 7, 0xFF);
+    CHECK(!bank.bothHaveChanged());
+    bank.rename(10, "Shinies");
+    CHECK(bank.bothHaveChanged());
+    bank.rename(10, "Storage 11");
+    CHECK(!bank.bothHaveChanged());
+
+    // The worst case for both, and what the storage screen hits on every exit: something was
+    // written, but it's still the same as what's saved, so every check has to go all the way
+    // through. The writes are redone each run since the current check forgets clean boxes
+    auto touch = [&bank]
+    {
+        bank.write(3, 7, 0xFF);
+        bank.write(200, 0, 0xFF);
+        bank.rename(10, "Storage 11");
+    };
+    Test::time("whole bank hashed (old)", 50,
+        [&]
+        {
+            touch();
+            bank.oldHasChanged();
+        });
+    Test::time("dirty boxes hashed (current)", 50,
+        [&]
+        {
+            touch();
+            bank.newHasChanged();
+        });
+
+    // And the common case of an actual change, where the old check stopped after the entries
+    bank.saved();
+    bank.write(3, 7, 0x34);
+    Test::time("changed, whole bank hashed (old)", 50, [&] { bank.oldHasChanged(); });
+    Test::time("changed, dirty boxes hashed (current)", 50, [&] { bank.newHasChanged(); });
+
+    return Test::result();
+}
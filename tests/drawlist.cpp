@@ -0,0 +1,263 @@
+/*
+ *   This file is part of PKSM
+ *   Copyright (C) 2016-2021 Bernardo Giordano, Admiral Fish, piepie62
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *   Additional Terms 7.b and 7.c of GPLv3 apply to this file:
+ *       * Requiring preservation of specified reasonable legal notices or
+ *         author attributions in that material or in the Appropriate Legal
+ *         Notices displayed by works containing it.
+ *       * Prohibiting misrepresentation of the origin of that material,
+ *         or requiring that modified versions of such material be marked in
+ *         reasonable ways as different from the original version.
+ */
+
+#include "DrawList.hpp"
+#include "test.hpp"
+#include <algorithm>
+#include <random>
+#include <vector>
+
+namespace
+{
+    struct Draw
+    {
+        const void* texture;
+        float left, top, right, bottom;
+        bool overlaps(const Draw& other) const
+        {
+            return std::min(left, right) < std::max(other.left, other.right) &&
+                   std::min(other.left, other.right) < std::max(left, right) &&
+                   std::min(top, bottom) < std::max(other.top, other.bottom) &&
+                   std::min(other.top, other.bottom) < std::max(top, bottom);
+        }
+    };
+
+    // Textures are only ever compared, so any distinct addresses will do
+    const char textures[4] = {};
+    const void* const A    = &textures[0];
+    const void* const B    = &textures[1];
+    const void* const C    = &textures[2];
+
+    std::vector<u32> record(DrawList& list, const std::vector<Draw>& draws)
+    {
+        for (const auto& draw : draws)
+        {
+            list.add(draw.texture, draw.left, draw.top, draw.right, draw.bottom);
+        }
+        std::vector<u32> order;
+        for (const auto& batch : list.batches())
+        {
+            order.insert(order.end(), batch.draws.begin(), batch.draws.end());
+        }
+        return order;
+    }
+
+    // What DrawList promises: every draw comes out exactly once, each batch only needs its own
+    // texture, and any two draws that overlap come out in the order they went in
+    bool sameResult(
+        const DrawList& list, const std::vector<Draw>& draws, const std::vector<u32>& order)
+    {
+        bool ok = CHECK(order.size() == draws.size());
+        std::vector<u32> sorted = order;
+        std::sort(sorted.begin(), sorted.end());
+        for (u32 i = 0; i < sorted.size(); i++)
+        {
+            ok = CHECK(sorted[i] == i) && ok;
+        }
+
+        for (const auto& batch : list.batches())
+        {
+            for (u32 draw : batch.draws)
+            {
+                const void* texture = draws[draw].texture;
+                ok = CHECK(texture == nullptr || texture == batch.texture) && ok;
+            }
+        }
+
+        std::vector<u32> position(draws.size());
+        for (u32 i = 0; i < order.size() && order[i] < draws.size(); i++)
+        {
+            position[order[i]] = i;
+        }
+        for (u32 i = 0; i < draws.size(); i++)
+        {
+            for (u32 j = i + 1; j < draws.size(); j++)
+            {
+                if (draws[i].overlaps(draws[j]))
+                {
+                    ok = CHECK(position[i] < position[j]) && ok;
+                }
+            }
+        }
+        return ok;
+    }
+
+    void testMerge()
+    {
+        // Side by side icons alternating between two sheets only need one batch per sheet
+        DrawList list;
+        std::vector<Draw> draws;
+        for (u32 i = 0; i < 6; i++)
+        {
+            draws.emplace_back(Draw{i % 2 ? B : A, i * 10.0f, 0, i * 10.0f + 10, 10});
+        }
+        auto order = record(list, draws);
+        CHECK(sameResult(list, draws, order));
+        CHECK(list.batches().size() == 2);
+        CHECK(order == std::vector<u32>{0, 2, 4, 1, 3, 5});
+    }
+
+    void testOverlap()
+    {
+        // A background, something on top of it, and then more from the background's sheet on top
+        // of that. The third draw can't move under the second one, and the fourth goes with the
+        // third since that's the closest batch with its texture
+        DrawList list;
+        std::vector<Draw> draws = {
+            {A, 0, 0, 100, 100}, {B, 10, 10, 50, 50}, {A, 40, 40, 60, 60}, {A, 70, 70, 80, 80}};
+        auto order = record(list, draws);
+        CHECK(sameResult(list, draws, order));
+        CHECK(list.batches().size() == 3);
+        CHECK(order == std::vector<u32>{0, 1, 2, 3});
+
+        // Whereas one that doesn't overlap the middle draw can go under it
+        list.clear();
+        draws = {{A, 0, 0, 100, 100}, {B, 10, 10, 50, 50}, {A, 60, 60, 70, 70}};
+        order = record(list, draws);
+        CHECK(sameResult(list, draws, order));
+        CHECK(order == std::vector<u32>{0, 2, 1});
+
+        // Edges that only touch don't count as overlapping
+        list.clear();
+        draws = {{A, 0, 0, 10, 10}, {B, 10, 0, 20, 10}, {A, 0, 10, 10, 20}};
+        order = record(list, draws);
+        CHECK(sameResult(list, draws, order));
+        CHECK(list.batches().size() == 2);
+    }
+
+    void testFlipped()
+    {
+        // Mirrored sprites are drawn with right before left, which still overlaps
+        DrawList list;
+        std::vector<Draw> draws = {{A, 0, 0, 20, 20}, {B, 30, 0, 10, 20}, {A, 15, 15, 5, 5}};
+        auto order = record(list, draws);
+        CHECK(sameResult(list, draws, order));
+        CHECK(order == std::vector<u32>{0, 1, 2});
+    }
+
+    void testUntextured()
+    {
+        // Untextured draws go with whatever batch was last, and a batch that started out untextured
+        // takes the texture of the first draw that needs one
+        DrawList list;
+        std::vector<Draw> draws = {{nullptr, 0, 0, 400, 240}, {A, 0, 0, 10, 10},
+            {nullptr, 20, 20, 30, 30}, {B, 50, 50, 60, 60}, {nullptr, 0, 0, 5, 5}};
+        auto order = record(list, draws);
+        CHECK(sameResult(list, draws, order));
+        CHECK(list.batches().size() == 2);
+        CHECK(list.batches()[0].texture == A);
+        CHECK(list.batches()[1].texture == B);
+    }
+
+    void testLookback()
+    {
+        // A batch too far back to be searched gets a new one, which costs a switch but is still
+        // correct
+        DrawList list;
+        std::vector<Draw> draws;
+        const void* others[2] = {B, C};
+        draws.emplace_back(Draw{A, 0, 0, 1, 1});
+        for (u32 i = 0; i < 20; i++)
+        {
+            draws.emplace_back(Draw{others[i % 2], 0, 10.0f + i * 2, 1, 11.0f + i * 2});
+            draws.emplace_back(Draw{others[(i + 1) % 2], 0, 11.0f + i * 2, 1, 12.0f + i * 2});
+            // Overlaps the previous draw, so nothing can be merged
+            draws.back().top -= 0.5f;
+        }
+        draws.emplace_back(Draw{A, 5, 5, 6, 6});
+        auto order = record(list, draws);
+        CHECK(sameResult(list, draws, order));
+        CHECK(list.batches().back().texture == A);
+        CHECK(list.batches().front().draws.size() == 1);
+    }
+
+    void testStats()
+    {
+        DrawList list;
+        record(list, {{A, 0, 0, 10, 10}, {B, 20, 0, 30, 10}, {A, 40, 0, 50, 10}});
+        record(list, {{nullptr, 0, 0, 5, 5}});
+        CHECK(!list.empty());
+        list.clear();
+        CHECK(list.empty());
+        CHECK(list.batches().empty());
+        CHECK(list.stats().draws == 4);
+        CHECK(list.stats().batches == 2);
+        CHECK(list.stats().textureSwitches == 2);
+
+        // Neighbouring batches never share a texture, but batches from different frames can
+        record(list, {{A, 0, 0, 10, 10}});
+        list.clear();
+        CHECK(list.stats().draws == 5);
+        CHECK(list.stats().textureSwitches == 3);
+        list.resetStats();
+        CHECK(list.stats().draws == 0);
+    }
+
+    void testRandom()
+    {
+        // Lots of small draws from a few sheets scattered over a screen, like a box of sprites with
+        // text and buttons over it
+        std::mt19937 random(0);
+        const void* sheets[4] = {nullptr, A, B, C};
+        DrawList list;
+        for (u32 frame = 0; frame < 200; frame++)
+        {
+            std::vector<Draw> draws(1 + random() % 200);
+            for (auto& draw : draws)
+            {
+                draw.texture = sheets[random() % 4];
+                draw.left    = random() % 400;
+                draw.top     = random() % 240;
+                draw.right   = draw.left + 1 + random() % 40;
+                draw.bottom  = draw.top + 1 + random() % 40;
+                if (random() % 8 == 0)
+                {
+                    std::swap(draw.left, draw.right);
+                }
+            }
+            if (!sameResult(list, draws, record(list, draws)))
+            {
+                std::fprintf(stderr, "wrong order in random frame %u\n", frame);
+                break;
+            }
+            list.clear();
+        }
+        std::printf("%u draws in %u batches with %u texture switches\n", list.stats().draws,
+            list.stats().batches, list.stats().textureSwitches);
+    }
+}
+
+int main()
+{
+    testMerge();
+    testOverlap();
+    testFlipped();
+    testUntextured();
+    testLookback();
+    testStats();
+    testRandom();
+    return Test::result();
+}
@@ -0,0 +1,240 @@
+/*
+ *   This file is part of PKSM
+ *   Copyright (C) 2016-2021 Bernardo Giordano, Admiral Fish, piepie62
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *   Additional Terms 7.b and 7.c of GPLv3 apply to this file:
+ *       * Requiring preservation of specified reasonable legal notices or
+ *         author attributions in that material or in the Appropriate Legal
+ *         Notices displayed by works containing it.
+ *       * Prohibiting misrepresentation of the origin of that material,
+ *         or requiring that modified versions of such material be marked in
+ *         reasonable ways as different from the original version.
+ */
+
+#include "fetch.hpp"
+#include "test.hpp"
+#include "thread.hpp"
+#include <arpa/inet.h>
+#include <atomic>
+#include <mutex>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <openssl/err.h>
+#include <openssl/ssl.h>
+#include <openssl/x509v3.h>
+#include <string>
+#include <sys/socket.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+// Pages through a local HTTPS server with Fetch, the way the cloud screens do, and counts how many
+// connections and full TLS handshakes that takes. Each new connection is slowed down to stand in
+// for the round trips and handshake work that make them expensive on a 3DS
+namespace
+{
+    constexpr int PAGES                                 = 20;
+    constexpr size_t PAGE_SIZE                          = 0x4000;
+    constexpr std::chrono::milliseconds CONNECTION_COST = std::chrono::milliseconds(30);
+
+    // Answers every request on a connection with a page until the client hangs up
+    class TlsServer
+    {
+    public:
+        TlsServer()
+        {
+            EVP_PKEY* key = EVP_EC_gen("P-256");
+            X509* cert    = X509_new();
+            X509_set_version(cert, 2);
+            ASN1_INTEGER_set(X509_get_serialNumber(cert), 1);
+            X509_gmtime_adj(X509_getm_notBefore(cert), 0);
+            X509_gmtime_adj(X509_getm_notAfter(cert), 60 * 60);
+            X509_set_pubkey(cert, key);
+            X509_NAME* name = X509_get_subject_name(cert);
+            X509_NAME_add_entry_by_txt(
+                name, "CN", MBSTRING_ASC, (const unsigned char*)"localhost", -1, -1, 0);
+            X509_set_issuer_name(cert, name);
+            X509_sign(cert, key, EVP_sha256());
+
+            ctx = SSL_CTX_new(TLS_server_method());
+            SSL_CTX_use_certificate(ctx, cert);
+            SSL_CTX_use_PrivateKey(ctx, key);
+            X509_free(cert);
+            EVP_PKEY_free(key);
+
+            listener = socket(AF_INET, SOCK_STREAM, 0);
+            sockaddr_in addr{};
+            addr.sin_family      = AF_INET;
+            addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+            socklen_t size       = sizeof(addr);
+            bind(listener, (sockaddr*)&addr, sizeof(addr));
+            listen(listener, 16);
+            getsockname(listener, (sockaddr*)&addr, &size);
+            port = ntohs(addr.sin_port);
+
+            acceptThread = std::thread([this] { acceptLoop(); });
+        }
+
+        ~TlsServer()
+        {
+            shutdown(listener, SHUT_RDWR);
+            acceptThread.join();
+            {
+                std::lock_guard<std::mutex> lock(clientLock);
+                for (int client : clients)
+                {
+                    shutdown(client, SHUT_RDWR);
+                }
+            }
+            for (auto& thread : clientThreads)
+            {
+                thread.join();
+            }
+            close(listener);
+            SSL_CTX_free(ctx);
+        }
+
+        std::string url(int page) const
+        {
+            return "https://localhost:" + std::to_string(port) + "/page/" + std::to_string(page);
+        }
+
+        std::atomic<u32> connections    = 0;
+        std::atomic<u32> fullHandshakes = 0;
+        std::atomic<u32> requests       = 0;
+
+    private:
+        void acceptLoop()
+        {
+            int client;
+            while ((client = accept(listener, nullptr, nullptr)) >= 0)
+            {
+                connections++;
+                // Like any real server, or every response on a kept alive connection waits out
+                // the client's delayed ACK
+                int noDelay = 1;
+                setsockopt(client, IPPROTO_TCP, TCP_NODELAY, &noDelay, sizeof(noDelay));
+                std::lock_guard<std::mutex> lock(clientLock);
+                clients.emplace_back(client);
+                clientThreads.emplace_back([this, client] { serve(client); });
+            }
+        }
+
+        void serve(int client)
+        {
+            std::this_thread::sleep_for(CONNECTION_COST);
+            SSL* ssl = SSL_new(ctx);
+            SSL_set_fd(ssl, client);
+            if (SSL_accept(ssl) == 1)
+            {
+                if (!SSL_session_reused(ssl))
+                {
+                    fullHandshakes++;
+                }
+                const std::string page = "HTTP/1.1 200 OK\r\nContent-Type: application/json\r\n"
+                                         "Content-Length: " +
+                                         std::to_string(PAGE_SIZE) + "\r\n\r\n" +
+                                         std::string(PAGE_SIZE, ' ');
+                std::string request;
+                char buffer[0x1000];
+                int read;
+                while ((read = SSL_read(ssl, buffer, sizeof(buffer))) > 0)
+                {
+                    request.append(buffer, read);
+                    size_t end;
+                    while ((end = request.find("\r\n\r\n")) != std::string::npos)
+                    {
+                        request.erase(0, end + 4);
+                        requests++;
+                        SSL_write(ssl, page.data(), page.size());
+                    }
+                }
+                SSL_shutdown(ssl);
+            }
+            SSL_free(ssl);
+            close(client);
+        }
+
+        SSL_CTX* ctx;
+        int listener;
+        u16 port;
+        std::thread acceptThread;
+        std::mutex clientLock;
+        std::vector<int> clients;
+        std::vector<std::thread> clientThreads;
+    };
+
+    // Gets every page one after another, each with its own Fetch like CloudAccess does
+    template <typename Setup>
+    void browse(const char* name, Setup&& setup)
+    {
+        TlsServer server;
+        bool ok = true;
+        Test::time(name, 1,
+            [&]
+            {
+                for (int page = 0; page < PAGES; page++)
+                {
+                    std::string data;
+                    auto fetch = Fetch::init(server.url(page), true, &data, nullptr, "");
+                    if (!CHECK(fetch != nullptr))
+                    {
+                        ok = false;
+                        return;
+                    }
+                    setup(*fetch);
+                    auto res = Fetch::perform(fetch);
+                    ok = CHECK(res.index() == 1 && std::get<1>(res) == CURLE_OK) && ok;
+                    ok = CHECK(data.size() == PAGE_SIZE) && ok;
+                }
+            });
+        CHECK(!ok || server.requests == PAGES);
+        std::printf("%-40s %5u connections %5u full handshakes\n", "", server.connections.load(),
+            server.fullHandshakes.load());
+        // Closes the pooled connections before the server goes away
+        Fetch::exitMulti();
+        Fetch::initMulti();
+    }
+}
+
+int main()
+{
+    curl_global_init(CURL_GLOBAL_DEFAULT);
+    if (!CHECK(Threads::init(1)) || !CHECK(Fetch::initMulti() == 0))
+    {
+        return Test::result();
+    }
+
+    std::printf("%d pages of %zu bytes, %lld ms per new connection\n", PAGES, PAGE_SIZE,
+        (long long)CONNECTION_COST.count());
+    browse("new connection for every page",
+        [](Fetch& fetch)
+        {
+            fetch.setopt(CURLOPT_SHARE, (CURLSH*)nullptr);
+            fetch.setopt(CURLOPT_FRESH_CONNECT, 1L);
+            fetch.setopt(CURLOPT_FORBID_REUSE, 1L);
+        });
+    // Older libcurl, like the one on the 3DS, keeps TLS sessions per easy handle, so without the
+    // share only the connections themselves are reused
+    browse("multi handle's pool only",
+        [](Fetch& fetch) { fetch.setopt(CURLOPT_SHARE, (CURLSH*)nullptr); });
+    browse("shared pool (Fetch::init)", [](Fetch&) {});
+
+    Fetch::exitMulti();
+    Threads::exit();
+    curl_global_cleanup();
+    return Test::result();
+}
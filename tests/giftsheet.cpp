@@ -0,0 +1,198 @@
+/*
+ *   This file is part of PKSM
+ *   Copyright (C) 2016-2021 Bernardo Giordano, Admiral Fish, piepie62
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *   Additional Terms 7.b and 7.c of GPLv3 apply to this file:
+ *       * Requiring preservation of specified reasonable legal notices or
+ *         author attributions in that material or in the Appropriate Legal
+ *         Notices displayed by works containing it.
+ *       * Prohibiting misrepresentation of the origin of that material,
+ *         or requiring that modified versions of such material be marked in
+ *         reasonable ways as different from the original version.
+ */
+
+#include "GiftSheet.hpp"
+#include "test.hpp"
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <random>
+#include <string>
+
+// Times opening the Mystery Gift sheet and building the gallery list from it, the way
+// InjectSelectorScreen does, both from the JSON sheet as it used to and from the binary one. Pass
+// an inflated sheet<gen>.json to use a real one, otherwise one about the size of the gen 7 sheet
+// is made up
+namespace
+{
+    std::string makeSheet()
+    {
+        const char* langs[] = {"ENG", "JPN", "FRE", "ITA", "GER", "SPA", "KOR", "CHS", "CHT"};
+        const char* games[] = {"SM", "USUM", "SMUSUM"};
+        std::mt19937 random(0);
+        nlohmann::json sheet = nlohmann::json::object();
+        sheet["gen"]         = "7";
+        sheet["wondercards"] = nlohmann::json::array();
+        sheet["matches"]     = nlohmann::json::array();
+        u32 offset           = 0;
+        for (int event = 0; event < 300; event++)
+        {
+            nlohmann::json match = nlohmann::json::object();
+            int species          = 1 + random() % 807;
+            for (const char* lang : langs)
+            {
+                if (random() % 3 == 0)
+                {
+                    continue;
+                }
+                nlohmann::json card = nlohmann::json::object();
+                card["name"]        = std::to_string(event) + " - Event Pokemon " + lang;
+                card["game"]        = games[random() % 3];
+                card["type"]        = random() % 2 ? "wc7full" : "wc7";
+                card["species"]     = random() % 10 == 0 ? -1 : species;
+                card["form"]        = 0;
+                card["gender"]      = random() % 3;
+                card["offset"]      = offset;
+                if (random() % 20 == 0)
+                {
+                    card["released"] = false;
+                }
+                match[lang] = sheet["wondercards"].size();
+
+                offset += card["type"] == "wc7full" ? 0x310 : 0x108;
+                sheet["wondercards"].emplace_back(std::move(card));
+            }
+            sheet["matches"].emplace_back(std::move(match));
+        }
+        return sheet.dump(2);
+    }
+
+    struct Info
+    {
+        std::string name;
+        std::string game;
+        int species;
+        int form;
+        int gender;
+        bool released;
+        bool operator==(const Info&) const = default;
+    };
+
+    // What MysteryGift::wondercardInfo used to do, copy of the entry and all
+    Info jsonInfo(const nlohmann::json& sheet, size_t index)
+    {
+        nlohmann::json entry = sheet["wondercards"][index];
+        return Info{entry["name"].get<std::string>(), entry["game"].get<std::string>(),
+            entry["species"].get<int>(), entry["form"].get<int>(), entry["gender"].get<int>(),
+            entry.contains("released") ? entry["released"].get<bool>() : true};
+    }
+
+    Info sheetInfo(const GiftSheet& sheet, size_t index)
+    {
+        return Info{sheet.strings + sheet.names[index], sheet.strings + sheet.games[index],
+            sheet.species[index], sheet.forms[index], sheet.genders[index],
+            bool(sheet.released[index])};
+    }
+
+    // The card for lang out of each of the sheet's matches, or the first one there is
+    template <typename GetInfo>
+    std::vector<Info> galleryList(
+        const nlohmann::json& matches, const std::string& lang, GetInfo&& getInfo)
+    {
+        std::vector<Info> ret;
+        for (const auto& match : matches)
+        {
+            auto card = match.find(lang);
+            ret.emplace_back(getInfo(card != match.end() ? *card : *match.begin()));
+        }
+        return ret;
+    }
+
+    std::unique_ptr<u8[]> copySheet(const std::unique_ptr<u8[]>& buffer)
+    {
+        size_t size = GiftSheet::size(*(const GiftSheet::Header*)buffer.get());
+        std::unique_ptr<u8[]> ret(new u8[size]);
+        std::memcpy(ret.get(), buffer.get(), size);
+        return ret;
+    }
+}
+
+int main(int argc, char** argv)
+{
+    std::string text;
+    if (argc > 1)
+    {
+        std::ifstream in(argv[1], std::ios::binary);
+        text.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+    }
+    else
+    {
+        text = makeSheet();
+    }
+    nlohmann::json json = nlohmann::json::parse(text, nullptr, false);
+    if (!CHECK(json.is_object() && json.contains("wondercards") && json.contains("matches")))
+    {
+        return Test::result();
+    }
+
+    std::unique_ptr<u8[]> binary = GiftSheet::build(json, {});
+    GiftSheet sheet;
+    sheet.use(copySheet(binary));
+    std::printf("%u cards in %zu events, %zu bytes of JSON and %zu binary\n", sheet.count,
+        sheet.matches.size(), text.size(),
+        GiftSheet::size(*(const GiftSheet::Header*)binary.get()));
+
+    CHECK(sheet.gen != GiftSheet::GEN_BAD);
+    CHECK(sheet.count == json["wondercards"].size());
+    CHECK(sheet.matches == json["matches"]);
+    for (u32 i = 0; i < sheet.count; i++)
+    {
+        CHECK(sheetInfo(sheet, i) == jsonInfo(json, i));
+    }
+
+    // Done once per sheet update, and then again whenever the gift list is opened
+    Test::time("parse JSON sheet (old open)", 10,
+        [&] { return nlohmann::json::parse(text, nullptr, false); });
+    Test::time("GiftSheet::build (sheet updated)", 10, [&] { GiftSheet::build(json, {}); });
+    Test::time("GiftSheet::use (open)", 10,
+        [&]
+        {
+            GiftSheet opened;
+            opened.use(copySheet(binary));
+        });
+
+    // The whole list, which is a few times what the screen looks up each frame
+    const std::string lang = "ENG";
+    auto fromJson = galleryList(json["matches"], lang,
+        [&](const nlohmann::json& index) { return jsonInfo(json, index.get<size_t>()); });
+    auto fromSheet = galleryList(sheet.matches, lang,
+        [&](const nlohmann::json& index) { return sheetInfo(sheet, index.get<size_t>()); });
+    CHECK(fromJson == fromSheet);
+    Test::time("gallery list from JSON (old)", 20,
+        [&]
+        {
+            galleryList(json["matches"], lang,
+                [&](const nlohmann::json& index) { return jsonInfo(json, index.get<size_t>()); });
+        });
+    Test::time("gallery list from GiftSheet", 20,
+        [&]
+        {
+            galleryList(sheet.matches, lang,
+                [&](const nlohmann::json& index) { return sheetInfo(sheet, index.get<size_t>()); });
+        });
+
+    return Test::result();
+}
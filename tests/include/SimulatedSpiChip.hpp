@@ -0,0 +1,239 @@
+/*
+ *   This file is part of PKSM
+ *   Copyright (C) 2016-2021 Bernardo Giordano, Admiral Fish, piepie62
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *   Additional Terms 7.b and 7.c of GPLv3 apply to this file:
+ *       * Requiring preservation of specified reasonable legal notices or
+ *         author attributions in that material or in the Appropriate Legal
+ *         Notices displayed by works containing it.
+ *       * Prohibiting misrepresentation of the origin of that material,
+ *         or requiring that modified versions of such material be marked in
+ *         reasonable ways as different from the original version.
+ */
+
+#ifndef SIMULATEDSPICHIP_HPP
+#define SIMULATEDSPICHIP_HPP
+
+#include "SpiPlanner.hpp"
+#include <algorithm>
+#include <vector>
+
+// A DS save chip in memory, behind the same SpiTransport the 3DS talks to the real one through.
+// It follows the commands closely enough for SpiPlanner to detect and use it, counts every
+// transaction, and counts anything a real chip would ignore or get wrong: commands while a write
+// is still in progress, writes without the write enable latch set, and answers larger than the
+// transport allows
+class SimulatedSpiChip : public SpiTransport
+{
+public:
+    enum class Kind
+    {
+        EEPROM_512B,
+        EEPROM,
+        FLASH
+    };
+
+    // addressBytes only matters for EEPROMs; 512 byte EEPROMs carry the high address bit in the
+    // command instead
+    SimulatedSpiChip(Kind kind, u32 size, u32 jedec = 0xFFFFFF, u32 addressBytes = 2)
+        : kind(kind), jedec(jedec), addressBytes(addressBytes), memory(size, 0xFF)
+    {
+    }
+
+    Result transfer(CardType, const void* cmdData, u32 cmdSize, void* answerData, u32 answerSize,
+        const void* data, u32 dataSize) override
+    {
+        const u8* cmd = (const u8*)cmdData;
+        u8* answer    = (u8*)answerData;
+        transactions++;
+        largestAnswer = std::max(largestAnswer, answerSize);
+        if (answerSize > maxTransfer())
+        {
+            violations++;
+        }
+        if (cmdSize == 0)
+        {
+            violations++;
+            return 0;
+        }
+
+        if (cmd[0] == SPI_CMD_RDSR)
+        {
+            statusReads++;
+            std::fill_n(answer, answerSize, status());
+            if (busyPolls > 0)
+            {
+                busyPolls--;
+            }
+            return 0;
+        }
+        // Everything but reading the status register is ignored until a write is done
+        if (busyPolls > 0)
+        {
+            violations++;
+            return 0;
+        }
+
+        if (cmd[0] == SPI_CMD_WREN)
+        {
+            writeEnabled = true;
+        }
+        else if (cmd[0] == SPI_FLASH_CMD_RDID)
+        {
+            u8 id[3] = {u8(jedec >> 16), u8(jedec >> 8), u8(jedec)};
+            for (u32 i = 0; i < answerSize; i++)
+            {
+                answer[i] = i < 3 ? id[i] : 0xFF;
+            }
+        }
+        else if (isRead(cmd[0]))
+        {
+            reads++;
+            u32 address = this->address(cmd, cmdSize);
+            for (u32 i = 0; i < answerSize; i++)
+            {
+                // Addresses past the end wrap around, which is what EEPROM size detection relies on
+                answer[i] = memory[(address + i) % memory.size()];
+            }
+        }
+        else if (isWrite(cmd[0]))
+        {
+            if (!writeEnabled)
+            {
+                violations++;
+                return 0;
+            }
+            writes++;
+            u32 address = this->address(cmd, cmdSize);
+            // Writes wrap around within the page they start in
+            u32 page = address - address % pageSize();
+            for (u32 i = 0; i < dataSize; i++)
+            {
+                u32 at = (page + (address - page + i) % pageSize()) % memory.size();
+                if (kind == Kind::FLASH && cmd[0] == SPI_CMD_PP)
+                {
+                    // Programming can only clear bits
+                    memory[at] &= ((const u8*)data)[i];
+                }
+                else
+                {
+                    memory[at] = ((const u8*)data)[i];
+                }
+            }
+            startWrite();
+        }
+        else if (kind == Kind::FLASH && cmd[0] == SPI_FLASH_CMD_SE)
+        {
+            if (!writeEnabled)
+            {
+                violations++;
+                return 0;
+            }
+            erases++;
+            u32 sector = this->address(cmd, cmdSize) & ~0xFFFF;
+            std::fill_n(memory.begin() + sector % memory.size(),
+                std::min<size_t>(0x10000, memory.size()), 0xFF);
+            startWrite();
+        }
+        else
+        {
+            violations++;
+        }
+        return 0;
+    }
+
+    u32 maxTransfer() const override { return 0x10000; }
+
+    void resetCounters()
+    {
+        transactions = statusReads = reads = writes = erases = violations = largestAnswer = 0;
+    }
+
+    const Kind kind;
+    const u32 jedec;
+    const u32 addressBytes;
+    std::vector<u8> memory;
+    // How many status reads a write or erase stays in progress for
+    u32 writeTime = 3;
+
+    u32 transactions  = 0;
+    u32 statusReads   = 0;
+    u32 reads         = 0;
+    u32 writes        = 0;
+    u32 erases        = 0;
+    u32 violations    = 0;
+    u32 largestAnswer = 0;
+
+private:
+    u8 status() const
+    {
+        // 512 byte EEPROMs answer 0xF0 to the status register, which is how they're told apart
+        u8 base = kind == Kind::EEPROM_512B ? 0xF0 : 0x00;
+        return base | (writeEnabled ? SPI_FLG_WEL : 0) | (busyPolls > 0 ? SPI_FLG_WIP : 0);
+    }
+
+    u32 pageSize() const
+    {
+        if (kind == Kind::FLASH)
+        {
+            return 256;
+        }
+        return kind == Kind::EEPROM_512B ? 16 : memory.size() <= 0x2000 ? 32 : 128;
+    }
+
+    bool isRead(u8 op) const
+    {
+        return op == SPI_CMD_READ || (kind == Kind::EEPROM_512B && op == SPI_512B_EEPROM_CMD_RDHI);
+    }
+
+    bool isWrite(u8 op) const
+    {
+        if (kind == Kind::FLASH)
+        {
+            return op == SPI_CMD_PP || op == SPI_FLASH_CMD_PW;
+        }
+        return op == SPI_EEPROM_CMD_WRITE ||
+               (kind == Kind::EEPROM_512B && op == SPI_512B_EEPROM_CMD_WRHI);
+    }
+
+    u32 address(const u8* cmd, u32 cmdSize) const
+    {
+        if (kind == Kind::EEPROM_512B)
+        {
+            bool high = cmd[0] == SPI_512B_EEPROM_CMD_RDHI || cmd[0] == SPI_512B_EEPROM_CMD_WRHI;
+            return (high ? 0x100 : 0) | (cmdSize > 1 ? cmd[1] : 0);
+        }
+        // The chip takes as many address bytes as it uses, whatever it's actually sent
+        u32 bytes   = kind == Kind::FLASH ? 3 : addressBytes;
+        u32 address = 0;
+        for (u32 i = 1; i <= bytes; i++)
+        {
+            address = (address << 8) | (i < cmdSize ? cmd[i] : 0);
+        }
+        return address;
+    }
+
+    void startWrite()
+    {
+        writeEnabled = false;
+        busyPolls    = writeTime;
+    }
+
+    bool writeEnabled = false;
+    u32 busyPolls     = 0;
+};
+
+#endif
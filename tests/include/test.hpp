@@ -0,0 +1,78 @@
+/*
+ *   This file is part of PKSM
+ *   Copyright (C) 2016-2021 Bernardo Giordano, Admiral Fish, piepie62
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *   Additional Terms 7.b and 7.c of GPLv3 apply to this file:
+ *       * Requiring preservation of specified reasonable legal notices or
+ *         author attributions in that material or in the Appropriate Legal
+ *         Notices displayed by works containing it.
+ *       * Prohibiting misrepresentation of the origin of that material,
+ *         or requiring that modified versions of such material be marked in
+ *         reasonable ways as different from the original version.
+ */
+
+#ifndef TEST_HPP
+#define TEST_HPP
+
+#include <chrono>
+#include <cstdio>
+
+// Just enough for the host tests: failed checks are printed and counted, and main returns
+// Test::result() so that make stops on the first test program with a failure
+namespace Test
+{
+    inline int failures = 0;
+
+    inline bool check(bool passed, const char* expression, const char* file, int line)
+    {
+        if (!passed)
+        {
+            std::fprintf(stderr, "%s:%d: check failed: %s\n", file, line, expression);
+            failures++;
+        }
+        return passed;
+    }
+
+    inline int result()
+    {
+        if (failures > 0)
+        {
+            std::fprintf(stderr, "%d check(s) failed\n", failures);
+            return 1;
+        }
+        return 0;
+    }
+
+    // Runs function the given number of times and prints the average time per run
+    template <typename Function>
+    double time(const char* name, int runs, Function&& function)
+    {
+        auto start = std::chrono::steady_clock::now();
+        for (int run = 0; run < runs; run++)
+        {
+            function();
+        }
+        std::chrono::duration<double, std::micro> elapsed =
+            std::chrono::steady_clock::now() - start;
+        double perRun = elapsed.count() / runs;
+        std::printf("%-40s %12.2f us\n", name, perRun);
+        return perRun;
+    }
+}
+
+#define CHECK(...) Test::check(bool(__VA_ARGS__), #__VA_ARGS__, __FILE__, __LINE__)
+
+#endif
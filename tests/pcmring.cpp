@@ -0,0 +1,245 @@
+/*
+ *   This file is part of PKSM
+ *   Copyright (C) 2016-2021 Bernardo Giordano, Admiral Fish, piepie62
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *   Additional Terms 7.b and 7.c of GPLv3 apply to this file:
+ *       * Requiring preservation of specified reasonable legal notices or
+ *         author attributions in that material or in the Appropriate Legal
+ *         Notices displayed by works containing it.
+ *       * Prohibiting misrepresentation of the origin of that material,
+ *         or requiring that modified versions of such material be marked in
+ *         reasonable ways as different from the original version.
+ */
+
+#include "Decoder.hpp"
+#include "PcmRing.hpp"
+#include "test.hpp"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <thread>
+
+namespace
+{
+    using Clock = std::chrono::steady_clock;
+
+    // Counts up from 0 so that every sample says where it belongs in the stream. Every so often a
+    // call stalls, the way mpg123 does when it has to wait on the SD card
+    class ToneDecoder : public Decoder
+    {
+    public:
+        ToneDecoder(u32 samples, u32 stallEvery, std::chrono::microseconds stall)
+            : mSamples(samples), mStallEvery(stallEvery), mStall(stall)
+        {
+            initialized = true;
+        }
+
+        u32 pos() override { return mPos; }
+        u32 length() override { return mSamples; }
+        u32 decode(void* buffer, size_t bufferSize) override
+        {
+            if (mStallEvery && ++mCalls % mStallEvery == 0)
+            {
+                std::this_thread::sleep_for(mStall);
+            }
+            u32 samples = std::min<u32>(bufferSize / sizeof(s16), mSamples - mPos);
+            for (u32 i = 0; i < samples; i++)
+            {
+                ((s16*)buffer)[i] = (mPos + i) & 0x7FFF;
+            }
+            mPos += samples;
+            return samples;
+        }
+        bool stereo() override { return false; }
+        // Fast enough that a block of a few hundred samples plays in well under a millisecond
+        u32 sampleRate() override { return 1000000; }
+
+    private:
+        u32 mSamples;
+        u32 mStallEvery;
+        std::chrono::microseconds mStall;
+        u32 mPos   = 0;
+        u32 mCalls = 0;
+    };
+
+    struct Playback
+    {
+        u32 samples   = 0;
+        u32 underruns = 0;
+        bool ordered  = true;
+    };
+
+    // Decodes the whole stream on one thread while the other plays it back in real time the same
+    // way sound.cpp does: the block being played stays in the ring until it has finished, and
+    // running out of blocks while the producer is still going is one underrun per gap
+    Playback play(Decoder& decoder, size_t blocks, size_t blockSize)
+    {
+        PcmRing ring(blocks, blockSize);
+        std::atomic<bool> finished = false;
+        Playback ret;
+        if (!CHECK(ring.good()))
+        {
+            return ret;
+        }
+
+        std::thread producer(
+            [&]
+            {
+                bool first = true;
+                while (true)
+                {
+                    PcmRing::Block* block = ring.back();
+                    if (!block)
+                    {
+                        std::this_thread::yield();
+                        continue;
+                    }
+                    block->samples = decoder.decode(block->data, ring.blockSize());
+                    if (block->samples == 0)
+                    {
+                        break;
+                    }
+                    block->sampleRate = decoder.sampleRate();
+                    block->stereo     = decoder.stereo();
+                    block->track      = 0;
+                    block->first      = first;
+                    first             = false;
+                    ring.push();
+                }
+                finished = true;
+            });
+
+        // Let the decoder get ahead first, like playback only starts once a song has begun decoding
+        while (!finished && ring.peek(ring.capacity() - 1) == nullptr)
+        {
+            std::this_thread::yield();
+        }
+
+        Clock::time_point playingUntil;
+        bool holding = false;
+        bool dry     = false;
+        while (true)
+        {
+            if (holding)
+            {
+                std::this_thread::sleep_until(playingUntil);
+                ring.pop();
+                holding = false;
+            }
+
+            bool done             = finished;
+            PcmRing::Block* block = ring.front();
+            if (!block)
+            {
+                if (done)
+                {
+                    break;
+                }
+                if (!dry)
+                {
+                    ring.underrun();
+                    dry = true;
+                }
+                std::this_thread::yield();
+                continue;
+            }
+
+            ret.ordered = ret.ordered && block->first == (ret.samples == 0);
+            for (u32 i = 0; i < block->samples; i++)
+            {
+                ret.ordered = ret.ordered && block->data[i] == s16((ret.samples + i) & 0x7FFF);
+            }
+            ret.samples += block->samples;
+
+            playingUntil = Clock::now() + std::chrono::microseconds(
+                                              u64(block->samples) * 1000000 / block->sampleRate);
+            holding      = true;
+            dry          = false;
+        }
+
+        producer.join();
+        ret.underruns = ring.underruns();
+        return ret;
+    }
+
+    void testRing()
+    {
+        PcmRing ring(4, 16);
+        CHECK(ring.good());
+        CHECK(ring.front() == nullptr);
+
+        // Go around a few times so the indices wrap
+        for (u32 round = 0; round < 3; round++)
+        {
+            for (u32 i = 0; i < ring.capacity(); i++)
+            {
+                PcmRing::Block* block = ring.back();
+                if (!CHECK(block != nullptr))
+                {
+                    return;
+                }
+                block->samples = round * 10 + i;
+                ring.push();
+            }
+            CHECK(ring.back() == nullptr);
+            CHECK(ring.peek(ring.capacity()) == nullptr);
+            CHECK(ring.peek(2)->samples == round * 10 + 2);
+
+            for (u32 i = 0; i < ring.capacity(); i++)
+            {
+                CHECK(ring.front()->samples == round * 10 + i);
+                ring.pop();
+            }
+            CHECK(ring.front() == nullptr);
+        }
+    }
+
+    void testPlayback()
+    {
+        // 200 blocks of 1ms each, with a 4ms stall every 40 blocks
+        constexpr u32 blockSamples = 1000;
+        constexpr u32 samples      = 200 * blockSamples;
+
+        ToneDecoder smooth(samples, 0, {});
+        Playback result = play(smooth, 4, blockSamples * sizeof(s16));
+        std::printf("%-40s %12u underruns\n", "no stalls, 4 blocks", result.underruns);
+        CHECK(result.samples == samples);
+        CHECK(result.ordered);
+
+        // Less than a stall's worth of lookahead has to run dry
+        ToneDecoder stallingShort(samples, 40, std::chrono::milliseconds(4));
+        result = play(stallingShort, 2, blockSamples * sizeof(s16));
+        std::printf("%-40s %12u underruns\n", "4ms stalls, 2 blocks", result.underruns);
+        CHECK(result.samples == samples);
+        CHECK(result.ordered);
+        CHECK(result.underruns > 0);
+
+        // Plenty of lookahead covers the stalls completely
+        ToneDecoder stallingLong(samples, 40, std::chrono::milliseconds(4));
+        result = play(stallingLong, 16, blockSamples * sizeof(s16));
+        std::printf("%-40s %12u underruns\n", "4ms stalls, 16 blocks", result.underruns);
+        CHECK(result.samples == samples);
+        CHECK(result.ordered);
+        CHECK(result.underruns == 0);
+    }
+}
+
+int main()
+{
+    testRing();
+    testPlayback();
+    return Test::result();
+}
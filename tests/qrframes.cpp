@@ -0,0 +1,131 @@
+/*
+ *   This file is part of PKSM
+ *   Copyright (C) 2016-2021 Bernardo Giordano, Admiral Fish, piepie62
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *   Additional Terms 7.b and 7.c of GPLv3 apply to this file:
+ *       * Requiring preservation of specified reasonable legal notices or
+ *         author attributions in that material or in the Appropriate Legal
+ *         Notices displayed by works containing it.
+ *       * Prohibiting misrepresentation of the origin of that material,
+ *         or requiring that modified versions of such material be marked in
+ *         reasonable ways as different from the original version.
+ */
+
+#include "Swizzle.hpp"
+#include "test.hpp"
+#include <cstring>
+#include <fstream>
+#include <random>
+#include <vector>
+
+// Times copying camera frames into the QR scanner's 512x256 texture. Pass raw 400x240 RGB565
+// frames as recorded from the camera to time those, otherwise a few made up ones are used
+namespace
+{
+    constexpr u32 FRAME_WIDTH   = 400;
+    constexpr u32 FRAME_HEIGHT  = 240;
+    constexpr u32 TEXTURE_WIDTH = 512;
+    using Frame                 = std::vector<u16>;
+
+    // What buffToImage used to do: one memcpy per texel, going down each column of the frame
+    void columnCopy(const u16* frame, u16* texture)
+    {
+        for (u32 x = 0; x < FRAME_WIDTH; x++)
+        {
+            for (u32 y = 0; y < FRAME_HEIGHT; y++)
+            {
+                u32 dstPos = Swizzle::offset(x, y, TEXTURE_WIDTH) * 2;
+                u32 srcPos = (y * FRAME_WIDTH + x) * 2;
+                std::memcpy((u8*)texture + dstPos, (const u8*)frame + srcPos, 2);
+            }
+        }
+    }
+
+    bool readFrame(const char* path, Frame& frame)
+    {
+        frame.resize(FRAME_WIDTH * FRAME_HEIGHT);
+        std::ifstream in(path, std::ios::binary);
+        return bool(in.read((char*)frame.data(), frame.size() * sizeof(u16)));
+    }
+
+    // Noise over a gradient with a grid of dark squares, which is about what a camera pointed at a
+    // QR code sees
+    Frame makeFrame(std::mt19937& random)
+    {
+        Frame frame(FRAME_WIDTH * FRAME_HEIGHT);
+        for (u32 y = 0; y < FRAME_HEIGHT; y++)
+        {
+            for (u32 x = 0; x < FRAME_WIDTH; x++)
+            {
+                bool dark = x >= 100 && x < 300 && y >= 20 && y < 220 && (random() & 1) &&
+                            ((x / 8) + (y / 8)) % 2;
+                u32 light = dark ? 4 : 20 + x * 8 / FRAME_WIDTH + random() % 4;
+                frame[y * FRAME_WIDTH + x] = (light << 11) | (light * 2 << 5) | light;
+            }
+        }
+        return frame;
+    }
+}
+
+int main(int argc, char** argv)
+{
+    std::vector<Frame> frames;
+    for (int i = 1; i < argc; i++)
+    {
+        Frame frame;
+        if (!CHECK(readFrame(argv[i], frame)))
+        {
+            std::fprintf(stderr, "%s isn't a %ux%u RGB565 frame\n", argv[i], FRAME_WIDTH,
+                FRAME_HEIGHT);
+            return Test::result();
+        }
+        frames.emplace_back(std::move(frame));
+    }
+    if (frames.empty())
+    {
+        std::mt19937 random(0);
+        for (int i = 0; i < 8; i++)
+        {
+            frames.emplace_back(makeFrame(random));
+        }
+    }
+    std::printf("%zu frames\n", frames.size());
+
+    std::vector<u16> oldTexture(TEXTURE_WIDTH * 256), newTexture(TEXTURE_WIDTH * 256);
+    for (const Frame& frame : frames)
+    {
+        columnCopy(frame.data(), oldTexture.data());
+        Swizzle::fromLinear(
+            frame.data(), FRAME_WIDTH, FRAME_HEIGHT, newTexture.data(), TEXTURE_WIDTH);
+        CHECK(oldTexture == newTexture);
+    }
+
+    size_t next = 0;
+    Test::time("texel at a time by column", 200,
+        [&]
+        {
+            columnCopy(frames[next++ % frames.size()].data(), oldTexture.data());
+        });
+    next = 0;
+    Test::time("Swizzle::fromLinear", 200,
+        [&]
+        {
+            Swizzle::fromLinear(frames[next++ % frames.size()].data(), FRAME_WIDTH, FRAME_HEIGHT,
+                newTexture.data(), TEXTURE_WIDTH);
+        });
+
+    return Test::result();
+}
@@ -0,0 +1,205 @@
+/*
+ *   This file is part of PKSM
+ *   Copyright (C) 2016-2021 Bernardo Giordano, Admiral Fish, piepie62
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *   Additional Terms 7.b and 7.c of GPLv3 apply to this file:
+ *       * Requiring preservation of specified reasonable legal notices or
+ *         author attributions in that material or in the Appropriate Legal
+ *         Notices displayed by works containing it.
+ *       * Prohibiting misrepresentation of the origin of that material,
+ *         or requiring that modified versions of such material be marked in
+ *         reasonable ways as different from the original version.
+ */
+
+#include "SaveIndex.hpp"
+#include "test.hpp"
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+namespace
+{
+    constexpr int TITLES            = 40;
+    constexpr int BACKUPS_PER_TITLE = 100;
+    constexpr int OTHER_TITLES      = 100;
+
+    // Title IDs formatted the way the loader does it, with a DS game code thrown in
+    std::vector<std::string> titleIds()
+    {
+        std::vector<std::string> ret;
+        char id[8];
+        for (int i = 0; i < TITLES - 1; i++)
+        {
+            std::snprintf(id, sizeof(id), "0x%05X", 0x0055D + i * 0x10);
+            ret.emplace_back(id);
+        }
+        ret.emplace_back("IPKE");
+        return ret;
+    }
+
+    std::string saveName(const std::string& id)
+    {
+        return id.starts_with("0x") ? "main" : "POKEMON HG.sav";
+    }
+
+    void touch(const fs::path& path)
+    {
+        std::ofstream(path) << path.filename().string();
+    }
+
+    // Lays out root the way Checkpoint does, plus everything the index has to skip over: title
+    // folders nobody asked about, backups without the save, a folder with the save's name, and
+    // loose files where only folders are expected
+    void makeTree(const fs::path& root, const std::vector<std::string>& ids)
+    {
+        for (const auto& id : ids)
+        {
+            fs::path title = root / (id + " Pokemon Test");
+            for (int i = 0; i < BACKUPS_PER_TITLE; i++)
+            {
+                fs::path backup = title / ("2026" + std::to_string(1000 + i));
+                fs::create_directories(backup);
+                switch (i % 5)
+                {
+                    case 0:
+                        touch(backup / "other.bin");
+                        break;
+                    case 1:
+                        fs::create_directory(backup / saveName(id));
+                        break;
+                    default:
+                        touch(backup / saveName(id));
+                        break;
+                }
+            }
+            touch(title / saveName(id));
+        }
+        for (int i = 0; i < OTHER_TITLES; i++)
+        {
+            for (int j = 0; j < 10; j++)
+            {
+                fs::path title  = root / ("0xF" + std::to_string(1000 + i) + " Something Else");
+                fs::path backup = title / std::to_string(j);
+                fs::create_directories(backup);
+                touch(backup / "main");
+            }
+        }
+        touch(root / "main");
+    }
+
+    // What the loader did before the index: walk every title folder of root again for each ID
+    std::vector<std::string> walk(
+        const std::string& root, const std::string& prefix, const std::string& saveName)
+    {
+        std::vector<std::string> ret;
+        for (const auto& title : fs::directory_iterator(root))
+        {
+            if (!title.is_directory() || !title.path().filename().string().starts_with(prefix))
+            {
+                continue;
+            }
+            for (const auto& backup : fs::directory_iterator(title.path()))
+            {
+                if (backup.is_directory() && fs::is_regular_file(backup.path() / saveName))
+                {
+                    ret.emplace_back((backup.path() / saveName).string());
+                }
+            }
+        }
+        return ret;
+    }
+
+    std::vector<SaveIndex::Title> titles(const std::vector<std::string>& ids)
+    {
+        std::vector<SaveIndex::Title> ret;
+        for (const auto& id : ids)
+        {
+            ret.emplace_back(SaveIndex::Title{id, saveName(id)});
+        }
+        return ret;
+    }
+
+    void testIndex(const std::string& root, const std::vector<std::string>& ids)
+    {
+        SaveIndex index;
+        // Not scanned yet
+        CHECK(index.find(root, ids[0]).empty());
+
+        index.scan(root, titles(ids));
+        size_t total = 0;
+        for (const auto& id : ids)
+        {
+            std::vector<std::string> found    = index.find(root, id);
+            std::vector<std::string> expected = walk(root, id, saveName(id));
+            std::sort(found.begin(), found.end());
+            std::sort(expected.begin(), expected.end());
+            CHECK(found == expected);
+            CHECK(found.size() == BACKUPS_PER_TITLE * 3 / 5);
+            total += found.size();
+        }
+        CHECK(total == TITLES * BACKUPS_PER_TITLE * 3 / 5);
+
+        // Folders that weren't asked for aren't looked into
+        CHECK(index.find(root, "0xF").empty());
+
+        // Scanning again replaces what was there
+        fs::remove_all(fs::path(root) / (ids[0] + " Pokemon Test"));
+        index.scan(root, titles({ids[1]}));
+        CHECK(index.find(root, ids[0]).empty());
+        CHECK(index.find(root, ids[1]).size() == BACKUPS_PER_TITLE * 3 / 5);
+    }
+
+    void timeIndex(const std::string& root, const std::vector<std::string>& ids)
+    {
+        Test::time("walk root once per title", 5, [&] {
+            for (const auto& id : ids)
+            {
+                walk(root, id, saveName(id));
+            }
+        });
+        Test::time("SaveIndex", 5, [&] {
+            SaveIndex index;
+            index.scan(root, titles(ids));
+        });
+    }
+}
+
+int main()
+{
+    char path[] = "/tmp/saveindexXXXXXX";
+    if (!mkdtemp(path))
+    {
+        std::perror("mkdtemp");
+        return 1;
+    }
+    std::string root             = std::string(path) + "/saves";
+    std::vector<std::string> ids = titleIds();
+    makeTree(root, ids);
+    std::printf("%d backups in %d title folders\n",
+        TITLES * BACKUPS_PER_TITLE + OTHER_TITLES * 10, TITLES + OTHER_TITLES);
+
+    timeIndex(root, ids);
+    testIndex(root, ids);
+
+    fs::remove_all(path);
+    return Test::result();
+}
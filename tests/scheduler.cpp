@@ -0,0 +1,158 @@
+/*
+ *   This file is part of PKSM
+ *   Copyright (C) 2016-2021 Bernardo Giordano, Admiral Fish, piepie62
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *   Additional Terms 7.b and 7.c of GPLv3 apply to this file:
+ *       * Requiring preservation of specified reasonable legal notices or
+ *         author attributions in that material or in the Appropriate Legal
+ *         Notices displayed by works containing it.
+ *       * Prohibiting misrepresentation of the origin of that material,
+ *         or requiring that modified versions of such material be marked in
+ *         reasonable ways as different from the original version.
+ */
+
+#include "test.hpp"
+#include "thread.hpp"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace
+{
+    // Spins until done is true or a few seconds have passed, so a broken scheduler fails the
+    // check instead of hanging the test
+    bool waitFor(const std::atomic<bool>& done)
+    {
+        auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+        while (!done && std::chrono::steady_clock::now() < deadline)
+        {
+            std::this_thread::yield();
+        }
+        return done;
+    }
+
+    void testPriorities()
+    {
+        CHECK(Threads::init(1));
+
+        // Keep the only worker busy until everything is queued, so nothing starts early
+        std::atomic<bool> release = false;
+        auto gate                 = Threads::executeTask([&release] { waitFor(release); });
+
+        std::mutex orderLock;
+        std::vector<Threads::Priority> order;
+        std::vector<std::future<void>> done;
+        for (auto priority : {Threads::Priority::LOW, Threads::Priority::NORMAL,
+                 Threads::Priority::HIGH, Threads::Priority::LOW, Threads::Priority::HIGH})
+        {
+            done.emplace_back(Threads::executeTask(
+                [&, priority]
+                {
+                    std::lock_guard<std::mutex> lock(orderLock);
+                    order.emplace_back(priority);
+                },
+                priority));
+        }
+        release = true;
+        gate.wait();
+        for (auto& task : done)
+        {
+            task.wait();
+        }
+
+        CHECK(order == std::vector<Threads::Priority>{Threads::Priority::HIGH,
+                           Threads::Priority::HIGH, Threads::Priority::NORMAL,
+                           Threads::Priority::LOW, Threads::Priority::LOW});
+        Threads::exit();
+    }
+
+    void testStealing()
+    {
+        CHECK(Threads::init(2));
+
+        // Tasks queued from a worker go on that worker's own deque, so the only way they can run
+        // while it's busy is by the other one stealing them
+        constexpr int TASKS = 16;
+        std::atomic<int> ran     = 0;
+        std::atomic<bool> allRan = false;
+        Threads::executeTask(
+            [&]
+            {
+                for (int i = 0; i < TASKS; i++)
+                {
+                    Threads::executeTask(
+                        [&]
+                        {
+                            if (++ran == TASKS)
+                            {
+                                allRan = true;
+                            }
+                        });
+                }
+                waitFor(allRan);
+            })
+            .wait();
+        CHECK(ran == TASKS);
+        Threads::exit();
+    }
+
+    void testStress()
+    {
+        const u8 workers = std::clamp(std::thread::hardware_concurrency(), 2u, 8u);
+        CHECK(Threads::init(workers));
+
+        // Lots of tiny tasks, from the main thread and from tasks themselves, at every priority
+        constexpr int OUTER = 2000, INNER = 50;
+        std::atomic<int> ran = 0;
+        std::vector<std::future<void>> done;
+        auto start = std::chrono::steady_clock::now();
+        for (int i = 0; i < OUTER; i++)
+        {
+            done.emplace_back(Threads::executeTask(
+                [&ran, i]
+                {
+                    for (int j = 0; j < INNER; j++)
+                    {
+                        Threads::executeTask([&ran] { ran++; }, Threads::Priority(j % 3));
+                    }
+                    ran++;
+                },
+                Threads::Priority(i % 3)));
+        }
+        for (auto& task : done)
+        {
+            task.wait();
+        }
+        // Only the outer tasks were waited on, so the rest are done once the workers have stopped
+        Threads::exit();
+        std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+        CHECK(ran == OUTER * (INNER + 1));
+        std::printf("%d tasks on %d workers: %.0f tasks/s\n", ran.load(), workers,
+            ran / elapsed.count());
+    }
+}
+
+int main()
+{
+    testPriorities();
+    testStealing();
+    testStress();
+    return Test::result();
+}
@@ -0,0 +1,178 @@
+/*
+ *   This file is part of PKSM
+ *   Copyright (C) 2016-2021 Bernardo Giordano, Admiral Fish, piepie62
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *   Additional Terms 7.b and 7.c of GPLv3 apply to this file:
+ *       * Requiring preservation of specified reasonable legal notices or
+ *         author attributions in that material or in the Appropriate Legal
+ *         Notices displayed by works containing it.
+ *       * Prohibiting misrepresentation of the origin of that material,
+ *         or requiring that modified versions of such material be marked in
+ *         reasonable ways as different from the original version.
+ */
+
+#include "SimulatedSpiChip.hpp"
+#include "SpiPlanner.hpp"
+#include "test.hpp"
+#include <algorithm>
+#include <vector>
+
+namespace
+{
+    using Kind = SimulatedSpiChip::Kind;
+
+    void fillPattern(SimulatedSpiChip& chip)
+    {
+        for (size_t i = 0; i < chip.memory.size(); i++)
+        {
+            chip.memory[i] = u8(i * 7 + (i >> 8));
+        }
+    }
+
+    void testFlash()
+    {
+        SimulatedSpiChip chip(Kind::FLASH, 0x80000, 0x204013);
+        fillPattern(chip);
+        const std::vector<u8> original = chip.memory;
+        SpiPlanner planner(chip);
+
+        // One status poll because nothing is known about the chip yet, then the ID and the
+        // status register
+        CardType type = NO_CHIP;
+        CHECK(planner.getCardType(&type, 0) == 0);
+        CHECK(type == FLASH_512KB_1);
+        CHECK(chip.transactions == 3);
+
+        // The whole chip in transport sized runs, and no status polls since nothing was written
+        chip.resetCounters();
+        std::vector<u8> data(0x80000);
+        CHECK(planner.read(type, 0, data.data(), data.size()) == 0);
+        CHECK(data == original);
+        CHECK(chip.transactions == 0x80000 / chip.maxTransfer());
+        CHECK(chip.statusReads == 0);
+        CHECK(chip.largestAnswer <= chip.maxTransfer());
+
+        // A write crossing three page boundaries is four page writes, each waited on
+        chip.resetCounters();
+        std::vector<u8> written(0x258);
+        for (size_t i = 0; i < written.size(); i++)
+        {
+            written[i] = u8(0xA5 ^ i);
+        }
+        CHECK(planner.write(type, 0x1F0, written.data(), written.size()) == 0);
+        CHECK(chip.writes == 4);
+        CHECK(std::equal(written.begin(), written.end(), chip.memory.begin() + 0x1F0));
+        CHECK(std::equal(original.begin(), original.begin() + 0x1F0, chip.memory.begin()));
+        CHECK(std::equal(original.begin() + 0x448, original.end(), chip.memory.begin() + 0x448));
+
+        // The last write was waited on, so reading doesn't poll again
+        chip.resetCounters();
+        CHECK(planner.read(type, 0x1F0, data.data(), written.size()) == 0);
+        CHECK(std::equal(written.begin(), written.end(), data.begin()));
+        CHECK(chip.transactions == 1);
+
+        chip.resetCounters();
+        CHECK(planner.eraseSector(type, 0x10000) == 0);
+        CHECK(chip.erases == 1);
+        CHECK(std::all_of(chip.memory.begin() + 0x10000, chip.memory.begin() + 0x20000,
+            [](u8 b) { return b == 0xFF; }));
+        CHECK(std::equal(
+            original.begin() + 0x20000, original.end(), chip.memory.begin() + 0x20000));
+
+        CHECK(chip.violations == 0);
+    }
+
+    void testEeprom(u32 size, CardType expected)
+    {
+        SimulatedSpiChip chip(Kind::EEPROM, size);
+        fillPattern(chip);
+        const std::vector<u8> original = chip.memory;
+        SpiPlanner planner(chip);
+
+        // Telling sizes apart means writing to the chip, but it has to end up as it was
+        const u8 header[0x200] = {'P', 'K', 'S', 'M'};
+        CardType type          = NO_CHIP;
+        CHECK(planner.getCardType(&type, 0, header, sizeof(header)) == 0);
+        CHECK(type == expected);
+        CHECK(chip.writes > 0);
+        CHECK(chip.memory == original);
+
+        // The same card again is known from its header, so it isn't written to
+        chip.resetCounters();
+        type = NO_CHIP;
+        CHECK(planner.getCardType(&type, 0, header, sizeof(header)) == 0);
+        CHECK(type == expected);
+        CHECK(chip.transactions == 2);
+        CHECK(chip.writes == 0);
+
+        // Pages are much smaller than on flash chips
+        chip.resetCounters();
+        std::vector<u8> written(100, 0x5A);
+        CHECK(planner.write(type, 20, written.data(), written.size()) == 0);
+        CHECK(chip.writes == (expected == EEPROM_8KB ? 4 : 1));
+        std::vector<u8> data(size);
+        CHECK(planner.read(type, 0, data.data(), size) == 0);
+        CHECK(std::equal(written.begin(), written.end(), data.begin() + 20));
+        CHECK(std::equal(original.begin(), original.begin() + 20, data.begin()));
+        CHECK(std::equal(original.begin() + 120, original.end(), data.begin() + 120));
+
+        // A different card probes again
+        chip.resetCounters();
+        const u8 otherHeader[0x200] = {'P', 'K', 'S', 'N'};
+        CHECK(planner.getCardType(&type, 0, otherHeader, sizeof(otherHeader)) == 0);
+        CHECK(type == expected);
+        CHECK(chip.writes > 0);
+
+        CHECK(chip.violations == 0);
+    }
+
+    void testEeprom512B()
+    {
+        SimulatedSpiChip chip(Kind::EEPROM_512B, 0x200);
+        fillPattern(chip);
+        const std::vector<u8> original = chip.memory;
+        SpiPlanner planner(chip);
+
+        CardType type = NO_CHIP;
+        CHECK(planner.getCardType(&type, 0) == 0);
+        CHECK(type == EEPROM_512B);
+
+        // The upper half has its own commands, so everything is exactly two reads
+        chip.resetCounters();
+        std::vector<u8> data(0x200);
+        CHECK(planner.read(type, 0, data.data(), data.size()) == 0);
+        CHECK(data == original);
+        CHECK(chip.transactions == 2);
+
+        std::vector<u8> written(0x40, 0x3C);
+        CHECK(planner.write(type, 0xE0, written.data(), written.size()) == 0);
+        CHECK(planner.read(type, 0xE0, data.data(), written.size()) == 0);
+        CHECK(std::equal(written.begin(), written.end(), data.begin()));
+        CHECK(std::equal(original.begin(), original.begin() + 0xE0, chip.memory.begin()));
+        CHECK(std::equal(original.begin() + 0x120, original.end(), chip.memory.begin() + 0x120));
+
+        CHECK(chip.violations == 0);
+    }
+}
+
+int main()
+{
+    testFlash();
+    testEeprom(0x2000, EEPROM_8KB);
+    testEeprom(0x10000, EEPROM_64KB);
+    testEeprom512B();
+    return Test::result();
+}
@@ -0,0 +1,156 @@
+/*
+ *   This file is part of PKSM
+ *   Copyright (C) 2016-2021 Bernardo Giordano, Admiral Fish, piepie62
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *   Additional Terms 7.b and 7.c of GPLv3 apply to this file:
+ *       * Requiring preservation of specified reasonable legal notices or
+ *         author attributions in that material or in the Appropriate Legal
+ *         Notices displayed by works containing it.
+ *       * Prohibiting misrepresentation of the origin of that material,
+ *         or requiring that modified versions of such material be marked in
+ *         reasonable ways as different from the original version.
+ */
+
+#include "Swizzle.hpp"
+#include "test.hpp"
+#include <algorithm>
+#include <vector>
+
+namespace
+{
+    // Straight from the layout description rather than the bit tricks in Swizzle::offset: tiles
+    // go left to right and then top to bottom, and texels within a tile are in Morton order with
+    // x in the even bits
+    u32 referenceOffset(u32 x, u32 y, u32 width)
+    {
+        u32 tile   = (y / 8) * (width / 8) + x / 8;
+        u32 morton = 0;
+        for (u32 bit = 0; bit < 3; bit++)
+        {
+            morton |= ((x >> bit) & 1) << (2 * bit);
+            morton |= ((y >> bit) & 1) << (2 * bit + 1);
+        }
+        return tile * 64 + morton;
+    }
+
+    void testOffset()
+    {
+        for (u32 width : {8u, 32u, 64u, 512u})
+        {
+            std::vector<bool> seen(width * 64);
+            for (u32 y = 0; y < 64; y++)
+            {
+                for (u32 x = 0; x < width; x++)
+                {
+                    u32 offset = Swizzle::offset(x, y, width);
+                    CHECK(offset == referenceOffset(x, y, width));
+                    if (CHECK(offset < seen.size()))
+                    {
+                        CHECK(!seen[offset]);
+                        seen[offset] = true;
+                    }
+                }
+            }
+        }
+    }
+
+    void testBlit()
+    {
+        constexpr u32 WIDTH = 16, HEIGHT = 24, DST_WIDTH = 64, DST_HEIGHT = 48, X = 40, Y = 16;
+        std::vector<u16> src(WIDTH * HEIGHT);
+        for (u32 y = 0; y < HEIGHT; y++)
+        {
+            for (u32 x = 0; x < WIDTH; x++)
+            {
+                src[Swizzle::offset(x, y, WIDTH)] = 1 + x + y * WIDTH;
+            }
+        }
+
+        std::vector<u16> dst(DST_WIDTH * DST_HEIGHT, 0);
+        Swizzle::blit(src.data(), WIDTH, HEIGHT, dst.data(), DST_WIDTH, X, Y);
+        for (u32 y = 0; y < DST_HEIGHT; y++)
+        {
+            for (u32 x = 0; x < DST_WIDTH; x++)
+            {
+                bool inside = x >= X && x < X + WIDTH && y >= Y && y < Y + HEIGHT;
+                u16 want    = inside ? 1 + (x - X) + (y - Y) * WIDTH : 0;
+                CHECK(dst[Swizzle::offset(x, y, DST_WIDTH)] == want);
+            }
+        }
+    }
+
+    void testFromLinear()
+    {
+        constexpr u32 WIDTH = 24, HEIGHT = 16, DST_WIDTH = 32, DST_HEIGHT = 24;
+        std::vector<u16> src(WIDTH * HEIGHT);
+        for (u32 i = 0; i < src.size(); i++)
+        {
+            src[i] = 1 + i;
+        }
+
+        std::vector<u16> dst(DST_WIDTH * DST_HEIGHT, 0);
+        Swizzle::fromLinear(src.data(), WIDTH, HEIGHT, dst.data(), DST_WIDTH);
+        for (u32 y = 0; y < DST_HEIGHT; y++)
+        {
+            for (u32 x = 0; x < DST_WIDTH; x++)
+            {
+                u16 want = x < WIDTH && y < HEIGHT ? 1 + x + y * WIDTH : 0;
+                CHECK(dst[Swizzle::offset(x, y, DST_WIDTH)] == want);
+            }
+        }
+    }
+
+    void testDsIcon()
+    {
+        // DS icons are 4x4 tiles of 8x8 texels, 4 bits each and the low nibble first
+        auto index = [](u32 x, u32 y) { return (x + y * 3) % 4; };
+        u8 data[0x200] = {};
+        for (u32 y = 0; y < 32; y++)
+        {
+            for (u32 x = 0; x < 32; x++)
+            {
+                u32 tile  = (y / 8) * 4 + x / 8;
+                u32 texel = (y % 8) * 8 + x % 8;
+                data[tile * 32 + texel / 2] |= index(x, y) << ((texel % 2) * 4);
+            }
+        }
+        u16 palette[16] = {};
+        palette[0]      = 0x001F; // Transparent no matter what it says
+        palette[1]      = 0x7FFF; // White
+        palette[2]      = 0x03E0; // Full green
+        palette[3]      = 0x0421; // The lowest nonzero value of each channel
+
+        u16 out[32 * 32];
+        Swizzle::dsIcon(data, palette, out);
+        const u16 expected[4] = {0xFFFF, 0xFFFF, 0x07E0, 0x0841};
+        for (u32 y = 0; y < 32; y++)
+        {
+            for (u32 x = 0; x < 32; x++)
+            {
+                CHECK(out[Swizzle::offset(x, y, 32)] == expected[index(x, y)]);
+            }
+        }
+    }
+}
+
+int main()
+{
+    testOffset();
+    testBlit();
+    testFromLinear();
+    testDsIcon();
+    return Test::result();
+}